@@ -0,0 +1,543 @@
+#ifndef SDL_WEBGPU_DEMO_ADAPTER_SELECTION_HPP
+#define SDL_WEBGPU_DEMO_ADAPTER_SELECTION_HPP
+
+#include "wgpu_sync.hpp"
+
+#include <webgpu/webgpu.h>
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * On hosts with several GPUs, requesting a single adapter may well return
+ * the slow one. Instead every adapter reachable through the different power
+ * preferences (and the fallback adapter) is benchmarked with a short fill
+ * rate and upload bandwidth test, and the fastest one is used. The decision
+ * is cached on disk, keyed by the set of candidate adapters, so the
+ * benchmark only runs again when the hardware or drivers change.
+ */
+class adapter_selector
+{
+    public:
+    adapter_selector(WGPUInstance instance, WGPUSurface surface) :
+        m_instance(instance),
+        m_surface(surface)
+    {
+    }
+
+    WGPUAdapter select()
+    {
+        enumerate_candidates();
+
+        if(m_candidates.empty())
+        {
+            return nullptr;
+        }
+
+        auto const signature = candidate_signature();
+        auto chosen = m_candidates.size() == 1u ?
+            std::size_t{0} : find_cached(signature);
+
+        if(chosen == no_candidate)
+        {
+            for(auto & candidate: m_candidates)
+            {
+                candidate.score_ms = benchmark(candidate.adapter);
+                std::cout <<
+                    "Adapter benchmark: " << candidate.name << ": " <<
+                    candidate.score_ms << "ms\n";
+            }
+
+            auto const fastest = std::min_element(
+                m_candidates.begin(), m_candidates.end(),
+                [](auto const & a, auto const & b)
+                {
+                    return a.score_ms < b.score_ms;
+                });
+
+            chosen = static_cast<std::size_t>(fastest - m_candidates.begin());
+            store_cached(signature, m_candidates[chosen].key);
+        }
+
+        for(auto i = std::size_t{0}; i != m_candidates.size(); ++i)
+        {
+            if(i != chosen)
+            {
+                wgpuAdapterRelease(m_candidates[i].adapter);
+            }
+        }
+
+        auto const adapter = m_candidates[chosen].adapter;
+        m_candidates.clear();
+
+        return adapter;
+    }
+
+    private:
+    static constexpr auto no_candidate = std::numeric_limits<std::size_t>::max();
+    static constexpr std::uint32_t fill_target_size = 1024u;
+    static constexpr std::uint32_t fill_overdraw = 32u;
+    static constexpr std::uint64_t upload_chunk_size = 4u * 1024u * 1024u;
+    static constexpr std::uint32_t upload_chunk_count = 16u;
+    static constexpr int benchmark_rounds = 3;
+
+    struct candidate_t
+    {
+        WGPUAdapter adapter;
+        std::string key;
+        std::string name;
+        double score_ms = std::numeric_limits<double>::infinity();
+    };
+
+    void enumerate_candidates()
+    {
+        struct preference_t
+        {
+            WGPUPowerPreference power_preference;
+            bool force_fallback;
+        };
+
+        constexpr std::array preferences
+        {
+            preference_t{ WGPUPowerPreference_HighPerformance, false },
+            preference_t{ WGPUPowerPreference_LowPower, false },
+            preference_t{ WGPUPowerPreference_Undefined, true },
+        };
+
+        for(auto const & preference: preferences)
+        {
+            WGPURequestAdapterOptions const adapter_options =
+            {
+                .nextInChain = nullptr,
+                .compatibleSurface = m_surface,
+                .powerPreference = preference.power_preference,
+                .backendType = WGPUBackendType_Undefined,
+                .forceFallbackAdapter = preference.force_fallback,
+                .compatibilityMode = false,
+            };
+
+            auto const adapter = request_adapter(m_instance, adapter_options);
+
+            if(!adapter)
+            {
+                continue;
+            }
+
+            WGPUAdapterProperties properties{ .nextInChain = nullptr };
+            wgpuAdapterGetProperties(adapter, &properties);
+
+            auto key = adapter_key(properties);
+            auto const duplicate = std::any_of(
+                m_candidates.begin(), m_candidates.end(),
+                [&key](auto const & c) { return c.key == key; });
+
+            if(duplicate)
+            {
+                wgpuAdapterRelease(adapter);
+                continue;
+            }
+
+            m_candidates.push_back(
+            {
+                .adapter = adapter,
+                .key = std::move(key),
+                .name = properties.name ? properties.name : "unnamed"
+            });
+        }
+    }
+
+    static std::string adapter_key(WGPUAdapterProperties const & properties)
+    {
+        auto const text = [](char const * s)
+        {
+            auto result = std::string{s ? s : ""};
+            std::replace_if(
+                result.begin(), result.end(),
+                [](char c) { return c == '\n' || c == '\r' || c == '|'; },
+                ' ');
+            return result;
+        };
+
+        std::ostringstream key;
+        key <<
+            properties.vendorID << ':' <<
+            properties.deviceID << ':' <<
+            static_cast<std::uint32_t>(properties.backendType) << ':' <<
+            static_cast<std::uint32_t>(properties.adapterType) << ':' <<
+            text(properties.name) << ':' <<
+            text(properties.driverDescription);
+
+        return key.str();
+    }
+
+    std::string candidate_signature() const
+    {
+        auto keys = std::vector<std::string>{};
+        for(auto const & candidate: m_candidates)
+        {
+            keys.push_back(candidate.key);
+        }
+
+        std::sort(keys.begin(), keys.end());
+
+        auto signature = std::string{};
+        for(auto const & key: keys)
+        {
+            signature += key;
+            signature += '|';
+        }
+
+        return signature;
+    }
+
+    static std::string cache_path()
+    {
+        auto * pref_path = SDL_GetPrefPath("sdl-webgpu", "demo");
+        if(!pref_path)
+        {
+            return {};
+        }
+
+        auto path = std::string{pref_path} + "adapter-selection.cache";
+        SDL_free(pref_path);
+
+        return path;
+    }
+
+    std::size_t find_cached(std::string const & signature) const
+    {
+        std::ifstream cache{cache_path()};
+        auto cached_signature = std::string{};
+        auto cached_key = std::string{};
+
+        if(!std::getline(cache, cached_signature) ||
+           !std::getline(cache, cached_key) ||
+           cached_signature != signature)
+        {
+            return no_candidate;
+        }
+
+        for(auto i = std::size_t{0}; i != m_candidates.size(); ++i)
+        {
+            if(m_candidates[i].key == cached_key)
+            {
+                std::cout <<
+                    "Using cached adapter selection: " <<
+                    m_candidates[i].name << '\n';
+                return i;
+            }
+        }
+
+        return no_candidate;
+    }
+
+    static void store_cached(std::string const & signature, std::string const & key)
+    {
+        auto const path = cache_path();
+        if(path.empty())
+        {
+            return;
+        }
+
+        std::ofstream cache{path, std::ios::trunc};
+        cache << signature << '\n' << key << '\n';
+    }
+
+    /* Combined time of the fill rate and upload tests, lower is better */
+    static double benchmark(WGPUAdapter adapter)
+    {
+        WGPUDeviceDescriptor const device_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "BenchmarkDevice",
+            .requiredFeaturesCount = 0u,
+            .requiredFeatures = nullptr,
+            .requiredLimits = nullptr,
+            .defaultQueue = { .nextInChain = nullptr, .label = "BenchmarkQueue" },
+            .deviceLostCallback = nullptr,
+            .deviceLostUserdata = nullptr
+        };
+
+        auto const device = request_device(adapter, device_descriptor);
+
+        if(!device)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        auto const queue = wgpuDeviceGetQueue(device);
+        auto const result =
+            benchmark_fill_rate(device, queue) +
+            benchmark_upload(device, queue);
+
+        wgpuQueueRelease(queue);
+        wgpuDeviceRelease(device);
+
+        return result;
+    }
+
+    static double elapsed_ms(std::uint64_t begin)
+    {
+        return
+            1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - begin) /
+            static_cast<double>(SDL_GetPerformanceFrequency());
+    }
+
+    static double benchmark_fill_rate(WGPUDevice device, WGPUQueue queue)
+    {
+        WGPUShaderModuleWGSLDescriptor const code_descriptor =
+        {
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_ShaderModuleWGSLDescriptor
+            },
+            .code = R"WGSL(
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32) -> @builtin(position) vec4f
+{
+    let uv = vec2f(f32((index << 1u) & 2u), f32(index & 2u));
+    return vec4f(uv * 2.0 - 1.0, 0.0, 1.0);
+}
+
+@fragment
+fn fs_main(@builtin(position) position: vec4f) -> @location(0) vec4f
+{
+    return vec4f(fract(position.xy / 64.0), 0.5, 0.05);
+}
+            )WGSL"
+        };
+
+        WGPUShaderModuleDescriptor const module_descriptor =
+        {
+            .nextInChain = &code_descriptor.chain,
+            .label = "BenchmarkShader"
+        };
+
+        auto const module =
+            wgpuDeviceCreateShaderModule(device, &module_descriptor);
+
+        /* Blending keeps the implementation from skipping hidden layers */
+        WGPUBlendState const blend =
+        {
+            .color =
+            {
+                .operation = WGPUBlendOperation_Add,
+                .srcFactor = WGPUBlendFactor_SrcAlpha,
+                .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha
+            },
+            .alpha =
+            {
+                .operation = WGPUBlendOperation_Add,
+                .srcFactor = WGPUBlendFactor_One,
+                .dstFactor = WGPUBlendFactor_One
+            }
+        };
+
+        WGPUColorTargetState const color_target =
+        {
+            .nextInChain = nullptr,
+            .format = WGPUTextureFormat_RGBA8Unorm,
+            .blend = &blend,
+            .writeMask = WGPUColorWriteMask_All
+        };
+
+        WGPUFragmentState const fragment_state =
+        {
+            .nextInChain = nullptr,
+            .module = module,
+            .entryPoint = "fs_main",
+            .constantCount = 0u,
+            .constants = nullptr,
+            .targetCount = 1,
+            .targets = &color_target
+        };
+
+        WGPURenderPipelineDescriptor const pipeline_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "BenchmarkPipeline",
+            .layout = nullptr,
+            .vertex =
+            {
+                .nextInChain = nullptr,
+                .module = module,
+                .entryPoint = "vs_main",
+                .constantCount = 0,
+                .constants = nullptr,
+                .bufferCount = 0,
+                .buffers = nullptr
+            },
+            .primitive =
+            {
+                .nextInChain = nullptr,
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .stripIndexFormat = WGPUIndexFormat_Undefined,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_None
+            },
+            .depthStencil = nullptr,
+            .multisample =
+            {
+                .nextInChain = nullptr,
+                .count = 1,
+                .mask = ~std::uint32_t{0},
+                .alphaToCoverageEnabled = false
+            },
+            .fragment = &fragment_state
+        };
+
+        auto const pipeline =
+            wgpuDeviceCreateRenderPipeline(device, &pipeline_descriptor);
+
+        WGPUTextureDescriptor const target_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "BenchmarkTarget",
+            .usage = WGPUTextureUsage_RenderAttachment,
+            .dimension = WGPUTextureDimension_2D,
+            .size = { fill_target_size, fill_target_size, 1u },
+            .format = WGPUTextureFormat_RGBA8Unorm,
+            .mipLevelCount = 1u,
+            .sampleCount = 1u,
+            .viewFormatCount = 0u,
+            .viewFormats = nullptr
+        };
+
+        auto const target = wgpuDeviceCreateTexture(device, &target_descriptor);
+        auto const target_view = wgpuTextureCreateView(target, nullptr);
+
+        auto best = std::numeric_limits<double>::infinity();
+
+        if(module && pipeline && target_view)
+        {
+            /* The first round also warms up pipeline and allocations */
+            for(auto round = 0; round <= benchmark_rounds; ++round)
+            {
+                auto const begin = SDL_GetPerformanceCounter();
+
+                auto const encoder = wgpuDeviceCreateCommandEncoder(device, nullptr);
+
+                WGPURenderPassColorAttachment const color_attachment =
+                {
+                    .nextInChain = nullptr,
+                    .view = target_view,
+                    .resolveTarget = nullptr,
+                    .loadOp = WGPULoadOp_Clear,
+                    .storeOp = WGPUStoreOp_Store,
+                    .clearValue = { 0.0, 0.0, 0.0, 1.0 }
+                };
+
+                WGPURenderPassDescriptor const pass_descriptor =
+                {
+                    .nextInChain = nullptr,
+                    .label = "BenchmarkPass",
+                    .colorAttachmentCount = 1,
+                    .colorAttachments = &color_attachment,
+                    .depthStencilAttachment = nullptr,
+                    .occlusionQuerySet = nullptr,
+                    .timestampWriteCount = 0,
+                    .timestampWrites = nullptr
+                };
+
+                auto const pass =
+                    wgpuCommandEncoderBeginRenderPass(encoder, &pass_descriptor);
+                wgpuRenderPassEncoderSetPipeline(pass, pipeline);
+                wgpuRenderPassEncoderDraw(pass, 3u, fill_overdraw, 0u, 0u);
+                wgpuRenderPassEncoderEnd(pass);
+
+                auto const commands = wgpuCommandEncoderFinish(encoder, nullptr);
+                wgpuQueueSubmit(queue, 1, &commands);
+                wgpuCommandBufferRelease(commands);
+                wgpuRenderPassEncoderRelease(pass);
+                wgpuCommandEncoderRelease(encoder);
+
+                if(!wait_for_submitted_work(device, queue))
+                {
+                    best = std::numeric_limits<double>::infinity();
+                    break;
+                }
+
+                if(round > 0)
+                {
+                    best = std::min(best, elapsed_ms(begin));
+                }
+            }
+        }
+
+        if(target_view) wgpuTextureViewRelease(target_view);
+        if(target) wgpuTextureRelease(target);
+        if(pipeline) wgpuRenderPipelineRelease(pipeline);
+        if(module) wgpuShaderModuleRelease(module);
+
+        return best;
+    }
+
+    static double benchmark_upload(WGPUDevice device, WGPUQueue queue)
+    {
+        WGPUBufferDescriptor const descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "BenchmarkUploadBuffer",
+            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+            .size = upload_chunk_size,
+            .mappedAtCreation = false
+        };
+
+        auto const buffer = wgpuDeviceCreateBuffer(device, &descriptor);
+
+        if(!buffer)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+
+        auto const data = std::vector<std::uint8_t>(upload_chunk_size, 0x5A);
+        auto best = std::numeric_limits<double>::infinity();
+
+        for(auto round = 0; round <= benchmark_rounds; ++round)
+        {
+            auto const begin = SDL_GetPerformanceCounter();
+
+            for(auto i = 0u; i != upload_chunk_count; ++i)
+            {
+                wgpuQueueWriteBuffer(queue, buffer, 0, data.data(), data.size());
+            }
+
+            /* An empty submit flushes the pending writes */
+            auto const encoder = wgpuDeviceCreateCommandEncoder(device, nullptr);
+            auto const commands = wgpuCommandEncoderFinish(encoder, nullptr);
+            wgpuQueueSubmit(queue, 1, &commands);
+            wgpuCommandBufferRelease(commands);
+            wgpuCommandEncoderRelease(encoder);
+
+            if(!wait_for_submitted_work(device, queue))
+            {
+                best = std::numeric_limits<double>::infinity();
+                break;
+            }
+
+            if(round > 0)
+            {
+                best = std::min(best, elapsed_ms(begin));
+            }
+        }
+
+        wgpuBufferRelease(buffer);
+
+        return best;
+    }
+
+    WGPUInstance m_instance;
+    WGPUSurface m_surface;
+    std::vector<candidate_t> m_candidates;
+}; /* class adapter_selector */
+
+#endif /* SDL_WEBGPU_DEMO_ADAPTER_SELECTION_HPP */
@@ -0,0 +1,296 @@
+#ifndef SDL_WEBGPU_DEMO_DEVICE_LIMITS_HPP
+#define SDL_WEBGPU_DEMO_DEVICE_LIMITS_HPP
+
+#include <webgpu/webgpu.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Device limits are requested in named tiers. The highest tier the adapter
+ * can satisfy is chosen, so capable hardware automatically gets large
+ * buffers, storage buffers and compute, while the minimal tier still runs
+ * the basic demo everywhere.
+ */
+enum class device_tier
+{
+    minimal,
+    standard,
+    high_end
+};
+
+constexpr char const * device_tier_name(device_tier tier)
+{
+    switch(tier)
+    {
+        case device_tier::minimal: return "minimal";
+        case device_tier::standard: return "default";
+        case device_tier::high_end: return "high-end";
+    }
+
+    return "unknown";
+}
+
+namespace device_limits
+{
+constexpr auto uniform_buffer_offset_alignment = 256u;
+
+constexpr WGPULimits minimal_tier
+{
+    .maxTextureDimension1D = 0,
+    .maxTextureDimension2D = 0,
+    .maxTextureDimension3D = 0,
+    .maxTextureArrayLayers = 0,
+    .maxBindGroups = 1,
+    .maxBindGroupsPlusVertexBuffers = 4,
+    .maxBindingsPerBindGroup = 4,
+    .maxDynamicUniformBuffersPerPipelineLayout = 2,
+    .maxDynamicStorageBuffersPerPipelineLayout = 0,
+    .maxSampledTexturesPerShaderStage = 0,
+    .maxSamplersPerShaderStage = 0,
+    .maxStorageBuffersPerShaderStage = 0,
+    .maxStorageTexturesPerShaderStage = 0,
+    .maxUniformBuffersPerShaderStage = 4,
+    .maxUniformBufferBindingSize = 4096,
+    .maxStorageBufferBindingSize = 0,
+    .minUniformBufferOffsetAlignment = uniform_buffer_offset_alignment,
+    .minStorageBufferOffsetAlignment = 1024,
+    .maxVertexBuffers = 4,
+    .maxBufferSize = 1024*1024,
+    .maxVertexAttributes = 4,
+    .maxVertexBufferArrayStride = 512,
+    .maxInterStageShaderComponents = 16,
+    .maxInterStageShaderVariables = 8,
+    .maxColorAttachments = 1,
+    .maxColorAttachmentBytesPerSample = 16,
+    .maxComputeWorkgroupStorageSize = 0,
+    .maxComputeInvocationsPerWorkgroup = 0,
+    .maxComputeWorkgroupSizeX = 0,
+    .maxComputeWorkgroupSizeY = 0,
+    .maxComputeWorkgroupSizeZ = 0,
+    .maxComputeWorkgroupsPerDimension = 0,
+};
+
+/* The WebGPU specification defaults, available on any conformant adapter */
+constexpr WGPULimits standard_tier
+{
+    .maxTextureDimension1D = 8192,
+    .maxTextureDimension2D = 8192,
+    .maxTextureDimension3D = 2048,
+    .maxTextureArrayLayers = 256,
+    .maxBindGroups = 4,
+    .maxBindGroupsPlusVertexBuffers = 24,
+    .maxBindingsPerBindGroup = 1000,
+    .maxDynamicUniformBuffersPerPipelineLayout = 8,
+    .maxDynamicStorageBuffersPerPipelineLayout = 4,
+    .maxSampledTexturesPerShaderStage = 16,
+    .maxSamplersPerShaderStage = 16,
+    .maxStorageBuffersPerShaderStage = 8,
+    .maxStorageTexturesPerShaderStage = 4,
+    .maxUniformBuffersPerShaderStage = 12,
+    .maxUniformBufferBindingSize = 64*1024,
+    .maxStorageBufferBindingSize = 128*1024*1024,
+    .minUniformBufferOffsetAlignment = uniform_buffer_offset_alignment,
+    .minStorageBufferOffsetAlignment = 256,
+    .maxVertexBuffers = 8,
+    .maxBufferSize = 256*1024*1024,
+    .maxVertexAttributes = 16,
+    .maxVertexBufferArrayStride = 2048,
+    .maxInterStageShaderComponents = 60,
+    .maxInterStageShaderVariables = 16,
+    .maxColorAttachments = 8,
+    .maxColorAttachmentBytesPerSample = 32,
+    .maxComputeWorkgroupStorageSize = 16384,
+    .maxComputeInvocationsPerWorkgroup = 256,
+    .maxComputeWorkgroupSizeX = 256,
+    .maxComputeWorkgroupSizeY = 256,
+    .maxComputeWorkgroupSizeZ = 64,
+    .maxComputeWorkgroupsPerDimension = 65535,
+};
+
+/* Typical of current discrete GPUs */
+constexpr WGPULimits high_end_tier
+{
+    .maxTextureDimension1D = 16384,
+    .maxTextureDimension2D = 16384,
+    .maxTextureDimension3D = 2048,
+    .maxTextureArrayLayers = 2048,
+    .maxBindGroups = 4,
+    .maxBindGroupsPlusVertexBuffers = 24,
+    .maxBindingsPerBindGroup = 1000,
+    .maxDynamicUniformBuffersPerPipelineLayout = 8,
+    .maxDynamicStorageBuffersPerPipelineLayout = 4,
+    .maxSampledTexturesPerShaderStage = 16,
+    .maxSamplersPerShaderStage = 16,
+    .maxStorageBuffersPerShaderStage = 8,
+    .maxStorageTexturesPerShaderStage = 8,
+    .maxUniformBuffersPerShaderStage = 12,
+    .maxUniformBufferBindingSize = 64*1024,
+    .maxStorageBufferBindingSize = std::uint64_t{1024}*1024*1024,
+    .minUniformBufferOffsetAlignment = uniform_buffer_offset_alignment,
+    .minStorageBufferOffsetAlignment = 256,
+    .maxVertexBuffers = 8,
+    .maxBufferSize = std::uint64_t{1024}*1024*1024,
+    .maxVertexAttributes = 16,
+    .maxVertexBufferArrayStride = 2048,
+    .maxInterStageShaderComponents = 60,
+    .maxInterStageShaderVariables = 16,
+    .maxColorAttachments = 8,
+    .maxColorAttachmentBytesPerSample = 32,
+    .maxComputeWorkgroupStorageSize = 32768,
+    .maxComputeInvocationsPerWorkgroup = 1024,
+    .maxComputeWorkgroupSizeX = 1024,
+    .maxComputeWorkgroupSizeY = 1024,
+    .maxComputeWorkgroupSizeZ = 64,
+    .maxComputeWorkgroupsPerDimension = 65535,
+};
+
+constexpr WGPULimits const & tier_limits(device_tier tier)
+{
+    switch(tier)
+    {
+        case device_tier::high_end: return high_end_tier;
+        case device_tier::standard: return standard_tier;
+        case device_tier::minimal: break;
+    }
+
+    return minimal_tier;
+}
+
+/* Requested whenever the adapter supports them */
+constexpr std::array optional_features
+{
+    WGPUFeatureName_TextureCompressionBC,
+    WGPUFeatureName_TextureCompressionETC2,
+    WGPUFeatureName_TextureCompressionASTC,
+    WGPUFeatureName_TimestampQuery,
+    WGPUFeatureName_IndirectFirstInstance,
+    WGPUFeatureName_ShaderF16,
+};
+
+constexpr bool satisfies(WGPULimits const & supported, WGPULimits const & required)
+{
+#define WEBGPU_SDL_CHECK_MAX_LIMIT(item) \
+    if(supported.item < required.item) return false
+#define WEBGPU_SDL_CHECK_MIN_LIMIT(item) \
+    if(supported.item > required.item) return false
+
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxTextureDimension1D);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxTextureDimension2D);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxTextureDimension3D);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxTextureArrayLayers);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxBindGroups);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxBindGroupsPlusVertexBuffers);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxBindingsPerBindGroup);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxDynamicUniformBuffersPerPipelineLayout);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxDynamicStorageBuffersPerPipelineLayout);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxSampledTexturesPerShaderStage);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxSamplersPerShaderStage);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxStorageBuffersPerShaderStage);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxStorageTexturesPerShaderStage);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxUniformBuffersPerShaderStage);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxUniformBufferBindingSize);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxStorageBufferBindingSize);
+    WEBGPU_SDL_CHECK_MIN_LIMIT(minUniformBufferOffsetAlignment);
+    WEBGPU_SDL_CHECK_MIN_LIMIT(minStorageBufferOffsetAlignment);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxVertexBuffers);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxBufferSize);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxVertexAttributes);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxVertexBufferArrayStride);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxInterStageShaderComponents);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxInterStageShaderVariables);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxColorAttachments);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxColorAttachmentBytesPerSample);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxComputeWorkgroupStorageSize);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxComputeInvocationsPerWorkgroup);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxComputeWorkgroupSizeX);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxComputeWorkgroupSizeY);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxComputeWorkgroupSizeZ);
+    WEBGPU_SDL_CHECK_MAX_LIMIT(maxComputeWorkgroupsPerDimension);
+
+#undef WEBGPU_SDL_CHECK_MIN_LIMIT
+#undef WEBGPU_SDL_CHECK_MAX_LIMIT
+
+    return true;
+}
+} /* namespace device_limits */
+
+struct negotiated_device
+{
+    device_tier tier = device_tier::minimal;
+    WGPURequiredLimits required_limits =
+    {
+        .nextInChain = nullptr,
+        .limits = device_limits::minimal_tier
+    };
+    std::vector<WGPUFeatureName> features;
+
+    bool has_feature(WGPUFeatureName feature) const
+    {
+        for(auto const f: features)
+        {
+            if(f == feature)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool has_storage_buffers() const
+    {
+        return required_limits.limits.maxStorageBuffersPerShaderStage > 0u;
+    }
+
+    bool has_compute() const
+    {
+        return required_limits.limits.maxComputeInvocationsPerWorkgroup > 0u;
+    }
+};
+
+/*
+ * Picks the highest tier, up to max_tier, that the adapter supports and the
+ * optional features it exposes. If the adapter limits can't be queried, the
+ * minimal tier is used.
+ */
+inline negotiated_device negotiate_device(
+    WGPUAdapter adapter, device_tier max_tier = device_tier::high_end)
+{
+    auto result = negotiated_device{};
+
+    WGPUSupportedLimits supported{ .nextInChain = nullptr };
+    if(wgpuAdapterGetLimits(adapter, &supported))
+    {
+        constexpr std::array tiers
+        {
+            device_tier::high_end, device_tier::standard, device_tier::minimal
+        };
+
+        for(auto const tier: tiers)
+        {
+            if(tier <= max_tier &&
+               device_limits::satisfies(
+                   supported.limits, device_limits::tier_limits(tier)))
+            {
+                result.tier = tier;
+                break;
+            }
+        }
+    }
+
+    result.required_limits.limits = device_limits::tier_limits(result.tier);
+
+    for(auto const feature: device_limits::optional_features)
+    {
+        if(wgpuAdapterHasFeature(adapter, feature))
+        {
+            result.features.push_back(feature);
+        }
+    }
+
+    return result;
+}
+
+#endif /* SDL_WEBGPU_DEMO_DEVICE_LIMITS_HPP */
@@ -0,0 +1,163 @@
+#ifndef SDL_WEBGPU_DEMO_DEVICE_RECOVERY_HPP
+#define SDL_WEBGPU_DEMO_DEVICE_RECOVERY_HPP
+
+#include <webgpu/webgpu.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * In-memory blob cache handed to Dawn through its cache device descriptor.
+ * Dawn stores compiled shader and pipeline blobs here, and looks them up
+ * again when an identical pipeline is created. The cache outlives the
+ * device, so pipelines rebuilt after a device loss skip compilation.
+ *
+ * Plain WebGPU has no pipeline cache object; without Dawn the chained
+ * descriptor is ignored and recovery simply compiles again.
+ */
+class pipeline_blob_cache
+{
+    public:
+    explicit pipeline_blob_cache(char const * isolation_key) :
+        m_descriptor
+        {
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_DawnCacheDeviceDescriptor
+            },
+            .isolationKey = isolation_key,
+            .loadDataFunction = &pipeline_blob_cache::load,
+            .storeDataFunction = &pipeline_blob_cache::store,
+            .functionUserdata = this
+        }
+    {
+    }
+
+    pipeline_blob_cache(pipeline_blob_cache const &) = delete;
+    pipeline_blob_cache & operator=(pipeline_blob_cache const &) = delete;
+
+    /* Chain this into WGPUDeviceDescriptor::nextInChain */
+    WGPUChainedStruct const * chain() const
+    {
+        return &m_descriptor.chain;
+    }
+
+    std::size_t entry_count() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_entries.size();
+    }
+
+    std::uint64_t hits() const
+    {
+        return m_hits.load(std::memory_order_relaxed);
+    }
+
+    private:
+    /* Returns the blob size; copies it only when value is large enough */
+    static std::size_t load(
+        void const * key, std::size_t key_size,
+        void * value, std::size_t value_size,
+        void * user_data)
+    {
+        auto & cache = *static_cast<pipeline_blob_cache *>(user_data);
+        std::lock_guard<std::mutex> lock{cache.m_mutex};
+
+        auto const it = cache.m_entries.find(
+            std::string{static_cast<char const *>(key), key_size});
+
+        if(it == cache.m_entries.end())
+        {
+            return 0u;
+        }
+
+        auto const & blob = it->second;
+        if(value && value_size >= blob.size())
+        {
+            std::memcpy(value, blob.data(), blob.size());
+            cache.m_hits.fetch_add(1u, std::memory_order_relaxed);
+        }
+
+        return blob.size();
+    }
+
+    static void store(
+        void const * key, std::size_t key_size,
+        void const * value, std::size_t value_size,
+        void * user_data)
+    {
+        auto & cache = *static_cast<pipeline_blob_cache *>(user_data);
+        std::lock_guard<std::mutex> lock{cache.m_mutex};
+
+        auto const * bytes = static_cast<std::uint8_t const *>(value);
+        cache.m_entries.insert_or_assign(
+            std::string{static_cast<char const *>(key), key_size},
+            std::vector<std::uint8_t>(bytes, bytes + value_size));
+    }
+
+    WGPUDawnCacheDeviceDescriptor m_descriptor;
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::vector<std::uint8_t>> m_entries;
+    std::atomic<std::uint64_t> m_hits = 0u;
+}; /* class pipeline_blob_cache */
+
+/*
+ * Remembers that the device was lost. The lost callback may run on any
+ * thread that ticks the device; the main loop polls lost() and recovers
+ * from there. Losses caused by releasing the device ourselves are ignored.
+ */
+class device_loss_monitor
+{
+    public:
+    void attach(WGPUDevice device)
+    {
+        m_lost.store(false, std::memory_order_release);
+        wgpuDeviceSetDeviceLostCallback(
+            device, &device_loss_monitor::on_device_lost, this);
+    }
+
+    static void detach(WGPUDevice device)
+    {
+        wgpuDeviceSetDeviceLostCallback(device, nullptr, nullptr);
+    }
+
+    bool lost() const
+    {
+        return m_lost.load(std::memory_order_acquire);
+    }
+
+    std::string message() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_message;
+    }
+
+    private:
+    static void on_device_lost(
+        WGPUDeviceLostReason reason, char const * message, void * user_data)
+    {
+        if(reason == WGPUDeviceLostReason_Destroyed)
+        {
+            return;
+        }
+
+        auto & monitor = *static_cast<device_loss_monitor *>(user_data);
+        {
+            std::lock_guard<std::mutex> lock{monitor.m_mutex};
+            monitor.m_message = message ? message : "";
+        }
+        monitor.m_lost.store(true, std::memory_order_release);
+    }
+
+    std::atomic<bool> m_lost = false;
+    mutable std::mutex m_mutex;
+    std::string m_message;
+}; /* class device_loss_monitor */
+
+#endif /* SDL_WEBGPU_DEMO_DEVICE_RECOVERY_HPP */
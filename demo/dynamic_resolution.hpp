@@ -0,0 +1,490 @@
+#ifndef SDL_WEBGPU_DEMO_DYNAMIC_RESOLUTION_HPP
+#define SDL_WEBGPU_DEMO_DYNAMIC_RESOLUTION_HPP
+
+#include "gpu_memory.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+struct resolution_settings
+{
+    float min_scale = 0.5f;
+    float max_scale = 1.0f;
+    double target_frame_ms = 1000.0 / 60.0;
+};
+
+/*
+ * Picks the render scale (per axis) from measured frame times. The cost of
+ * a frame is assumed to follow the pixel count, i.e. the square of the
+ * scale, so the scale moves by the square root of the time ratio. It drops
+ * immediately when over budget and recovers in small steps when there is
+ * clear headroom, and waits a few samples after each change because the
+ * measurements lag several frames behind.
+ */
+class resolution_controller
+{
+    public:
+    explicit resolution_controller(resolution_settings const & settings) :
+        m_settings(settings),
+        m_scale(settings.max_scale)
+    {
+        if(!(settings.min_scale > 0.0f) || settings.min_scale > settings.max_scale)
+        {
+            throw std::runtime_error{"Invalid dynamic resolution scale bounds"};
+        }
+    }
+
+    float scale() const
+    {
+        return m_scale;
+    }
+
+    void update(double frame_ms)
+    {
+        m_average_ms = m_average_ms > 0.0 ?
+            m_average_ms + smoothing * (frame_ms - m_average_ms) : frame_ms;
+
+        if(m_cooldown != 0u)
+        {
+            --m_cooldown;
+            return;
+        }
+
+        auto const target = m_settings.target_frame_ms;
+        auto factor = 1.0;
+
+        if(m_average_ms > target)
+        {
+            factor = std::sqrt(target / m_average_ms);
+        }
+        else if(m_average_ms < target * headroom)
+        {
+            factor = std::min(std::sqrt(target * headroom / m_average_ms), max_step_up);
+        }
+
+        auto const scale = std::clamp(
+            static_cast<float>(m_scale * factor),
+            m_settings.min_scale, m_settings.max_scale);
+
+        if(std::abs(scale - m_scale) >= min_change)
+        {
+            m_scale = scale;
+            m_cooldown = cooldown_samples;
+        }
+    }
+
+    private:
+    static constexpr double smoothing = 0.25;
+    static constexpr double headroom = 0.8;
+    static constexpr double max_step_up = 1.05;
+    static constexpr float min_change = 0.01f;
+    static constexpr std::uint32_t cooldown_samples = 6u;
+
+    resolution_settings m_settings;
+    float m_scale;
+    double m_average_ms = 0.0;
+    std::uint32_t m_cooldown = 0u;
+}; /* class resolution_controller */
+
+/*
+ * Offscreen scene target plus the pass that upscales it into the swap
+ * chain. The texture is allocated once at the largest scale; smaller scales
+ * render into its top left corner through the viewport, so changing the
+ * scale never reallocates anything.
+ */
+class dynamic_resolution
+{
+    public:
+    dynamic_resolution(
+        WGPUDevice device,
+        gpu_memory & memory,
+        WGPUTextureFormat format,
+        std::uint32_t output_width,
+        std::uint32_t output_height,
+        resolution_settings const & settings) :
+        m_device(device),
+        m_memory(memory),
+        m_output_width(output_width),
+        m_output_height(output_height),
+        m_max_scale(settings.max_scale),
+        m_controller(settings)
+    {
+        m_texture_width = scaled(m_output_width, m_max_scale);
+        m_texture_height = scaled(m_output_height, m_max_scale);
+
+        WGPUTextureDescriptor const texture_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "SceneTarget",
+            .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding,
+            .dimension = WGPUTextureDimension_2D,
+            .size = { m_texture_width, m_texture_height, 1u },
+            .format = format,
+            .mipLevelCount = 1u,
+            .sampleCount = 1u,
+            .viewFormatCount = 0u,
+            .viewFormats = nullptr
+        };
+
+        m_texture = m_memory.create_texture(m_device, texture_descriptor);
+
+        if(!m_texture)
+        {
+            throw std::runtime_error{"Scene target creation failed"};
+        }
+
+        m_view = wgpuTextureCreateView(m_texture, nullptr);
+
+        create_upscale_pipeline(format);
+    }
+
+    ~dynamic_resolution()
+    {
+        wgpuBindGroupRelease(m_bind_group);
+        m_memory.release(m_uniform);
+        wgpuSamplerRelease(m_sampler);
+        wgpuRenderPipelineRelease(m_pipeline);
+        wgpuTextureViewRelease(m_view);
+        wgpuTextureDestroy(m_texture);
+        m_memory.release(m_texture);
+    }
+
+    dynamic_resolution(dynamic_resolution const &) = delete;
+    dynamic_resolution & operator=(dynamic_resolution const &) = delete;
+
+    void update(double frame_ms)
+    {
+        m_controller.update(frame_ms);
+    }
+
+    float scale() const
+    {
+        return m_controller.scale();
+    }
+
+    WGPUTextureView scene_view() const
+    {
+        return m_view;
+    }
+
+    /* Size of the scene target, attachments of the scene pass must match */
+    std::uint32_t texture_width() const
+    {
+        return m_texture_width;
+    }
+
+    std::uint32_t texture_height() const
+    {
+        return m_texture_height;
+    }
+
+    /* Size of the region the scene is rendered to this frame */
+    std::uint32_t scene_width() const
+    {
+        return std::min(scaled(m_output_width, scale()), m_texture_width);
+    }
+
+    std::uint32_t scene_height() const
+    {
+        return std::min(scaled(m_output_height, scale()), m_texture_height);
+    }
+
+    /* Restricts a scene pass to the rendered region */
+    void set_scene_viewport(WGPURenderPassEncoder pass) const
+    {
+        auto const width = scene_width();
+        auto const height = scene_height();
+
+        wgpuRenderPassEncoderSetViewport(
+            pass, 0.0f, 0.0f,
+            static_cast<float>(width), static_cast<float>(height),
+            0.0f, 1.0f);
+        wgpuRenderPassEncoderSetScissorRect(pass, 0u, 0u, width, height);
+    }
+
+    /*
+     * Records the upscale of the rendered region into output_view and
+     * returns the pass still open, so overlays can be drawn at output
+     * resolution. The caller ends and releases it.
+     */
+    WGPURenderPassEncoder upscale(
+        WGPUQueue queue,
+        WGPUCommandEncoder encoder,
+        WGPUTextureView output_view)
+    {
+        auto const width = scene_width();
+        auto const height = scene_height();
+
+        if(width != m_uploaded_width || height != m_uploaded_height)
+        {
+            auto const texture_width = static_cast<float>(m_texture_width);
+            auto const texture_height = static_cast<float>(m_texture_height);
+
+            // Clamp half a texel in so bilinear taps stay inside the region
+            std::array const region
+            {
+                static_cast<float>(width) / texture_width,
+                static_cast<float>(height) / texture_height,
+                (static_cast<float>(width) - 0.5f) / texture_width,
+                (static_cast<float>(height) - 0.5f) / texture_height
+            };
+
+            wgpuQueueWriteBuffer(queue, m_uniform, 0u, region.data(), sizeof(region));
+            m_uploaded_width = width;
+            m_uploaded_height = height;
+        }
+
+        WGPURenderPassColorAttachment const color_attachment =
+        {
+            .nextInChain = nullptr,
+            .view = output_view,
+            .resolveTarget = nullptr,
+            .loadOp = WGPULoadOp_Clear,
+            .storeOp = WGPUStoreOp_Store,
+            .clearValue = { 0.0, 0.0, 0.0, 1.0 }
+        };
+
+        WGPURenderPassDescriptor const pass_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "UpscalePass",
+            .colorAttachmentCount = 1,
+            .colorAttachments = &color_attachment,
+            .depthStencilAttachment = nullptr,
+            .occlusionQuerySet = nullptr,
+            .timestampWriteCount = 0,
+            .timestampWrites = nullptr
+        };
+
+        auto const pass = wgpuCommandEncoderBeginRenderPass(encoder, &pass_descriptor);
+        wgpuRenderPassEncoderSetPipeline(pass, m_pipeline);
+        wgpuRenderPassEncoderSetBindGroup(pass, 0, m_bind_group, 0, nullptr);
+        wgpuRenderPassEncoderDraw(pass, 3, 1, 0, 0);
+
+        return pass;
+    }
+
+    private:
+    static std::uint32_t scaled(std::uint32_t size, float scale)
+    {
+        return std::max(
+            1u, static_cast<std::uint32_t>(std::lround(static_cast<float>(size) * scale)));
+    }
+
+    void create_upscale_pipeline(WGPUTextureFormat format)
+    {
+        WGPUShaderModuleWGSLDescriptor const code_descriptor =
+        {
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_ShaderModuleWGSLDescriptor
+            },
+            .code = R"WGSL(
+struct upscale_region
+{
+    uv_scale: vec2f,
+    uv_max: vec2f,
+};
+
+@group(0) @binding(0) var scene: texture_2d<f32>;
+@group(0) @binding(1) var scene_sampler: sampler;
+@group(0) @binding(2) var<uniform> region: upscale_region;
+
+struct vertex_output
+{
+    @builtin(position) position: vec4f,
+    @location(0) uv: vec2f,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32) -> vertex_output
+{
+    let uv = vec2f(f32((index << 1u) & 2u), f32(index & 2u));
+    var out: vertex_output;
+    out.position = vec4f(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0, 0.0, 1.0);
+    out.uv = uv * region.uv_scale;
+    return out;
+}
+
+@fragment
+fn fs_main(in: vertex_output) -> @location(0) vec4f
+{
+    return textureSample(scene, scene_sampler, min(in.uv, region.uv_max));
+}
+            )WGSL"
+        };
+
+        WGPUShaderModuleDescriptor const module_descriptor =
+        {
+            .nextInChain = &code_descriptor.chain,
+            .label = "UpscaleShader"
+        };
+
+        auto const module = wgpuDeviceCreateShaderModule(m_device, &module_descriptor);
+
+        WGPUColorTargetState const color_target =
+        {
+            .nextInChain = nullptr,
+            .format = format,
+            .blend = nullptr,
+            .writeMask = WGPUColorWriteMask_All
+        };
+
+        WGPUFragmentState const fragment_state =
+        {
+            .nextInChain = nullptr,
+            .module = module,
+            .entryPoint = "fs_main",
+            .constantCount = 0u,
+            .constants = nullptr,
+            .targetCount = 1,
+            .targets = &color_target
+        };
+
+        WGPURenderPipelineDescriptor const pipeline_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "UpscalePipeline",
+            .layout = nullptr,
+            .vertex =
+            {
+                .nextInChain = nullptr,
+                .module = module,
+                .entryPoint = "vs_main",
+                .constantCount = 0,
+                .constants = nullptr,
+                .bufferCount = 0,
+                .buffers = nullptr
+            },
+            .primitive =
+            {
+                .nextInChain = nullptr,
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .stripIndexFormat = WGPUIndexFormat_Undefined,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_None
+            },
+            .depthStencil = nullptr,
+            .multisample =
+            {
+                .nextInChain = nullptr,
+                .count = 1,
+                .mask = ~std::uint32_t{0},
+                .alphaToCoverageEnabled = false
+            },
+            .fragment = &fragment_state
+        };
+
+        m_pipeline = wgpuDeviceCreateRenderPipeline(m_device, &pipeline_descriptor);
+        wgpuShaderModuleRelease(module);
+
+        if(!m_pipeline)
+        {
+            throw std::runtime_error{"Upscale pipeline creation failed"};
+        }
+
+        WGPUSamplerDescriptor const sampler_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "UpscaleSampler",
+            .addressModeU = WGPUAddressMode_ClampToEdge,
+            .addressModeV = WGPUAddressMode_ClampToEdge,
+            .addressModeW = WGPUAddressMode_ClampToEdge,
+            .magFilter = WGPUFilterMode_Linear,
+            .minFilter = WGPUFilterMode_Linear,
+            .mipmapFilter = WGPUMipmapFilterMode_Nearest,
+            .lodMinClamp = 0.0f,
+            .lodMaxClamp = 1.0f,
+            .compare = WGPUCompareFunction_Undefined,
+            .maxAnisotropy = 1
+        };
+
+        m_sampler = wgpuDeviceCreateSampler(m_device, &sampler_descriptor);
+
+        WGPUBufferDescriptor const uniform_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "UpscaleRegion",
+            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+            .size = region_uniform_size,
+            .mappedAtCreation = false
+        };
+
+        m_uniform = m_memory.create_buffer(m_device, uniform_descriptor);
+
+        std::array const bind_group_entries
+        {
+            WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = 0,
+                .buffer = nullptr,
+                .offset = 0,
+                .size = 0,
+                .sampler = nullptr,
+                .textureView = m_view
+            },
+            WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = 1,
+                .buffer = nullptr,
+                .offset = 0,
+                .size = 0,
+                .sampler = m_sampler,
+                .textureView = nullptr
+            },
+            WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = 2,
+                .buffer = m_uniform,
+                .offset = 0,
+                .size = region_uniform_size,
+                .sampler = nullptr,
+                .textureView = nullptr
+            }
+        };
+
+        auto const bind_group_layout = wgpuRenderPipelineGetBindGroupLayout(m_pipeline, 0);
+
+        WGPUBindGroupDescriptor const bind_group_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "UpscaleBindGroup",
+            .layout = bind_group_layout,
+            .entryCount = bind_group_entries.size(),
+            .entries = bind_group_entries.data()
+        };
+
+        m_bind_group = wgpuDeviceCreateBindGroup(m_device, &bind_group_descriptor);
+        wgpuBindGroupLayoutRelease(bind_group_layout);
+    }
+
+    static constexpr std::uint64_t region_uniform_size = 4u * sizeof(float);
+
+    WGPUDevice m_device;
+    gpu_memory & m_memory;
+    std::uint32_t m_output_width;
+    std::uint32_t m_output_height;
+    float m_max_scale;
+    resolution_controller m_controller;
+    std::uint32_t m_texture_width = 0u;
+    std::uint32_t m_texture_height = 0u;
+    std::uint32_t m_uploaded_width = 0u;
+    std::uint32_t m_uploaded_height = 0u;
+    WGPUTexture m_texture = nullptr;
+    WGPUTextureView m_view = nullptr;
+    WGPURenderPipeline m_pipeline = nullptr;
+    WGPUSampler m_sampler = nullptr;
+    WGPUBuffer m_uniform = nullptr;
+    WGPUBindGroup m_bind_group = nullptr;
+}; /* class dynamic_resolution */
+
+#endif /* SDL_WEBGPU_DEMO_DYNAMIC_RESOLUTION_HPP */
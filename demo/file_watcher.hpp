@@ -0,0 +1,161 @@
+#ifndef SDL_WEBGPU_DEMO_FILE_WATCHER_HPP
+#define SDL_WEBGPU_DEMO_FILE_WATCHER_HPP
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+inline std::string read_text_file(std::filesystem::path const & path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if(!file)
+    {
+        throw std::runtime_error{"Can't read " + path.string()};
+    }
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+inline void write_text_file(std::filesystem::path const & path, std::string_view text)
+{
+    std::ofstream file{path, std::ios::binary};
+    if(!file.write(text.data(), static_cast<std::streamsize>(text.size())))
+    {
+        throw std::runtime_error{"Can't write " + path.string()};
+    }
+}
+
+/*
+ * Reports changes of one file, checked once per frame without blocking.
+ *
+ * On Linux inotify watches the file's directory rather than the file, so
+ * editors that save by writing a new file and renaming it over the old one
+ * are noticed too. The descriptor is non-blocking and changed() costs one
+ * read() that usually returns EAGAIN. Other platforms poll the
+ * modification time a few times per second.
+ */
+class file_watcher
+{
+    public:
+    explicit file_watcher(std::filesystem::path path) :
+        m_path(std::move(path))
+    {
+#if defined(__linux__)
+        auto const directory = m_path.has_parent_path() ?
+            m_path.parent_path() : std::filesystem::path{"."};
+
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(m_fd < 0 ||
+            inotify_add_watch(
+                m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+        {
+            if(m_fd >= 0)
+            {
+                close(m_fd);
+            }
+            throw std::runtime_error{"Can't watch " + directory.string()};
+        }
+#else
+        m_last_write = last_write_time();
+#endif
+    }
+
+    ~file_watcher()
+    {
+#if defined(__linux__)
+        close(m_fd);
+#endif
+    }
+
+    file_watcher(file_watcher const &) = delete;
+    file_watcher & operator=(file_watcher const &) = delete;
+
+    std::filesystem::path const & path() const
+    {
+        return m_path;
+    }
+
+    /* True once for any number of changes since the last call */
+    bool changed()
+    {
+#if defined(__linux__)
+        auto const file_name = m_path.filename().string();
+        auto changed = false;
+
+        alignas(inotify_event) std::array<char, 4096> buffer;
+        for(;;)
+        {
+            auto const length = read(m_fd, buffer.data(), buffer.size());
+            if(length <= 0)
+            {
+                break;
+            }
+
+            for(auto offset = ssize_t{0}; offset < length;)
+            {
+                auto const * event = reinterpret_cast<inotify_event const *>(
+                    buffer.data() + offset);
+
+                if(event->len != 0u && file_name == event->name)
+                {
+                    changed = true;
+                }
+
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+
+        return changed;
+#else
+        auto const now = std::chrono::steady_clock::now();
+        if(now - m_last_check < poll_interval)
+        {
+            return false;
+        }
+        m_last_check = now;
+
+        auto const write_time = last_write_time();
+        if(write_time == m_last_write)
+        {
+            return false;
+        }
+
+        m_last_write = write_time;
+        return true;
+#endif
+    }
+
+    private:
+    std::filesystem::path m_path;
+#if defined(__linux__)
+    int m_fd = -1;
+#else
+    static constexpr auto poll_interval = std::chrono::milliseconds{250};
+
+    std::filesystem::file_time_type last_write_time() const
+    {
+        auto error = std::error_code{};
+        auto const time = std::filesystem::last_write_time(m_path, error);
+        return error ? std::filesystem::file_time_type{} : time;
+    }
+
+    std::filesystem::file_time_type m_last_write;
+    std::chrono::steady_clock::time_point m_last_check;
+#endif
+}; /* class file_watcher */
+
+#endif /* SDL_WEBGPU_DEMO_FILE_WATCHER_HPP */
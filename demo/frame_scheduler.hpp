@@ -0,0 +1,153 @@
+#ifndef SDL_WEBGPU_DEMO_FRAME_SCHEDULER_HPP
+#define SDL_WEBGPU_DEMO_FRAME_SCHEDULER_HPP
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdint>
+
+/*
+ * Decides when the main loop renders and when it sleeps. Frames are drawn
+ * continuously only while the window is visible and the scene animates, or
+ * once when a frame has been requested. Otherwise the loop blocks in
+ * SDL_WaitEventTimeout instead of spinning on SDL_PollEvent.
+ *
+ * A failed swap chain acquire (e.g. while the surface is being resized or
+ * is occluded) schedules a retry with an exponentially growing delay, so
+ * the loop does not hot-spin on a surface that cannot present.
+ */
+class frame_scheduler
+{
+    public:
+    static constexpr std::uint32_t default_idle_timeout_ms = 250u;
+    static constexpr std::uint32_t max_backoff_ms = 250u;
+
+    explicit frame_scheduler(
+        SDL_Window * window,
+        std::uint32_t idle_timeout_ms = default_idle_timeout_ms) :
+        m_idle_timeout_ms(idle_timeout_ms)
+    {
+        auto const flags = SDL_GetWindowFlags(window);
+        m_visible = (flags & (SDL_WINDOW_HIDDEN | SDL_WINDOW_MINIMIZED)) == 0;
+    }
+
+    /*
+     * Waits for the next thing to do and dispatches every pending event to
+     * on_event. Returns without blocking when a frame is due.
+     */
+    template <typename Handler>
+    void wait(Handler && on_event)
+    {
+        auto event = SDL_Event{};
+        auto const timeout = wait_timeout();
+
+        auto have_event = timeout == 0 ?
+            SDL_PollEvent(&event) :
+            SDL_WaitEventTimeout(&event, timeout);
+
+        while(have_event)
+        {
+            if(event.type == SDL_WINDOWEVENT)
+            {
+                handle_window_event(event.window);
+            }
+
+            on_event(event);
+            have_event = SDL_PollEvent(&event);
+        }
+    }
+
+    /* True when a frame should be rendered now */
+    bool frame_due() const
+    {
+        return
+            m_visible &&
+            (m_animating || m_frame_requested) &&
+            !backing_off(SDL_GetTicks());
+    }
+
+    /* Static scenes only render when something requests a frame */
+    void set_animating(bool animating)
+    {
+        m_animating = animating;
+    }
+
+    bool animating() const
+    {
+        return m_animating;
+    }
+
+    void request_frame()
+    {
+        m_frame_requested = true;
+    }
+
+    void frame_presented()
+    {
+        m_frame_requested = false;
+        m_backoff_ms = 0u;
+    }
+
+    void acquire_failed()
+    {
+        m_backoff_ms = std::clamp(m_backoff_ms * 2u, 1u, max_backoff_ms);
+        m_retry_time = SDL_GetTicks() + m_backoff_ms;
+    }
+
+    bool visible() const
+    {
+        return m_visible;
+    }
+
+    private:
+    bool backing_off(std::uint32_t now) const
+    {
+        return m_backoff_ms != 0u && static_cast<std::int32_t>(m_retry_time - now) > 0;
+    }
+
+    int wait_timeout() const
+    {
+        if(!m_visible || !(m_animating || m_frame_requested))
+        {
+            return static_cast<int>(m_idle_timeout_ms);
+        }
+
+        auto const now = SDL_GetTicks();
+        if(backing_off(now))
+        {
+            return static_cast<int>(m_retry_time - now);
+        }
+
+        return 0;
+    }
+
+    void handle_window_event(SDL_WindowEvent const & event)
+    {
+        switch(event.event)
+        {
+            case SDL_WINDOWEVENT_HIDDEN:
+            case SDL_WINDOWEVENT_MINIMIZED:
+                m_visible = false;
+                break;
+            case SDL_WINDOWEVENT_SHOWN:
+            case SDL_WINDOWEVENT_RESTORED:
+            case SDL_WINDOWEVENT_EXPOSED:
+            case SDL_WINDOWEVENT_SIZE_CHANGED:
+                m_visible = true;
+                m_frame_requested = true;
+                m_backoff_ms = 0u;
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::uint32_t m_idle_timeout_ms;
+    bool m_visible = true;
+    bool m_animating = true;
+    bool m_frame_requested = true;
+    std::uint32_t m_backoff_ms = 0u;
+    std::uint32_t m_retry_time = 0u;
+}; /* class frame_scheduler */
+
+#endif /* SDL_WEBGPU_DEMO_FRAME_SCHEDULER_HPP */
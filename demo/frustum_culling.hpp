@@ -0,0 +1,348 @@
+#ifndef SDL_WEBGPU_DEMO_FRUSTUM_CULLING_HPP
+#define SDL_WEBGPU_DEMO_FRUSTUM_CULLING_HPP
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SDL_WEBGPU_DEMO_SSE 1
+#endif
+
+enum class culling_mode
+{
+    cpu,
+    gpu
+};
+
+constexpr char const * culling_mode_name(culling_mode mode)
+{
+    switch(mode)
+    {
+        case culling_mode::cpu: return "cpu";
+        case culling_mode::gpu: return "gpu";
+    }
+
+    return "unknown";
+}
+
+inline bool parse_culling_mode(std::string_view name, culling_mode & mode)
+{
+    for(auto const candidate: { culling_mode::cpu, culling_mode::gpu })
+    {
+        if(name == culling_mode_name(candidate))
+        {
+            mode = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* The six planes of a view frustum, normals pointing inwards */
+struct frustum
+{
+    std::array<glm::vec4, 6> planes;
+
+    /* Extracts the planes from the rows of a view projection matrix */
+    static frustum from_matrix(glm::mat4 const & m)
+    {
+        auto const row = [&m](int r)
+        {
+            return glm::vec4{m[0][r], m[1][r], m[2][r], m[3][r]};
+        };
+
+        auto result = frustum
+        {
+            {
+                row(3) + row(0), row(3) - row(0),
+                row(3) + row(1), row(3) - row(1),
+                row(3) + row(2), row(3) - row(2)
+            }
+        };
+
+        // Normalized planes give true distances to compare radii against
+        for(auto & plane: result.planes)
+        {
+            plane = plane / glm::length(glm::vec3{plane.x, plane.y, plane.z});
+        }
+
+        return result;
+    }
+};
+
+/*
+ * Tests bounding spheres against a frustum. The spheres are stored as one
+ * array per coordinate, padded to a multiple of four with spheres that are
+ * never visible, so the SSE path tests four spheres per plane with one
+ * multiply-add chain and no tail loop.
+ *
+ * Large sets are split into chunks that worker threads cull in parallel;
+ * each chunk collects its visible indices separately and the chunks are
+ * joined in order, so the result is sorted like the input. The workers
+ * sleep between calls and small sets are culled on the calling thread.
+ */
+class frustum_culler
+{
+    public:
+    static constexpr std::size_t min_chunk_size = 16384u;
+
+    explicit frustum_culler(unsigned thread_count = default_thread_count())
+    {
+        m_chunk_visible.resize(std::max(thread_count, 1u));
+        m_chunk_counts.resize(m_chunk_visible.size());
+        for(auto worker = 1u; worker < thread_count; ++worker)
+        {
+            m_workers.emplace_back([this, worker]{ worker_loop(worker); });
+        }
+    }
+
+    ~frustum_culler()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for(auto & worker: m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    frustum_culler(frustum_culler const &) = delete;
+    frustum_culler & operator=(frustum_culler const &) = delete;
+
+    /* Hardware threads, at most 8; culling is bound by memory bandwidth beyond */
+    static unsigned default_thread_count()
+    {
+        return std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    }
+
+    unsigned thread_count() const
+    {
+        return static_cast<unsigned>(m_chunk_visible.size());
+    }
+
+    void resize(std::size_t count)
+    {
+        auto const padded = (count + 3u) & ~std::size_t{3u};
+
+        m_count = count;
+        m_center_x.resize(padded, 0.0f);
+        m_center_y.resize(padded, 0.0f);
+        m_center_z.resize(padded, 0.0f);
+        m_radius.resize(padded, never_visible);
+
+        std::fill(m_radius.begin() + count, m_radius.end(), never_visible);
+    }
+
+    std::size_t size() const
+    {
+        return m_count;
+    }
+
+    void set_sphere(std::size_t index, glm::vec3 const & center, float radius)
+    {
+        m_center_x[index] = center.x;
+        m_center_y[index] = center.y;
+        m_center_z[index] = center.z;
+        m_radius[index] = radius;
+    }
+
+    /* Center and radius of a sphere set earlier */
+    glm::vec4 sphere(std::size_t index) const
+    {
+        return { m_center_x[index], m_center_y[index], m_center_z[index], m_radius[index] };
+    }
+
+    /* Indices of the spheres intersecting f, in ascending order */
+    std::span<std::uint32_t const> cull(frustum const & f)
+    {
+        auto const groups = m_radius.size() / 4u;
+        auto const chunks = std::clamp<std::size_t>(
+            (m_radius.size() + min_chunk_size - 1u) / min_chunk_size, 1u, thread_count());
+
+        m_job_frustum = f;
+        m_job_chunk_size = (groups + chunks - 1u) / chunks * 4u;
+        m_job_chunks = chunks;
+
+        // Chunks write their indices without bounds checks
+        for(auto chunk = std::size_t{0}; chunk != chunks; ++chunk)
+        {
+            if(m_chunk_visible[chunk].size() < m_job_chunk_size)
+            {
+                m_chunk_visible[chunk].resize(m_job_chunk_size);
+            }
+        }
+
+        if(chunks > 1u)
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_pending = m_workers.size();
+                ++m_generation;
+            }
+            m_wake.notify_all();
+        }
+
+        cull_chunk(0u);
+
+        if(chunks > 1u)
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_done.wait(lock, [this]{ return m_pending == 0u; });
+        }
+
+        m_visible.clear();
+        for(auto chunk = std::size_t{0}; chunk != chunks; ++chunk)
+        {
+            auto const & visible = m_chunk_visible[chunk];
+            m_visible.insert(
+                m_visible.end(), visible.begin(), visible.begin() + m_chunk_counts[chunk]);
+        }
+
+        return m_visible;
+    }
+
+    private:
+    // -radius is +inf, so no plane distance is ever greater
+    static constexpr float never_visible = -std::numeric_limits<float>::infinity();
+
+    void worker_loop(std::size_t worker)
+    {
+        auto seen = std::uint64_t{0};
+
+        for(;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_wake.wait(lock, [&]{ return m_stop || m_generation != seen; });
+                if(m_stop)
+                {
+                    return;
+                }
+                seen = m_generation;
+            }
+
+            if(worker < m_job_chunks)
+            {
+                cull_chunk(worker);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                if(--m_pending == 0u)
+                {
+                    m_done.notify_one();
+                }
+            }
+        }
+    }
+
+    void cull_chunk(std::size_t chunk)
+    {
+        // Every candidate is written and the count only advances past
+        // visible ones, which avoids a branch per sphere
+        auto * visible = m_chunk_visible[chunk].data();
+        auto count = std::size_t{0};
+
+        auto const begin = std::min(chunk * m_job_chunk_size, m_radius.size());
+        auto const end = std::min(begin + m_job_chunk_size, m_radius.size());
+        auto const & planes = m_job_frustum.planes;
+
+#if defined(SDL_WEBGPU_DEMO_SSE)
+        // Plain arrays, std::array would drop the vector type's alignment attribute
+        __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+        for(auto p = std::size_t{0}; p != planes.size(); ++p)
+        {
+            plane_x[p] = _mm_set1_ps(planes[p].x);
+            plane_y[p] = _mm_set1_ps(planes[p].y);
+            plane_z[p] = _mm_set1_ps(planes[p].z);
+            plane_w[p] = _mm_set1_ps(planes[p].w);
+        }
+
+        for(auto i = begin; i != end; i += 4u)
+        {
+            auto const x = _mm_loadu_ps(&m_center_x[i]);
+            auto const y = _mm_loadu_ps(&m_center_y[i]);
+            auto const z = _mm_loadu_ps(&m_center_z[i]);
+            auto const negative_radius =
+                _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+            auto const inside_plane = [&](std::size_t p)
+            {
+                auto distance = _mm_add_ps(_mm_mul_ps(x, plane_x[p]), plane_w[p]);
+                distance = _mm_add_ps(distance, _mm_mul_ps(y, plane_y[p]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(z, plane_z[p]));
+                return _mm_cmpgt_ps(distance, negative_radius);
+            };
+
+            auto inside = inside_plane(0u);
+            for(auto p = std::size_t{1}; p != planes.size(); ++p)
+            {
+                inside = _mm_and_ps(inside, inside_plane(p));
+            }
+
+            auto const mask = static_cast<unsigned>(_mm_movemask_ps(inside));
+            for(auto lane = 0u; lane != 4u; ++lane)
+            {
+                visible[count] = static_cast<std::uint32_t>(i + lane);
+                count += (mask >> lane) & 1u;
+            }
+        }
+#else
+        for(auto i = begin; i != end; ++i)
+        {
+            auto inside = true;
+            for(auto const & plane: planes)
+            {
+                auto const distance =
+                    m_center_x[i] * plane.x + m_center_y[i] * plane.y +
+                    m_center_z[i] * plane.z + plane.w;
+                inside = inside && distance > -m_radius[i];
+            }
+
+            visible[count] = static_cast<std::uint32_t>(i);
+            count += inside ? 1u : 0u;
+        }
+#endif
+
+        m_chunk_counts[chunk] = count;
+    }
+
+    std::size_t m_count = 0u;
+    std::vector<float> m_center_x;
+    std::vector<float> m_center_y;
+    std::vector<float> m_center_z;
+    std::vector<float> m_radius;
+    std::vector<std::uint32_t> m_visible;
+    std::vector<std::vector<std::uint32_t>> m_chunk_visible;
+    std::vector<std::size_t> m_chunk_counts;
+
+    frustum m_job_frustum{};
+    std::size_t m_job_chunk_size = 0u;
+    std::size_t m_job_chunks = 0u;
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::uint64_t m_generation = 0u;
+    std::size_t m_pending = 0u;
+    bool m_stop = false;
+}; /* class frustum_culler */
+
+#endif /* SDL_WEBGPU_DEMO_FRUSTUM_CULLING_HPP */
@@ -0,0 +1,521 @@
+#ifndef SDL_WEBGPU_DEMO_GPU_CULLING_HPP
+#define SDL_WEBGPU_DEMO_GPU_CULLING_HPP
+
+#include "frustum_culling.hpp"
+#include "gpu_memory.hpp"
+
+#include <webgpu/webgpu.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+/*
+ * Frustum culling in a compute pass, for scenes where even a SIMD loop over
+ * all instances costs too much CPU time.
+ *
+ * The world matrices of all instances live in a storage buffer that only
+ * receives changed matrices. cs_cull tests one instance per invocation and
+ * appends the matrices of the visible ones to the instance vertex buffer
+ * through an atomic counter, together with their morph weight rows when
+ * there are any. cs_finish then copies the counter into the instance count of
+ * every DrawIndexedIndirect argument record and resets it for the next
+ * dispatch, so the CPU neither reads back nor resets anything. The draws
+ * start at instance 0 and don't need the IndirectFirstInstance feature.
+ */
+class gpu_culling
+{
+    public:
+    static constexpr std::uint32_t workgroup_size = 64u;
+    static constexpr std::size_t max_draws = 4u;
+
+    /* Arguments of one wgpuRenderPassEncoderDrawIndexedIndirect */
+    struct draw_arguments
+    {
+        std::uint32_t index_count;
+        std::uint32_t instance_count;
+        std::uint32_t first_index;
+        std::int32_t base_vertex;
+        std::uint32_t first_instance;
+    };
+
+    /* True if the device can cull instance_count instances this way */
+    static bool supported(
+        WGPULimits const & limits, bool has_compute, std::uint32_t instance_count)
+    {
+        auto const workgroups = (instance_count + workgroup_size - 1u) / workgroup_size;
+
+        return has_compute &&
+            limits.maxStorageBuffersPerShaderStage >= 6u &&
+            limits.maxComputeInvocationsPerWorkgroup >= workgroup_size &&
+            workgroups <= limits.maxComputeWorkgroupsPerDimension &&
+            std::uint64_t{instance_count} * sizeof(glm::mat4) <=
+                limits.maxStorageBufferBindingSize;
+    }
+
+    /*
+     * visible_transforms receives the matrices of the visible instances and
+     * visible_weight_rows their morph weight rows, in the same order; both
+     * need Storage usage. Without morph weights visible_weight_rows may be
+     * null. index_counts has one entry per draw.
+     */
+    gpu_culling(
+        WGPUDevice device,
+        gpu_memory & memory,
+        std::uint32_t instance_count,
+        float bounding_radius,
+        WGPUBuffer visible_transforms,
+        WGPUBuffer visible_weight_rows,
+        std::span<std::uint32_t const> index_counts) :
+        m_device(device),
+        m_memory(memory),
+        m_instance_count(instance_count),
+        m_bounding_radius(bounding_radius),
+        m_copies_weight_rows(visible_weight_rows ? 1u : 0u),
+        m_draw_count(static_cast<std::uint32_t>(index_counts.size()))
+    {
+        if(index_counts.size() > max_draws)
+        {
+            throw std::runtime_error{"Too many indirect draws"};
+        }
+
+        create_buffers(index_counts, visible_weight_rows == nullptr);
+        create_pipelines(
+            visible_transforms,
+            visible_weight_rows ? visible_weight_rows : m_unused_weight_rows);
+    }
+
+    ~gpu_culling()
+    {
+        wgpuBindGroupRelease(m_bind_group);
+        wgpuComputePipelineRelease(m_finish_pipeline);
+        wgpuComputePipelineRelease(m_cull_pipeline);
+        m_memory.release(m_arguments);
+        m_memory.release(m_visible_count);
+        m_memory.release(m_parameters);
+        if(m_unused_weight_rows)
+        {
+            m_memory.release(m_unused_weight_rows);
+        }
+        m_memory.release(m_weight_rows);
+        m_memory.release(m_world);
+    }
+
+    gpu_culling(gpu_culling const &) = delete;
+    gpu_culling & operator=(gpu_culling const &) = delete;
+
+    /* Storage for the world matrices of all instances, indexed by instance */
+    WGPUBuffer world_transforms() const
+    {
+        return m_world;
+    }
+
+    /* Storage for the morph weight rows of all instances, indexed by instance */
+    WGPUBuffer instance_weight_rows() const
+    {
+        return m_weight_rows;
+    }
+
+    WGPUBuffer arguments() const
+    {
+        return m_arguments;
+    }
+
+    static std::uint64_t arguments_offset(std::size_t draw)
+    {
+        return draw * sizeof(draw_arguments);
+    }
+
+    /* Sets the frustum for the next dispatch; returns the bytes written */
+    std::size_t update(WGPUQueue queue, frustum const & f)
+    {
+        auto const parameters = cull_parameters
+        {
+            .planes = f.planes,
+            .instance_count = m_instance_count,
+            .bounding_radius = m_bounding_radius,
+            .draw_count = m_draw_count,
+            .copies_weight_rows = m_copies_weight_rows
+        };
+
+        wgpuQueueWriteBuffer(queue, m_parameters, 0u, &parameters, sizeof(parameters));
+        return sizeof(parameters);
+    }
+
+    /* Culls all instances and fills in the indirect arguments */
+    void dispatch(WGPUCommandEncoder encoder) const
+    {
+        WGPUComputePassDescriptor const pass_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "CullPass",
+            .timestampWriteCount = 0,
+            .timestampWrites = nullptr
+        };
+
+        auto const pass = wgpuCommandEncoderBeginComputePass(encoder, &pass_descriptor);
+        wgpuComputePassEncoderSetBindGroup(pass, 0, m_bind_group, 0, nullptr);
+
+        wgpuComputePassEncoderSetPipeline(pass, m_cull_pipeline);
+        wgpuComputePassEncoderDispatchWorkgroups(
+            pass, (m_instance_count + workgroup_size - 1u) / workgroup_size, 1, 1);
+
+        wgpuComputePassEncoderSetPipeline(pass, m_finish_pipeline);
+        wgpuComputePassEncoderDispatchWorkgroups(pass, 1, 1, 1);
+
+        wgpuComputePassEncoderEnd(pass);
+        wgpuComputePassEncoderRelease(pass);
+    }
+
+    private:
+    struct cull_parameters
+    {
+        std::array<glm::vec4, 6> planes;
+        std::uint32_t instance_count;
+        float bounding_radius;
+        std::uint32_t draw_count;
+        std::uint32_t copies_weight_rows;
+    };
+
+    static_assert(sizeof(cull_parameters) == 112u);
+    static_assert(sizeof(draw_arguments) == 20u);
+
+    WGPUBuffer create_buffer(
+        char const * label, WGPUBufferUsageFlags usage, std::uint64_t size, bool mapped = false)
+    {
+        WGPUBufferDescriptor const descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = label,
+            .usage = usage,
+            .size = size,
+            .mappedAtCreation = mapped
+        };
+
+        auto const buffer = m_memory.create_buffer(m_device, descriptor);
+        if(!buffer)
+        {
+            throw std::runtime_error{"Culling buffer creation failed"};
+        }
+
+        return buffer;
+    }
+
+    void create_buffers(std::span<std::uint32_t const> index_counts, bool without_weight_rows)
+    {
+        m_world = create_buffer(
+            "CullWorldTransforms",
+            WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+            std::uint64_t{m_instance_count} * sizeof(glm::mat4));
+        m_weight_rows = create_buffer(
+            "CullMorphWeightRows",
+            WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+            weight_rows_size());
+
+        // The shader always binds a weight row destination
+        if(without_weight_rows)
+        {
+            m_unused_weight_rows = create_buffer(
+                "CullUnusedWeightRows", WGPUBufferUsage_Storage, sizeof(std::uint32_t));
+        }
+        m_parameters = create_buffer(
+            "CullParameters",
+            WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform,
+            sizeof(cull_parameters));
+
+        // New buffers are zeroed, cs_finish resets the counter after use
+        m_visible_count = create_buffer(
+            "CullVisibleCount", WGPUBufferUsage_Storage, sizeof(std::uint32_t));
+
+        // Only the instance counts change after creation
+        auto const arguments_size = index_counts.size() * sizeof(draw_arguments);
+        m_arguments = create_buffer(
+            "CullDrawArguments",
+            WGPUBufferUsage_Indirect | WGPUBufferUsage_Storage,
+            arguments_size,
+            true);
+
+        auto * mapped = wgpuBufferGetMappedRange(m_arguments, 0, arguments_size);
+        if(!mapped)
+        {
+            throw std::runtime_error{"Mapping draw arguments failed"};
+        }
+
+        for(auto draw = std::size_t{0}; draw != index_counts.size(); ++draw)
+        {
+            auto const arguments = draw_arguments
+            {
+                .index_count = index_counts[draw],
+                .instance_count = 0u,
+                .first_index = 0u,
+                .base_vertex = 0,
+                .first_instance = 0u
+            };
+            std::memcpy(
+                static_cast<std::uint8_t *>(mapped) + arguments_offset(draw),
+                &arguments, sizeof(arguments));
+        }
+        wgpuBufferUnmap(m_arguments);
+    }
+
+    /* At least one row, empty bindings are not allowed */
+    std::uint64_t weight_rows_size() const
+    {
+        return std::max<std::uint64_t>(
+            std::uint64_t{m_instance_count} * m_copies_weight_rows, 1u) * sizeof(std::uint32_t);
+    }
+
+    void create_pipelines(WGPUBuffer visible_transforms, WGPUBuffer visible_weight_rows)
+    {
+        WGPUShaderModuleWGSLDescriptor const code_descriptor =
+        {
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_ShaderModuleWGSLDescriptor
+            },
+            .code = R"WGSL(
+struct cull_parameters
+{
+    planes: array<vec4f, 6>,
+    instance_count: u32,
+    bounding_radius: f32,
+    draw_count: u32,
+    copies_weight_rows: u32,
+};
+
+struct draw_arguments
+{
+    index_count: u32,
+    instance_count: u32,
+    first_index: u32,
+    base_vertex: i32,
+    first_instance: u32,
+};
+
+@group(0) @binding(0) var<uniform> parameters: cull_parameters;
+@group(0) @binding(1) var<storage, read> world: array<mat4x4f>;
+@group(0) @binding(2) var<storage, read_write> visible: array<mat4x4f>;
+@group(0) @binding(3) var<storage, read_write> visible_count: atomic<u32>;
+@group(0) @binding(4) var<storage, read_write> draws: array<draw_arguments>;
+@group(0) @binding(5) var<storage, read> weight_rows: array<u32>;
+@group(0) @binding(6) var<storage, read_write> visible_weight_rows: array<u32>;
+
+@compute @workgroup_size(64)
+fn cs_cull(@builtin(global_invocation_id) id: vec3u)
+{
+    if(id.x >= parameters.instance_count)
+    {
+        return;
+    }
+
+    let transform = world[id.x];
+    let scale = max(
+        length(transform[0].xyz),
+        max(length(transform[1].xyz), length(transform[2].xyz)));
+    let center = transform[3].xyz;
+    let radius = parameters.bounding_radius * scale;
+
+    for(var p = 0u; p < 6u; p++)
+    {
+        let plane = parameters.planes[p];
+        if(dot(plane.xyz, center) + plane.w <= -radius)
+        {
+            return;
+        }
+    }
+
+    let slot = atomicAdd(&visible_count, 1u);
+    visible[slot] = transform;
+
+    if(parameters.copies_weight_rows != 0u)
+    {
+        visible_weight_rows[slot] = weight_rows[id.x];
+    }
+}
+
+@compute @workgroup_size(1)
+fn cs_finish()
+{
+    let count = atomicExchange(&visible_count, 0u);
+    for(var d = 0u; d < parameters.draw_count; d++)
+    {
+        draws[d].instance_count = count;
+    }
+}
+            )WGSL"
+        };
+
+        WGPUShaderModuleDescriptor const module_descriptor =
+        {
+            .nextInChain = &code_descriptor.chain,
+            .label = "CullShader"
+        };
+
+        auto const module = wgpuDeviceCreateShaderModule(m_device, &module_descriptor);
+
+        auto const layout_entry = [](std::uint32_t binding, WGPUBufferBindingType type)
+        {
+            return WGPUBindGroupLayoutEntry
+            {
+                .nextInChain = nullptr,
+                .binding = binding,
+                .visibility = WGPUShaderStage_Compute,
+                .buffer =
+                {
+                    .nextInChain = nullptr,
+                    .type = type,
+                    .hasDynamicOffset = false,
+                    .minBindingSize = 0
+                },
+                .sampler =
+                {
+                    .nextInChain = nullptr,
+                    .type = WGPUSamplerBindingType_Undefined
+                },
+                .texture =
+                {
+                    .nextInChain = nullptr,
+                    .sampleType = WGPUTextureSampleType_Undefined,
+                    .viewDimension = WGPUTextureViewDimension_Undefined,
+                    .multisampled = false
+                },
+                .storageTexture =
+                {
+                    .nextInChain = nullptr,
+                    .access = WGPUStorageTextureAccess_Undefined,
+                    .format = WGPUTextureFormat_Undefined,
+                    .viewDimension = WGPUTextureViewDimension_Undefined
+                }
+            };
+        };
+
+        // Both entry points share one explicit layout and bind group
+        std::array const layout_entries
+        {
+            layout_entry(0, WGPUBufferBindingType_Uniform),
+            layout_entry(1, WGPUBufferBindingType_ReadOnlyStorage),
+            layout_entry(2, WGPUBufferBindingType_Storage),
+            layout_entry(3, WGPUBufferBindingType_Storage),
+            layout_entry(4, WGPUBufferBindingType_Storage),
+            layout_entry(5, WGPUBufferBindingType_ReadOnlyStorage),
+            layout_entry(6, WGPUBufferBindingType_Storage)
+        };
+
+        WGPUBindGroupLayoutDescriptor const bind_group_layout_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "CullBindGroupLayout",
+            .entryCount = layout_entries.size(),
+            .entries = layout_entries.data()
+        };
+
+        auto const bind_group_layout =
+            wgpuDeviceCreateBindGroupLayout(m_device, &bind_group_layout_descriptor);
+
+        WGPUPipelineLayoutDescriptor const pipeline_layout_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "CullPipelineLayout",
+            .bindGroupLayoutCount = 1,
+            .bindGroupLayouts = &bind_group_layout
+        };
+
+        auto const pipeline_layout =
+            wgpuDeviceCreatePipelineLayout(m_device, &pipeline_layout_descriptor);
+
+        auto const create_pipeline = [&](char const * label, char const * entry_point)
+        {
+            WGPUComputePipelineDescriptor const descriptor =
+            {
+                .nextInChain = nullptr,
+                .label = label,
+                .layout = pipeline_layout,
+                .compute =
+                {
+                    .nextInChain = nullptr,
+                    .module = module,
+                    .entryPoint = entry_point,
+                    .constantCount = 0,
+                    .constants = nullptr
+                }
+            };
+
+            return wgpuDeviceCreateComputePipeline(m_device, &descriptor);
+        };
+
+        m_cull_pipeline = create_pipeline("CullPipeline", "cs_cull");
+        m_finish_pipeline = create_pipeline("CullFinishPipeline", "cs_finish");
+
+        wgpuPipelineLayoutRelease(pipeline_layout);
+        wgpuShaderModuleRelease(module);
+
+        if(!m_cull_pipeline || !m_finish_pipeline)
+        {
+            wgpuBindGroupLayoutRelease(bind_group_layout);
+            throw std::runtime_error{"Culling pipeline creation failed"};
+        }
+
+        auto const bind_group_entry = [](
+            std::uint32_t binding, WGPUBuffer buffer, std::uint64_t size)
+        {
+            return WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = binding,
+                .buffer = buffer,
+                .offset = 0,
+                .size = size,
+                .sampler = nullptr,
+                .textureView = nullptr
+            };
+        };
+
+        auto const transforms_size = std::uint64_t{m_instance_count} * sizeof(glm::mat4);
+        std::array const bind_group_entries
+        {
+            bind_group_entry(0, m_parameters, sizeof(cull_parameters)),
+            bind_group_entry(1, m_world, transforms_size),
+            bind_group_entry(2, visible_transforms, transforms_size),
+            bind_group_entry(3, m_visible_count, sizeof(std::uint32_t)),
+            bind_group_entry(4, m_arguments, m_draw_count * sizeof(draw_arguments)),
+            bind_group_entry(5, m_weight_rows, weight_rows_size()),
+            bind_group_entry(6, visible_weight_rows, weight_rows_size())
+        };
+
+        WGPUBindGroupDescriptor const bind_group_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "CullBindGroup",
+            .layout = bind_group_layout,
+            .entryCount = bind_group_entries.size(),
+            .entries = bind_group_entries.data()
+        };
+
+        m_bind_group = wgpuDeviceCreateBindGroup(m_device, &bind_group_descriptor);
+        wgpuBindGroupLayoutRelease(bind_group_layout);
+    }
+
+    WGPUDevice m_device;
+    gpu_memory & m_memory;
+    std::uint32_t m_instance_count;
+    float m_bounding_radius;
+    std::uint32_t m_copies_weight_rows;
+    std::uint32_t m_draw_count;
+
+    WGPUBuffer m_world = nullptr;
+    WGPUBuffer m_weight_rows = nullptr;
+    WGPUBuffer m_unused_weight_rows = nullptr;
+    WGPUBuffer m_parameters = nullptr;
+    WGPUBuffer m_visible_count = nullptr;
+    WGPUBuffer m_arguments = nullptr;
+    WGPUComputePipeline m_cull_pipeline = nullptr;
+    WGPUComputePipeline m_finish_pipeline = nullptr;
+    WGPUBindGroup m_bind_group = nullptr;
+}; /* class gpu_culling */
+
+#endif /* SDL_WEBGPU_DEMO_GPU_CULLING_HPP */
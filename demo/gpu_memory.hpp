@@ -0,0 +1,406 @@
+#ifndef SDL_WEBGPU_DEMO_GPU_MEMORY_HPP
+#define SDL_WEBGPU_DEMO_GPU_MEMORY_HPP
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class memory_category
+{
+    vertex,
+    index,
+    uniform,
+    storage,
+    staging,
+    readback,
+    query,
+    texture,
+    render_target,
+    other
+};
+
+constexpr char const * memory_category_name(memory_category category)
+{
+    switch(category)
+    {
+        case memory_category::vertex: return "vertex";
+        case memory_category::index: return "index";
+        case memory_category::uniform: return "uniform";
+        case memory_category::storage: return "storage";
+        case memory_category::staging: return "staging";
+        case memory_category::readback: return "readback";
+        case memory_category::query: return "query";
+        case memory_category::texture: return "texture";
+        case memory_category::render_target: return "render target";
+        case memory_category::other: return "other";
+    }
+
+    return "unknown";
+}
+
+enum class budget_policy
+{
+    warn,
+    refuse
+};
+
+constexpr char const * budget_policy_name(budget_policy policy)
+{
+    switch(policy)
+    {
+        case budget_policy::warn: return "warn";
+        case budget_policy::refuse: return "refuse";
+    }
+
+    return "unknown";
+}
+
+inline bool parse_budget_policy(std::string_view name, budget_policy & policy)
+{
+    for(auto const candidate: { budget_policy::warn, budget_policy::refuse })
+    {
+        if(name == budget_policy_name(candidate))
+        {
+            policy = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Accounts for every buffer and texture created through it, by label and
+ * by category, and checks new allocations against an optional budget.
+ * Sizes are the requested sizes; the implementation may round up or add
+ * metadata, so the numbers are a lower bound of the real footprint.
+ * Textures owned by the swap chain are not included.
+ *
+ * The release functions assume they drop the last reference.
+ */
+class gpu_memory
+{
+    public:
+    static constexpr std::uint64_t no_budget = 0u;
+
+    void set_budget(std::uint64_t budget_bytes, budget_policy policy)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_budget = budget_bytes;
+        m_policy = policy;
+    }
+
+    WGPUBuffer create_buffer(WGPUDevice device, WGPUBufferDescriptor const & descriptor)
+    {
+        auto const category = classify_buffer(descriptor);
+        reserve(descriptor.label, descriptor.size);
+
+        auto const buffer = wgpuDeviceCreateBuffer(device, &descriptor);
+
+        if(buffer)
+        {
+            track(buffer, descriptor.label, category, descriptor.size);
+        }
+
+        return buffer;
+    }
+
+    WGPUTexture create_texture(WGPUDevice device, WGPUTextureDescriptor const & descriptor)
+    {
+        auto const category = classify_texture(descriptor);
+        auto const size = texture_size(descriptor);
+        reserve(descriptor.label, size);
+
+        auto const texture = wgpuDeviceCreateTexture(device, &descriptor);
+
+        if(texture)
+        {
+            track(texture, descriptor.label, category, size);
+        }
+
+        return texture;
+    }
+
+    void release(WGPUBuffer buffer)
+    {
+        untrack(buffer);
+        wgpuBufferRelease(buffer);
+    }
+
+    void release(WGPUTexture texture)
+    {
+        untrack(texture);
+        wgpuTextureRelease(texture);
+    }
+
+    std::uint64_t current_bytes() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_total.current;
+    }
+
+    std::uint64_t peak_bytes() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_total.peak;
+    }
+
+    void report(std::ostream & out) const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        out <<
+            "GPU memory: " << m_total.current << " bytes current, " <<
+            m_total.peak << " bytes peak";
+        if(m_budget != no_budget)
+        {
+            out <<
+                ", budget " << m_budget << " bytes (" <<
+                budget_policy_name(m_policy) << ")";
+        }
+        out << '\n';
+
+        out << "By category:\n";
+        for(auto i = std::size_t{0}; i != m_categories.size(); ++i)
+        {
+            auto const & stats = m_categories[i];
+            if(stats.peak != 0u)
+            {
+                out <<
+                    " - " << memory_category_name(static_cast<memory_category>(i)) <<
+                    ": " << stats.current << " current, " << stats.peak << " peak\n";
+            }
+        }
+
+        auto labels = std::vector<std::pair<std::string const, stats_t> const *>{};
+        for(auto const & entry: m_labels)
+        {
+            labels.push_back(&entry);
+        }
+
+        std::sort(
+            labels.begin(), labels.end(),
+            [](auto const * a, auto const * b) { return a->second.peak > b->second.peak; });
+
+        out << "By label:\n";
+        for(auto const * entry: labels)
+        {
+            out <<
+                " - " << entry->first << ": " << entry->second.current <<
+                " current, " << entry->second.peak << " peak, " <<
+                entry->second.allocations << " allocations\n";
+        }
+    }
+
+    static memory_category classify_buffer(WGPUBufferDescriptor const & descriptor)
+    {
+        auto const usage = descriptor.usage;
+
+        if(usage & WGPUBufferUsage_MapRead) return memory_category::readback;
+        if(usage & WGPUBufferUsage_QueryResolve) return memory_category::query;
+        if(usage & WGPUBufferUsage_Vertex) return memory_category::vertex;
+        if(usage & WGPUBufferUsage_Index) return memory_category::index;
+        if(usage & WGPUBufferUsage_Uniform) return memory_category::uniform;
+        if(usage & WGPUBufferUsage_Storage) return memory_category::storage;
+        if(usage & (WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc))
+        {
+            return memory_category::staging;
+        }
+
+        return memory_category::other;
+    }
+
+    static memory_category classify_texture(WGPUTextureDescriptor const & descriptor)
+    {
+        return (descriptor.usage & WGPUTextureUsage_RenderAttachment) ?
+            memory_category::render_target : memory_category::texture;
+    }
+
+    /* Size of a texture with its full mip chain */
+    static std::uint64_t texture_size(WGPUTextureDescriptor const & descriptor)
+    {
+        auto const block = block_info(descriptor.format);
+        auto const layers = descriptor.dimension == WGPUTextureDimension_3D ?
+            1u : descriptor.size.depthOrArrayLayers;
+
+        auto width = descriptor.size.width;
+        auto height = descriptor.size.height;
+        auto depth = descriptor.dimension == WGPUTextureDimension_3D ?
+            descriptor.size.depthOrArrayLayers : 1u;
+        auto total = std::uint64_t{0};
+
+        for(auto level = 0u; level != std::max(descriptor.mipLevelCount, 1u); ++level)
+        {
+            auto const blocks_wide = (width + block.width - 1u) / block.width;
+            auto const blocks_high = (height + block.height - 1u) / block.height;
+            total += std::uint64_t{blocks_wide} * blocks_high * depth * block.bytes;
+
+            width = std::max(width / 2u, 1u);
+            height = std::max(height / 2u, 1u);
+            depth = std::max(depth / 2u, 1u);
+        }
+
+        return total * layers * std::max(descriptor.sampleCount, 1u);
+    }
+
+    private:
+    struct stats_t
+    {
+        std::uint64_t current = 0u;
+        std::uint64_t peak = 0u;
+        std::uint64_t allocations = 0u;
+
+        void add(std::uint64_t size)
+        {
+            current += size;
+            peak = std::max(peak, current);
+            ++allocations;
+        }
+    };
+
+    struct allocation_t
+    {
+        std::string label;
+        memory_category category;
+        std::uint64_t size;
+    };
+
+    struct block_info_t
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t bytes;
+    };
+
+    static block_info_t block_info(WGPUTextureFormat format)
+    {
+        switch(format)
+        {
+            case WGPUTextureFormat_R8Unorm:
+            case WGPUTextureFormat_R8Snorm:
+            case WGPUTextureFormat_R8Uint:
+            case WGPUTextureFormat_R8Sint:
+            case WGPUTextureFormat_Stencil8:
+                return { 1u, 1u, 1u };
+
+            case WGPUTextureFormat_RG8Unorm:
+            case WGPUTextureFormat_RG8Snorm:
+            case WGPUTextureFormat_R16Float:
+            case WGPUTextureFormat_Depth16Unorm:
+                return { 1u, 1u, 2u };
+
+            case WGPUTextureFormat_RGBA16Float:
+            case WGPUTextureFormat_RG32Float:
+            case WGPUTextureFormat_Depth32FloatStencil8:
+                return { 1u, 1u, 8u };
+
+            case WGPUTextureFormat_RGBA32Float:
+                return { 1u, 1u, 16u };
+
+            case WGPUTextureFormat_BC1RGBAUnorm:
+            case WGPUTextureFormat_BC1RGBAUnormSrgb:
+            case WGPUTextureFormat_ETC2RGB8Unorm:
+            case WGPUTextureFormat_ETC2RGB8UnormSrgb:
+                return { 4u, 4u, 8u };
+
+            case WGPUTextureFormat_BC3RGBAUnorm:
+            case WGPUTextureFormat_BC3RGBAUnormSrgb:
+            case WGPUTextureFormat_BC7RGBAUnorm:
+            case WGPUTextureFormat_BC7RGBAUnormSrgb:
+            case WGPUTextureFormat_ETC2RGBA8Unorm:
+            case WGPUTextureFormat_ETC2RGBA8UnormSrgb:
+            case WGPUTextureFormat_ASTC4x4Unorm:
+            case WGPUTextureFormat_ASTC4x4UnormSrgb:
+                return { 4u, 4u, 16u };
+
+            default:
+                return { 1u, 1u, 4u };
+        }
+    }
+
+    /* Applies the budget policy before an allocation of size bytes */
+    void reserve(char const * label, std::uint64_t size)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        if(m_budget == no_budget || m_total.current + size <= m_budget)
+        {
+            return;
+        }
+
+        auto const message =
+            "GPU memory budget exceeded by " + std::string{label ? label : "(unlabeled)"} +
+            ": " + std::to_string(m_total.current) + " + " + std::to_string(size) +
+            " > " + std::to_string(m_budget) + " bytes";
+
+        if(m_policy == budget_policy::refuse)
+        {
+            throw std::runtime_error{message};
+        }
+
+        // Warn once per crossing, not on every allocation above the budget
+        if(!m_over_budget)
+        {
+            std::cerr << message << '\n';
+            m_over_budget = true;
+        }
+    }
+
+    void track(
+        void const * handle,
+        char const * label,
+        memory_category category,
+        std::uint64_t size)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        auto name = std::string{label ? label : "(unlabeled)"};
+        m_labels[name].add(size);
+        m_categories[static_cast<std::size_t>(category)].add(size);
+        m_total.add(size);
+        m_allocations[handle] = allocation_t{ std::move(name), category, size };
+    }
+
+    void untrack(void const * handle)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+
+        auto const it = m_allocations.find(handle);
+        if(it == m_allocations.end())
+        {
+            return;
+        }
+
+        auto const & allocation = it->second;
+        m_labels[allocation.label].current -= allocation.size;
+        m_categories[static_cast<std::size_t>(allocation.category)].current -= allocation.size;
+        m_total.current -= allocation.size;
+        m_allocations.erase(it);
+
+        if(m_total.current <= m_budget)
+        {
+            m_over_budget = false;
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    std::uint64_t m_budget = no_budget;
+    budget_policy m_policy = budget_policy::warn;
+    bool m_over_budget = false;
+    stats_t m_total;
+    std::array<stats_t, static_cast<std::size_t>(memory_category::other) + 1u> m_categories{};
+    std::map<std::string, stats_t> m_labels;
+    std::unordered_map<void const *, allocation_t> m_allocations;
+}; /* class gpu_memory */
+
+#endif /* SDL_WEBGPU_DEMO_GPU_MEMORY_HPP */
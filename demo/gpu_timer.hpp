@@ -0,0 +1,316 @@
+#ifndef SDL_WEBGPU_DEMO_GPU_TIMER_HPP
+#define SDL_WEBGPU_DEMO_GPU_TIMER_HPP
+
+#include "gpu_memory.hpp"
+#include "trace.hpp"
+#include "wgpu_sync.hpp"
+
+#include <webgpu/webgpu.h>
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+
+/*
+ * Measures how long the GPU spends on a frame. With the TimestampQuery
+ * feature the timed render pass writes timestamps at its beginning and end,
+ * which are resolved and read back asynchronously. Without it, the time from
+ * submission until the queue reports the work done is used instead; that
+ * includes some scheduling latency but still follows the GPU load.
+ *
+ * Several frames can be in flight, each with its own slot, so reading a
+ * result never stalls the frame that produced it. A frame that finds every
+ * slot busy is simply not timed.
+ */
+class gpu_timer
+{
+    public:
+    static constexpr std::uint32_t slot_count = 4u;
+
+    gpu_timer(
+        WGPUDevice device,
+        WGPUQueue queue,
+        gpu_memory & memory,
+        bool use_timestamps) :
+        m_device(device),
+        m_queue(queue),
+        m_memory(memory),
+        m_use_timestamps(use_timestamps)
+    {
+        for(auto i = 0u; i != slot_count; ++i)
+        {
+            m_slots[i].owner = this;
+            m_slots[i].index = i;
+        }
+
+        if(!m_use_timestamps)
+        {
+            return;
+        }
+
+        WGPUQuerySetDescriptor const query_set_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "FrameTimestamps",
+            .type = WGPUQueryType_Timestamp,
+            .count = slot_count * 2u,
+            .pipelineStatistics = nullptr,
+            .pipelineStatisticsCount = 0u
+        };
+
+        m_query_set = wgpuDeviceCreateQuerySet(m_device, &query_set_descriptor);
+
+        WGPUBufferDescriptor const resolve_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "FrameTimestampResolve",
+            .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+            .size = slot_count * resolve_alignment,
+            .mappedAtCreation = false
+        };
+
+        m_resolve_buffer = m_memory.create_buffer(m_device, resolve_descriptor);
+
+        for(auto & slot: m_slots)
+        {
+            WGPUBufferDescriptor const readback_descriptor =
+            {
+                .nextInChain = nullptr,
+                .label = "FrameTimestampReadback",
+                .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+                .size = timestamp_pair_size,
+                .mappedAtCreation = false
+            };
+
+            slot.readback = m_memory.create_buffer(m_device, readback_descriptor);
+        }
+
+        if(!m_query_set || !m_resolve_buffer)
+        {
+            release();
+            m_use_timestamps = false;
+        }
+    }
+
+    ~gpu_timer()
+    {
+        auto const pending = std::any_of(
+            m_slots.begin(), m_slots.end(),
+            [](auto const & slot) { return slot.pending; });
+
+        if(pending && !m_use_timestamps)
+        {
+            // Work done callbacks point into this object
+            wait_for_submitted_work(m_device, m_queue);
+        }
+
+        release();
+    }
+
+    gpu_timer(gpu_timer const &) = delete;
+    gpu_timer & operator=(gpu_timer const &) = delete;
+
+    bool uses_timestamps() const
+    {
+        return m_use_timestamps;
+    }
+
+    /* Submitted frames whose measurement has not arrived yet */
+    std::uint32_t frames_in_flight() const
+    {
+        return static_cast<std::uint32_t>(std::count_if(
+            m_slots.begin(), m_slots.end(),
+            [](auto const & slot) { return slot.pending; }));
+    }
+
+    /* Picks a slot for the frame being recorded */
+    void begin_frame()
+    {
+        auto const free_slot = std::find_if(
+            m_slots.begin(), m_slots.end(),
+            [](auto const & slot) { return !slot.pending; });
+
+        m_current = free_slot == m_slots.end() ? nullptr : &*free_slot;
+
+        if(m_current && m_use_timestamps)
+        {
+            auto const first_query = m_current->index * 2u;
+            m_timestamp_writes =
+            {
+                WGPURenderPassTimestampWrite
+                {
+                    .querySet = m_query_set,
+                    .queryIndex = first_query,
+                    .location = WGPURenderPassTimestampLocation_Beginning
+                },
+                WGPURenderPassTimestampWrite
+                {
+                    .querySet = m_query_set,
+                    .queryIndex = first_query + 1u,
+                    .location = WGPURenderPassTimestampLocation_End
+                }
+            };
+        }
+    }
+
+    /* Timestamp writes for the timed render pass of the current frame */
+    std::span<WGPURenderPassTimestampWrite const> pass_timestamp_writes() const
+    {
+        if(!m_current || !m_use_timestamps)
+        {
+            return {};
+        }
+
+        return m_timestamp_writes;
+    }
+
+    /* Records the copy of this frame's timestamps, after the timed pass */
+    void resolve(WGPUCommandEncoder encoder)
+    {
+        if(!m_current || !m_use_timestamps)
+        {
+            return;
+        }
+
+        auto const resolve_offset = m_current->index * resolve_alignment;
+
+        wgpuCommandEncoderResolveQuerySet(
+            encoder, m_query_set, m_current->index * 2u, 2u,
+            m_resolve_buffer, resolve_offset);
+        wgpuCommandEncoderCopyBufferToBuffer(
+            encoder, m_resolve_buffer, resolve_offset,
+            m_current->readback, 0u, timestamp_pair_size);
+    }
+
+    /* Starts the readback, call right after submitting the frame */
+    void submitted()
+    {
+        if(!m_current)
+        {
+            return;
+        }
+
+        auto & slot = *m_current;
+        slot.pending = true;
+        m_current = nullptr;
+
+        if(m_use_timestamps)
+        {
+            wgpuBufferMapAsync(
+                slot.readback, WGPUMapMode_Read, 0u, timestamp_pair_size,
+                &gpu_timer::on_readback_mapped, &slot);
+        }
+        else
+        {
+            slot.submit_time = SDL_GetPerformanceCounter();
+            slot.submit_ns = trace::enabled() ? trace::now_ns() : 0;
+            wgpuQueueOnSubmittedWorkDone(
+                m_queue, 0u, &gpu_timer::on_work_done, &slot);
+        }
+    }
+
+    /* The newest measurement in milliseconds, if one arrived since last call */
+    std::optional<double> take_sample()
+    {
+        auto const sample = m_sample;
+        m_sample.reset();
+        return sample;
+    }
+
+    private:
+    struct slot_t
+    {
+        gpu_timer * owner = nullptr;
+        std::uint32_t index = 0u;
+        WGPUBuffer readback = nullptr;
+        std::uint64_t submit_time = 0u;
+        std::int64_t submit_ns = 0;
+        bool pending = false;
+    };
+
+    static void on_readback_mapped(WGPUBufferMapAsyncStatus status, void * user_data)
+    {
+        WEBGPU_SDL_TRACE_SCOPE("timestamp readback");
+        auto & slot = *reinterpret_cast<slot_t *>(user_data);
+
+        if(status == WGPUBufferMapAsyncStatus_Success)
+        {
+            std::uint64_t timestamps[2];
+            std::memcpy(
+                timestamps,
+                wgpuBufferGetConstMappedRange(slot.readback, 0u, timestamp_pair_size),
+                sizeof(timestamps));
+            wgpuBufferUnmap(slot.readback);
+
+            // Timestamps are in nanoseconds; reordered values are discarded
+            if(timestamps[1] > timestamps[0])
+            {
+                slot.owner->m_sample =
+                    static_cast<double>(timestamps[1] - timestamps[0]) * 1.0e-6;
+            }
+        }
+
+        slot.pending = false;
+    }
+
+    static void on_work_done(WGPUQueueWorkDoneStatus status, void * user_data)
+    {
+        auto & slot = *reinterpret_cast<slot_t *>(user_data);
+        trace::complete("gpu work", slot.submit_ns, trace::now_ns());
+
+        if(status == WGPUQueueWorkDoneStatus_Success)
+        {
+            slot.owner->m_sample =
+                1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - slot.submit_time) /
+                static_cast<double>(SDL_GetPerformanceFrequency());
+        }
+
+        slot.pending = false;
+    }
+
+    void release()
+    {
+        for(auto & slot: m_slots)
+        {
+            if(slot.readback)
+            {
+                // Destroying fires any pending map callback while we still exist
+                wgpuBufferDestroy(slot.readback);
+                m_memory.release(slot.readback);
+                slot.readback = nullptr;
+            }
+        }
+
+        if(m_resolve_buffer)
+        {
+            m_memory.release(m_resolve_buffer);
+            m_resolve_buffer = nullptr;
+        }
+
+        if(m_query_set)
+        {
+            wgpuQuerySetRelease(m_query_set);
+            m_query_set = nullptr;
+        }
+    }
+
+    static constexpr std::uint64_t timestamp_pair_size = 2u * sizeof(std::uint64_t);
+    static constexpr std::uint64_t resolve_alignment = 256u;
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    gpu_memory & m_memory;
+    bool m_use_timestamps;
+    WGPUQuerySet m_query_set = nullptr;
+    WGPUBuffer m_resolve_buffer = nullptr;
+    std::array<slot_t, slot_count> m_slots{};
+    std::array<WGPURenderPassTimestampWrite, 2> m_timestamp_writes{};
+    slot_t * m_current = nullptr;
+    std::optional<double> m_sample;
+}; /* class gpu_timer */
+
+#endif /* SDL_WEBGPU_DEMO_GPU_TIMER_HPP */
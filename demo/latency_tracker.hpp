@@ -0,0 +1,267 @@
+#ifndef SDL_WEBGPU_DEMO_LATENCY_TRACKER_HPP
+#define SDL_WEBGPU_DEMO_LATENCY_TRACKER_HPP
+
+#include "trace.hpp"
+
+#include <webgpu/webgpu.h>
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+/* Keeps the most recent samples and reports percentiles over them */
+class latency_distribution
+{
+    public:
+    static constexpr std::size_t capacity = 4096u;
+
+    void add(double ms)
+    {
+        if(m_samples.size() < capacity)
+        {
+            m_samples.push_back(ms);
+        }
+        else
+        {
+            m_samples[m_count % capacity] = ms;
+        }
+
+        ++m_count;
+    }
+
+    /* Every sample ever added, including the ones no longer kept */
+    std::uint64_t count() const
+    {
+        return m_count;
+    }
+
+    /* Nearest rank percentile, p in [0, 100] */
+    double percentile(double p) const
+    {
+        if(m_samples.empty())
+        {
+            return 0.0;
+        }
+
+        auto sorted = m_samples;
+        auto const rank = static_cast<std::size_t>(
+            p / 100.0 * static_cast<double>(sorted.size() - 1u) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    private:
+    std::vector<double> m_samples;
+    std::uint64_t m_count = 0u;
+}; /* class latency_distribution */
+
+/*
+ * Measures how long an input event takes to reach the screen. Every frame
+ * that consumes input is tagged with the time of the newest input event
+ * since the previous frame. From there the tracker records when the frame
+ * was submitted, when wgpuSwapChainPresent returned and when the queue
+ * reported the frame's work done. A frame is on screen once it has been
+ * presented and its work is done, which is the end to end latency.
+ *
+ * SDL stamps events in milliseconds; the age of an event is converted to
+ * the trace clock when it is seen, so the input time is accurate to about
+ * a millisecond, the rest to the resolution of the trace clock.
+ *
+ * Work done callbacks point into the tracker, so it has to outlive the
+ * device they were registered on.
+ */
+class latency_tracker
+{
+    public:
+    static constexpr std::uint32_t slot_count = 8u;
+
+    latency_tracker()
+    {
+        for(auto & slot: m_slots)
+        {
+            slot.owner = this;
+        }
+    }
+
+    latency_tracker(latency_tracker const &) = delete;
+    latency_tracker & operator=(latency_tracker const &) = delete;
+
+    /* Call for every SDL event; everything but user input is ignored */
+    void input_event(SDL_Event const & event)
+    {
+        if(!is_input(event.type))
+        {
+            return;
+        }
+
+        auto const age_ms = std::min<std::uint32_t>(
+            SDL_GetTicks() - event.common.timestamp, 1000u);
+        auto const input_ns =
+            trace::now_ns() - static_cast<std::int64_t>(age_ms) * 1000000;
+
+        m_pending_input_ns = std::max(m_pending_input_ns, input_ns);
+    }
+
+    /* Call right after the frame is submitted */
+    void frame_submitted(WGPUQueue queue)
+    {
+        m_current = nullptr;
+
+        if(m_pending_input_ns == no_input)
+        {
+            return;
+        }
+
+        auto const free_slot = std::find_if(
+            m_slots.begin(), m_slots.end(),
+            [](auto const & slot) { return !slot.pending; });
+
+        if(free_slot == m_slots.end())
+        {
+            return;
+        }
+
+        auto & slot = *free_slot;
+        slot.input_ns = std::exchange(m_pending_input_ns, no_input);
+        slot.present_ns = no_input;
+        slot.done_ns = no_input;
+        slot.pending = true;
+        m_current = &slot;
+
+        m_to_submit.add(milliseconds(trace::now_ns() - slot.input_ns));
+
+        wgpuQueueOnSubmittedWorkDone(queue, 0u, &latency_tracker::on_work_done, &slot);
+    }
+
+    /* Call right after presenting the frame that was submitted last */
+    void frame_presented()
+    {
+        if(!m_current)
+        {
+            return;
+        }
+
+        auto & slot = *std::exchange(m_current, nullptr);
+        slot.present_ns = trace::now_ns();
+        m_to_present.add(milliseconds(slot.present_ns - slot.input_ns));
+
+        if(slot.done_ns != no_input)
+        {
+            displayed(slot);
+        }
+    }
+
+    void report(std::ostream & out) const
+    {
+        if(m_to_submit.count() == 0u)
+        {
+            out << "Input latency: no frame consumed input\n";
+            return;
+        }
+
+        out <<
+            "Input latency over " << m_to_submit.count() <<
+            " frames (ms, p50 / p90 / p99 / max):\n";
+
+        auto const print = [&out](char const * name, latency_distribution const & d)
+        {
+            out <<
+                " - " << name << ": " << std::fixed << std::setprecision(2) <<
+                d.percentile(50.0) << " / " << d.percentile(90.0) << " / " <<
+                d.percentile(99.0) << " / " << d.percentile(100.0) <<
+                std::defaultfloat << '\n';
+        };
+
+        print("input to submit", m_to_submit);
+        print("input to present", m_to_present);
+        print("input to GPU done", m_to_gpu_done);
+        print("input to display", m_to_display);
+    }
+
+    private:
+    static constexpr std::int64_t no_input = std::numeric_limits<std::int64_t>::min();
+
+    struct slot_t
+    {
+        latency_tracker * owner = nullptr;
+        std::int64_t input_ns = no_input;
+        std::int64_t present_ns = no_input;
+        std::int64_t done_ns = no_input;
+        bool pending = false;
+    };
+
+    static bool is_input(std::uint32_t type)
+    {
+        switch(type)
+        {
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+            case SDL_TEXTINPUT:
+            case SDL_MOUSEMOTION:
+            case SDL_MOUSEBUTTONDOWN:
+            case SDL_MOUSEBUTTONUP:
+            case SDL_MOUSEWHEEL:
+            case SDL_FINGERDOWN:
+            case SDL_FINGERUP:
+            case SDL_FINGERMOTION:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static double milliseconds(std::int64_t ns)
+    {
+        return static_cast<double>(ns) * 1.0e-6;
+    }
+
+    static void on_work_done(WGPUQueueWorkDoneStatus status, void * user_data)
+    {
+        auto & slot = *reinterpret_cast<slot_t *>(user_data);
+        auto & tracker = *slot.owner;
+
+        // Frames of a lost device never reach the screen
+        if(status != WGPUQueueWorkDoneStatus_Success)
+        {
+            if(tracker.m_current == &slot)
+            {
+                tracker.m_current = nullptr;
+            }
+            slot.pending = false;
+            return;
+        }
+
+        slot.done_ns = trace::now_ns();
+        tracker.m_to_gpu_done.add(milliseconds(slot.done_ns - slot.input_ns));
+
+        if(slot.present_ns != no_input)
+        {
+            tracker.displayed(slot);
+        }
+    }
+
+    /* Both present and work done have happened */
+    void displayed(slot_t & slot)
+    {
+        auto const end_ns = std::max(slot.present_ns, slot.done_ns);
+        m_to_display.add(milliseconds(end_ns - slot.input_ns));
+        trace::complete("input to display", slot.input_ns, end_ns);
+        slot.pending = false;
+    }
+
+    std::array<slot_t, slot_count> m_slots{};
+    slot_t * m_current = nullptr;
+    std::int64_t m_pending_input_ns = no_input;
+    latency_distribution m_to_submit;
+    latency_distribution m_to_present;
+    latency_distribution m_to_gpu_done;
+    latency_distribution m_to_display;
+}; /* class latency_tracker */
+
+#endif /* SDL_WEBGPU_DEMO_LATENCY_TRACKER_HPP */
@@ -1,19 +1,60 @@
 #include "SDL_webgpu.h"
+#include "adapter_selection.hpp"
+#include "device_limits.hpp"
+#include "device_recovery.hpp"
+#include "dynamic_resolution.hpp"
+#include "file_watcher.hpp"
+#include "frame_scheduler.hpp"
+#include "frustum_culling.hpp"
+#include "gpu_culling.hpp"
+#include "gpu_memory.hpp"
+#include "gpu_timer.hpp"
+#include "latency_tracker.hpp"
+#include "occlusion_culling.hpp"
+#include "performance_hud.hpp"
+#include "present_mode.hpp"
+#include "render_pass_state.hpp"
+#include "render_queue.hpp"
+#include "staging_belt.hpp"
+#include "surface_format.hpp"
+#include "telemetry.hpp"
+#include "texture_loader.hpp"
+#include "transform_hierarchy.hpp"
+#include "trace.hpp"
+#include "vertex_encoding.hpp"
+#include "wgpu_sync.hpp"
 #include <SDL2/SDL_main.h>
 
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+#include <webgpu_mock.hpp>
+#endif
+
 #include <webgpu/webgpu.h>
 #include <SDL2/SDL.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
 #include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
 #include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <span>
+#include <sstream>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace
@@ -126,6 +167,17 @@ constexpr std::ostream & operator<<(std::ostream & stream, WGPUFeatureName featu
     }
 }
 
+constexpr telemetry::present_mode_id telemetry_present_mode(WGPUPresentMode mode)
+{
+    switch(mode)
+    {
+        case WGPUPresentMode_Fifo: return telemetry::present_mode_id::fifo;
+        case WGPUPresentMode_Mailbox: return telemetry::present_mode_id::mailbox;
+        case WGPUPresentMode_Immediate: return telemetry::present_mode_id::immediate;
+        default: return telemetry::present_mode_id::unknown;
+    }
+}
+
 std::ostream & operator<<(std::ostream & stream, WGPULimits const & limits)
 {
 #define WEBGPU_SDL_STREAM_ONE_LIMIT_ITEM(item) (stream << " - " #item << ": " << limits.item << '\n')
@@ -205,73 +257,21 @@ struct wgpu_app
             throw std::runtime_error{"SDL_Webgpu_CreateSurface failed"};
         }
 
-        WGPURequestAdapterOptions const adapter_options =
-        {
-            .nextInChain = nullptr,
-            .compatibleSurface = wgpu_surface,
-            .powerPreference = WGPUPowerPreference_Undefined,
-            .backendType = WGPUBackendType_Undefined,
-            .forceFallbackAdapter = false,
-            .compatibilityMode = false,
-        };
-
-        wgpu_adapter = requestAdapter(wgpu_instance, adapter_options);
+        wgpu_adapter = adapter_selector{wgpu_instance, wgpu_surface}.select();
 
         if(!wgpu_adapter)
         {
             throw std::runtime_error{"wgpuInstanceRequestAdapter failed"};
         }
 
-        WGPUDeviceDescriptor const device_descriptor =
-        {
-            .nextInChain = nullptr,
-            .label = "Device",
-            .requiredFeaturesCount = 0u,
-            .requiredFeatures = nullptr,
-            .requiredLimits = &required_device_limits,
-            .defaultQueue = { .nextInChain = nullptr, .label = "Queue" },
-            .deviceLostCallback = nullptr,
-            .deviceLostUserdata = nullptr
-        };
-
-        wgpu_device = requestDevice(wgpu_adapter, device_descriptor);
-
-        if(!wgpu_device)
-        {
-            throw std::runtime_error{"wgpuAdapterRequestDevice failed"};
-        }
-
-        wgpuDeviceSetDeviceLostCallback(wgpu_device, nullptr, nullptr);
-        wgpuDeviceSetUncapturedErrorCallback(
-            wgpu_device, &wgpu_app::wgpu_error_callback, this);
-
-        wgpu_queue = wgpuDeviceGetQueue(wgpu_device);
-
-        if(!wgpu_queue)
-        {
-            throw std::runtime_error{"WGPU Device has no command queue"};
-        }
-
-        WGPUSwapChainDescriptor const swap_chain_descriptor =
-        {
-            .nextInChain = nullptr,
-            .label = "SwapChain",
-            .usage = WGPUTextureUsage_RenderAttachment,
-            .format = WGPUTextureFormat_BGRA8Unorm,
-            .width = width,
-            .height = height,
-            .presentMode = WGPUPresentMode_Fifo
-        };
-
-        wgpu_swap_chain = wgpuDeviceCreateSwapChain(
-            wgpu_device, wgpu_surface, &swap_chain_descriptor);
+        surface_format = choose_surface_format(wgpu_surface, wgpu_adapter);
+        device_config = negotiate_device(wgpu_adapter);
+        create_device();
     }
 
     ~wgpu_app()
     {
-        wgpuSwapChainRelease(wgpu_swap_chain);
-        wgpuQueueRelease(wgpu_queue);
-        wgpuDeviceRelease(wgpu_device);
+        release_device();
         wgpuSurfaceRelease(wgpu_surface);
         wgpuAdapterRelease(wgpu_adapter);
         SDL_DestroyWindow(sdl_window);
@@ -284,6 +284,62 @@ struct wgpu_app
     wgpu_app & operator=(wgpu_app const &) = delete;
     wgpu_app & operator=(wgpu_app &&) = delete;
 
+    /*
+     * Replaces a lost device, its queue and the swap chain, using the same
+     * descriptors as at startup. If the adapter is gone as well (e.g. after
+     * a GPU switch), a new one is selected first.
+     */
+    void recover_device()
+    {
+        release_device();
+
+        if(try_create_device())
+        {
+            return;
+        }
+
+        wgpuAdapterRelease(wgpu_adapter);
+        wgpu_adapter = adapter_selector{wgpu_instance, wgpu_surface}.select();
+
+        if(!wgpu_adapter)
+        {
+            throw std::runtime_error{"No adapter available after device loss"};
+        }
+
+        surface_format = choose_surface_format(wgpu_surface, wgpu_adapter);
+        device_config = negotiate_device(wgpu_adapter);
+        create_device();
+    }
+
+    /*
+     * Recreates the swap chain with another present mode between frames.
+     * The new swap chain takes over the surface before the old one is
+     * released, so no frame is lost. Returns false and keeps the current
+     * swap chain and mode if the surface does not support the mode.
+     */
+    bool set_present_mode(WGPUPresentMode mode)
+    {
+        auto const swap_chain_desc = swap_chain_descriptor(mode);
+        wgpuDevicePushErrorScope(wgpu_device, WGPUErrorFilter_Validation);
+        auto const swap_chain = wgpuDeviceCreateSwapChain(
+            wgpu_device, wgpu_surface, &swap_chain_desc);
+        auto const error = pop_error_scope(wgpu_device);
+
+        if(!swap_chain || error != WGPUErrorType_NoError)
+        {
+            if(swap_chain)
+            {
+                wgpuSwapChainRelease(swap_chain);
+            }
+            return false;
+        }
+
+        wgpuSwapChainRelease(wgpu_swap_chain);
+        wgpu_swap_chain = swap_chain;
+        present_mode = mode;
+        return true;
+    }
+
     static constexpr float aspect_ratio()
     {
         return static_cast<float>(width) / static_cast<float>(height);
@@ -293,155 +349,164 @@ struct wgpu_app
         WGPUErrorType type, char const * message, void * user_data)
     {
         (void)user_data;
+        trace::instant("uncaptured error");
         std::cerr <<
             "Uncaught WGPU error(" << static_cast<int>(type) << "): " <<
             message << std::endl;
     }
 
-    static WGPUAdapter requestAdapter(
-        WGPUInstance instance, WGPURequestAdapterOptions const & opts)
-    {
-        struct user_data_t
-        {
-            WGPUAdapter adapter = nullptr;
-            bool request_complete = false;
-            std::mutex mutex;
-            std::condition_variable cv;
-        };
-
-        user_data_t user_data;
-        
-        auto const request_callback = [](
-            WGPURequestAdapterStatus status,
-            WGPUAdapter adapter,
-            char const * message,
-            void * p_user_data)
-        {
-            user_data_t * user_data =
-                reinterpret_cast<user_data_t *>(p_user_data);
-            std::unique_lock<std::mutex> lock{user_data->mutex};
+    static constexpr auto uniform_buffer_offset_alignment =
+        device_limits::uniform_buffer_offset_alignment;
 
-            if(status == WGPURequestAdapterStatus_Success)
-            {
-                user_data->adapter = adapter;
-            }
+    static constexpr int width = 800;
+    static constexpr int height = 600;
 
-            user_data->request_complete = true;
-            lock.unlock();
-            user_data->cv.notify_all();
+    WGPUSwapChainDescriptor swap_chain_descriptor(WGPUPresentMode mode) const
+    {
+        return
+        {
+            .nextInChain = nullptr,
+            .label = "SwapChain",
+            .usage = WGPUTextureUsage_RenderAttachment,
+            .format = surface_format,
+            .width = width,
+            .height = height,
+            .presentMode = mode
         };
+    }
 
-        wgpuInstanceRequestAdapter(
-            instance, &opts, request_callback, &user_data);
-
-        std::unique_lock<std::mutex> lock{user_data.mutex};
-        user_data.cv.wait(lock, [&user_data] { return user_data.request_complete; });
+    WGPUInstance wgpu_instance = nullptr;
+    SDL_Window * sdl_window = nullptr;
+    WGPUAdapter wgpu_adapter = nullptr;
+    WGPUSurface wgpu_surface = nullptr;
+    WGPUDevice wgpu_device = nullptr;
+    WGPUQueue wgpu_queue = nullptr;
+    WGPUSwapChain wgpu_swap_chain = nullptr;
+    WGPUTextureFormat surface_format = WGPUTextureFormat_Undefined;
+    WGPUPresentMode present_mode = WGPUPresentMode_Fifo;
+    negotiated_device device_config;
+    gpu_memory memory;
+    pipeline_blob_cache pipeline_cache{"sdl-webgpu-demo"};
+    device_loss_monitor device_loss;
 
-        return user_data.adapter;
+    private:
+    void create_device()
+    {
+        if(!try_create_device())
+        {
+            throw std::runtime_error{"wgpuAdapterRequestDevice failed"};
+        }
     }
 
-    static WGPUDevice requestDevice(
-        WGPUAdapter adapter, WGPUDeviceDescriptor const & desc)
+    bool try_create_device()
     {
-        struct user_data_t
+        WGPUDeviceDescriptor const device_descriptor =
         {
-            WGPUDevice device = nullptr;
-            bool request_complete = false;
-            std::mutex mutex;
-            std::condition_variable cv;
+            .nextInChain = pipeline_cache.chain(),
+            .label = "Device",
+            .requiredFeaturesCount = device_config.features.size(),
+            .requiredFeatures = device_config.features.data(),
+            .requiredLimits = &device_config.required_limits,
+            .defaultQueue = { .nextInChain = nullptr, .label = "Queue" },
+            .deviceLostCallback = nullptr,
+            .deviceLostUserdata = nullptr
         };
 
-        user_data_t user_data;
+        wgpu_device = request_device(wgpu_adapter, device_descriptor);
 
-        auto const request_callback = [](
-            WGPURequestDeviceStatus status,
-            WGPUDevice device,
-            char const * message,
-            void * p_user_data)
+        if(!wgpu_device)
         {
-            user_data_t * user_data = reinterpret_cast<user_data_t *>(p_user_data);
-            std::unique_lock<std::mutex> lock{user_data->mutex};
+            return false;
+        }
 
-            if(status == WGPURequestDeviceStatus_Success)
-            {
-                user_data->device = device;
-            }
+        device_loss.attach(wgpu_device);
+        wgpuDeviceSetUncapturedErrorCallback(
+            wgpu_device, &wgpu_app::wgpu_error_callback, this);
 
-            user_data->request_complete = true;
-            lock.unlock();
-            user_data->cv.notify_all();
-        };
+        wgpu_queue = wgpuDeviceGetQueue(wgpu_device);
 
-        wgpuAdapterRequestDevice(
-            adapter, &desc, request_callback, &user_data);
+        if(!wgpu_queue)
+        {
+            throw std::runtime_error{"WGPU Device has no command queue"};
+        }
 
-        std::unique_lock<std::mutex> lock{user_data.mutex};
-        user_data.cv.wait(lock, [&user_data] { return user_data.request_complete; });
+        auto const swap_chain_desc = swap_chain_descriptor(present_mode);
+        wgpu_swap_chain = wgpuDeviceCreateSwapChain(
+            wgpu_device, wgpu_surface, &swap_chain_desc);
 
-        return user_data.device;
+        return true;
     }
 
-    static constexpr auto uniform_buffer_offset_alignment = 256u;
-    static constexpr WGPURequiredLimits required_device_limits
+    void release_device()
     {
-        .nextInChain = nullptr,
-        .limits =
-        {
-            .maxTextureDimension1D = 0,
-            .maxTextureDimension2D = 0,
-            .maxTextureDimension3D = 0,
-            .maxTextureArrayLayers = 0,
-            .maxBindGroups = 1,
-            .maxBindGroupsPlusVertexBuffers = 4,
-            .maxBindingsPerBindGroup = 4,
-            .maxDynamicUniformBuffersPerPipelineLayout = 2,
-            .maxDynamicStorageBuffersPerPipelineLayout = 0,
-            .maxSampledTexturesPerShaderStage = 0,
-            .maxSamplersPerShaderStage = 0,
-            .maxStorageBuffersPerShaderStage = 0,
-            .maxStorageTexturesPerShaderStage = 0,
-            .maxUniformBuffersPerShaderStage = 4,
-            .maxUniformBufferBindingSize = 4096,
-            .maxStorageBufferBindingSize = 0,
-            .minUniformBufferOffsetAlignment = uniform_buffer_offset_alignment,
-            .minStorageBufferOffsetAlignment = 1024,
-            .maxVertexBuffers = 4,
-            .maxBufferSize = 1024*1024,
-            .maxVertexAttributes = 4,
-            .maxVertexBufferArrayStride = 512,
-            .maxInterStageShaderComponents = 16,
-            .maxInterStageShaderVariables = 8,
-            .maxColorAttachments = 1,
-            .maxColorAttachmentBytesPerSample = 16,
-            .maxComputeWorkgroupStorageSize = 0,
-            .maxComputeInvocationsPerWorkgroup = 0,
-            .maxComputeWorkgroupSizeX = 0,
-            .maxComputeWorkgroupSizeY = 0,
-            .maxComputeWorkgroupSizeZ = 0,
-            .maxComputeWorkgroupsPerDimension = 0,
+        if(wgpu_swap_chain)
+        {
+            wgpuSwapChainRelease(wgpu_swap_chain);
+            wgpu_swap_chain = nullptr;
         }
-    };
 
-    static constexpr int width = 800;
-    static constexpr int height = 600;
+        if(wgpu_queue)
+        {
+            wgpuQueueRelease(wgpu_queue);
+            wgpu_queue = nullptr;
+        }
 
-    WGPUInstance wgpu_instance = nullptr;
-    SDL_Window * sdl_window = nullptr;
-    WGPUAdapter wgpu_adapter = nullptr;
-    WGPUSurface wgpu_surface = nullptr;
-    WGPUDevice wgpu_device = nullptr;
-    WGPUQueue wgpu_queue = nullptr;
-    WGPUSwapChain wgpu_swap_chain = nullptr;
+        if(wgpu_device)
+        {
+            device_loss_monitor::detach(wgpu_device);
+            wgpuDeviceRelease(wgpu_device);
+            wgpu_device = nullptr;
+        }
+    }
 }; /* struct wgpu_app */
 
 class frame_renderer
 {
     public:
-    frame_renderer(wgpu_app & app_instance) :
-        m_app(app_instance)
+    frame_renderer(
+        wgpu_app & app_instance,
+        vertex_encoding encoding,
+        morph_mode requested_morph_mode,
+        resolution_settings const & resolution,
+        std::string shader_source,
+        std::uint32_t instance_count,
+        culling_mode requested_culling_mode,
+        bool occlusion_culling) :
+        m_app(app_instance),
+        m_vertex_encoding(encoding),
+        m_morph_mode(
+            app_instance.device_config.has_storage_buffers() ?
+            requested_morph_mode : morph_mode::pairwise),
+        m_instance_count(std::max(instance_count, 1u)),
+        m_culling_mode(
+            requested_culling_mode == culling_mode::gpu &&
+            gpu_culling::supported(
+                app_instance.device_config.required_limits.limits,
+                app_instance.device_config.has_compute(),
+                m_instance_count) ?
+            culling_mode::gpu : culling_mode::cpu),
+        m_occlusion_culling(
+            occlusion_culling &&
+            m_culling_mode == culling_mode::cpu &&
+            occlusion_culler::supported(grid_rows(m_instance_count))),
+        m_shader_source(std::move(shader_source)),
+        m_culler(
+            m_culling_mode == culling_mode::cpu ?
+            frustum_culler::default_thread_count() : 1u),
+        m_timer(
+            app_instance.wgpu_device,
+            app_instance.wgpu_queue,
+            app_instance.memory,
+            app_instance.device_config.has_feature(WGPUFeatureName_TimestampQuery)),
+        m_resolution(
+            app_instance.wgpu_device,
+            app_instance.memory,
+            app_instance.surface_format,
+            wgpu_app::width,
+            wgpu_app::height,
+            resolution)
     {
-        m_shader_module =
-            wgpuDeviceCreateShaderModule(m_app.wgpu_device, &shader_module_descriptor);
+        m_shader_module = create_shader_module(m_shader_source);
 
         if(!m_shader_module)
         {
@@ -453,69 +518,29 @@ class frame_renderer
             throw std::runtime_error{"Shader compilation failed"};
         }
 
-        WGPUColorTargetState const color_target =
-        {
-            .nextInChain = nullptr,
-            .format = WGPUTextureFormat_BGRA8Unorm,
-            .blend = nullptr,
-            .writeMask = WGPUColorWriteMask_All
-        };
-
-        WGPUFragmentState const fragmet_state =
-        {
-            .nextInChain = nullptr,
-            .module = m_shader_module,
-            .entryPoint = "fs_main",
-            .constantCount = 0u,
-            .constants = nullptr,
-            .targetCount = 1,
-            .targets = &color_target
-        };
-
-        constexpr std::array src_vertex_attribs
-        {
-            WGPUVertexAttribute
-            {
-                .format = WGPUVertexFormat_Float32x3,
-                .offset = 0,
-                .shaderLocation = 0
-            },
-        };
+        // Blended morphing fetches every target from storage buffers
+        auto const blend = m_morph_mode == morph_mode::blend;
 
-        constexpr std::array dst_vertex_attribs
+        std::array<WGPUBindGroupLayoutEntry, 5> layout_entries{};
+        auto layout_entry_count = std::size_t{0};
+        for(auto const & entry: binding_layout_entries)
         {
-            WGPUVertexAttribute
-            {
-                .format = WGPUVertexFormat_Float32x3,
-                .offset = 0,
-                .shaderLocation = 1
-            },
-        };
-
-        std::array const buffer_layouts
+            layout_entries[layout_entry_count++] = entry;
+        }
+        if(blend)
         {
-            WGPUVertexBufferLayout
-            {
-                .arrayStride = 3 * sizeof(float),
-                .stepMode = WGPUVertexStepMode_Vertex,
-                .attributeCount = src_vertex_attribs.size(),
-                .attributes = src_vertex_attribs.data()
-            },
-            WGPUVertexBufferLayout
+            for(auto const & entry: morph_storage_layout_entries)
             {
-                .arrayStride = 3 * sizeof(float),
-                .stepMode = WGPUVertexStepMode_Vertex,
-                .attributeCount = dst_vertex_attribs.size(),
-                .attributes = dst_vertex_attribs.data()
+                layout_entries[layout_entry_count++] = entry;
             }
-        };
+        }
 
         WGPUBindGroupLayoutDescriptor const bind_group_layout_descriptor =
         {
             .nextInChain = nullptr,
             .label = "BindGrouLayout",
-            .entryCount = binding_layout_entries.size(),
-            .entries = binding_layout_entries.data()
+            .entryCount = layout_entry_count,
+            .entries = layout_entries.data()
         };
 
         WGPUBindGroupLayout bind_group_layout =
@@ -530,103 +555,36 @@ class frame_renderer
             .bindGroupLayouts = &bind_group_layout
         };
 
-        WGPUPipelineLayout pipeline_layout =
+        m_pipeline_layout =
             wgpuDeviceCreatePipelineLayout(m_app.wgpu_device, &layout_descriptor);
 
-        WGPURenderPipelineDescriptor const front_face_pipeline_descriptor =
-        {
-            .nextInChain = nullptr,
-            .label = "RenderPipelineCCW",
-            .layout = pipeline_layout,
-            .vertex =
-            {
-                .nextInChain = nullptr,
-                .module = m_shader_module,
-                .entryPoint = "vs_main",
-                .constantCount = 0,
-                .constants = nullptr,
-                .bufferCount = buffer_layouts.size(),
-                .buffers = buffer_layouts.data()
-            },
-            .primitive =
+        with_pipeline_descriptors(
+            m_shader_module,
+            [this](
+                WGPURenderPipelineDescriptor const & front_face_descriptor,
+                WGPURenderPipelineDescriptor const & back_face_descriptor)
             {
-                .nextInChain = nullptr,
-                .topology = WGPUPrimitiveTopology_TriangleList,
-                .stripIndexFormat = WGPUIndexFormat_Undefined,
-                .frontFace = WGPUFrontFace_CCW,
-                .cullMode = WGPUCullMode_Front
-            },
-            .depthStencil = nullptr,
-            .multisample =
-            {
-                .nextInChain = nullptr,
-                .count = 1,
-                .mask = ~std::uint32_t{0},
-                .alphaToCoverageEnabled = false
-            },
-            .fragment = &fragmet_state
-        };
-
-        m_front_face_pipeline = wgpuDeviceCreateRenderPipeline(
-            m_app.wgpu_device, &front_face_pipeline_descriptor);
+                m_front_face_pipeline = wgpuDeviceCreateRenderPipeline(
+                    m_app.wgpu_device, &front_face_descriptor);
+                m_back_face_pipeline = wgpuDeviceCreateRenderPipeline(
+                    m_app.wgpu_device, &back_face_descriptor);
+            });
 
-        if(!m_front_face_pipeline)
+        if(!m_front_face_pipeline || !m_back_face_pipeline)
         {
             throw std::runtime_error{"RenderPipeline creation failed"};
         }
 
-        WGPURenderPipelineDescriptor const back_face_pipeline_descriptor =
+        if(blend)
         {
-            .nextInChain = nullptr,
-            .label = "RenderPipelineCW",
-            .layout = pipeline_layout,
-            .vertex =
-            {
-                .nextInChain = nullptr,
-                .module = m_shader_module,
-                .entryPoint = "vs_main",
-                .constantCount = 0,
-                .constants = nullptr,
-                .bufferCount = buffer_layouts.size(),
-                .buffers = buffer_layouts.data()
-            },
-            .primitive =
-            {
-                .nextInChain = nullptr,
-                .topology = WGPUPrimitiveTopology_TriangleList,
-                .stripIndexFormat = WGPUIndexFormat_Undefined,
-                .frontFace = WGPUFrontFace_CCW,
-                .cullMode = WGPUCullMode_Back
-            },
-            .depthStencil = nullptr,
-            .multisample =
-            {
-                .nextInChain = nullptr,
-                .count = 1,
-                .mask = ~std::uint32_t{0},
-                .alphaToCoverageEnabled = false
-            },
-            .fragment = &fragmet_state
-        };
-
-        m_back_face_pipeline = wgpuDeviceCreateRenderPipeline(
-            m_app.wgpu_device, &back_face_pipeline_descriptor);
-
-        if(!m_back_face_pipeline)
+            create_morph_target_storage();
+        }
+        else
         {
-            throw std::runtime_error{"RenderPipeline creation failed"};
+            create_shape_vertex_buffers();
         }
 
-        wgpuPipelineLayoutRelease(pipeline_layout);
-
-        m_shape_vertex_buffers =
-        {
-            create_vertex_buffer(cube_vertex_data, "CubeVertexBuffer"),
-            create_vertex_buffer(hedron_vertex_data, "HedronVertexBuffer"),
-            create_vertex_buffer(spikes_vertex_data, "SpikesVertexBuffer"),
-            create_vertex_buffer(tile1_vertex_data, "Tile1VertexBuffer"),
-            create_vertex_buffer(tile2_vertex_data, "Tile2VertexBuffer")
-        };
+        create_instance_transforms();
 
         m_indices1 = create_index_buffer(indices1_data, "IndexBuffer1");
         m_indices2 = create_index_buffer(indices2_data, "IndexBuffer2");
@@ -635,24 +593,34 @@ class frame_renderer
         m_color_uniform = create_uniform_buffer(
             fill_colors.size() * wgpu_app::uniform_buffer_offset_alignment, "ColorUniform");
 
+        staging_belt uploads{m_app.wgpu_device, m_app.memory};
+
+        uploads.write(
+            m_transformation_uniform,
+            quantization_uniform_offset,
+            m_quantization);
+
+        std::array const morph_info
+        {
+            static_cast<std::uint32_t>(morph_target_count),
+            static_cast<std::uint32_t>(vertex_data_size)
+        };
+        uploads.write(
+            m_transformation_uniform,
+            morph_info_uniform_offset,
+            morph_info);
+
         for(auto i = std::size_t{0}; i != fill_colors.size(); ++i)
         {
-            auto const & color = fill_colors[i];
-            wgpuQueueWriteBuffer(
-                m_app.wgpu_queue,
+            uploads.write(
                 m_color_uniform,
                 i*wgpu_app::uniform_buffer_offset_alignment,
-                &color, sizeof(color));
+                fill_colors[i]);
         }
 
-        wgpuQueueWriteBuffer(
-            m_app.wgpu_queue,
-            m_color_uniform,
-            0,
-            fill_colors.data(),
-            fill_colors.size() * sizeof(WGPUColor));
+        uploads.flush(m_app.wgpu_queue);
 
-        std::array const bind_group_entries
+        std::array bind_group_entries
         {
             WGPUBindGroupEntry
             {
@@ -673,6 +641,36 @@ class frame_renderer
                 .size = sizeof(WGPUColor),
                 .sampler = nullptr,
                 .textureView = nullptr
+            },
+            WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = 2,
+                .buffer = m_morph_targets,
+                .offset = 0,
+                .size = morph_target_count * vertex_data_size * sizeof(glm::vec4),
+                .sampler = nullptr,
+                .textureView = nullptr
+            },
+            WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = 3,
+                .buffer = m_morph_weights,
+                .offset = 0,
+                .size = morph_weights_size(),
+                .sampler = nullptr,
+                .textureView = nullptr
+            },
+            WGPUBindGroupEntry
+            {
+                .nextInChain = nullptr,
+                .binding = 4,
+                .buffer = m_morph_weight_rows,
+                .offset = 0,
+                .size = morph_weight_rows_size(),
+                .sampler = nullptr,
+                .textureView = nullptr
             }
         };
 
@@ -681,7 +679,7 @@ class frame_renderer
             .nextInChain = nullptr,
             .label = "BindGroup",
             .layout = bind_group_layout,
-            .entryCount = bind_group_entries.size(),
+            .entryCount = layout_entry_count,
             .entries = bind_group_entries.data()
         };
 
@@ -696,41 +694,139 @@ class frame_renderer
 
     ~frame_renderer()
     {
-        wgpuBufferRelease(m_color_uniform);
-        wgpuBufferRelease(m_transformation_uniform);
-        wgpuBufferRelease(m_indices2);
-        wgpuBufferRelease(m_indices1);
+        wgpuBindGroupRelease(m_bind_group);
+        m_app.memory.release(m_color_uniform);
+        m_app.memory.release(m_transformation_uniform);
+        m_app.memory.release(m_indices2);
+        m_app.memory.release(m_indices1);
+        m_app.memory.release(m_instance_transforms);
+
+        if(m_morph_weights)
+        {
+            m_app.memory.release(m_morph_weight_rows);
+            m_app.memory.release(m_morph_weights);
+            m_app.memory.release(m_morph_targets);
+        }
 
         for(auto buff: m_shape_vertex_buffers)
         {
-            wgpuBufferRelease(buff);
+            if(buff)
+            {
+                m_app.memory.release(buff);
+            }
+        }
+
+        if(m_reload)
+        {
+            // Pipeline callbacks point into the reload state
+            while(m_reload->pending != 0)
+            {
+                wgpuDeviceTick(m_app.wgpu_device);
+            }
+            m_reload->release();
         }
 
         wgpuRenderPipelineRelease(m_back_face_pipeline);
         wgpuRenderPipelineRelease(m_front_face_pipeline);
+        wgpuPipelineLayoutRelease(m_pipeline_layout);
         wgpuShaderModuleRelease(m_shader_module);
     }
 
-    void render(
-        WGPUTextureView next_texture,
-        std::uint32_t time_point,
-        std::uint32_t delta_time)
+    static std::string_view builtin_shader()
+    {
+        return builtin_mesh_shader;
+    }
+
+    /* The WGSL source of the pipelines in use */
+    std::string const & shader_source() const
+    {
+        return m_shader_source;
+    }
+
+    /*
+     * Compiles source and creates its pipelines in the background. render()
+     * swaps them in at the start of a frame once both exist; if anything
+     * fails, the previous pipelines stay. A source arriving while another
+     * one compiles replaces any queued one and follows when it completes.
+     */
+    void reload_shader(std::string source)
+    {
+        if(m_reload)
+        {
+            m_queued_shader_source = std::move(source);
+            return;
+        }
+
+        start_shader_reload(std::move(source));
+    }
+
+    /*
+     * Moves the animation forward by delta_time milliseconds while it runs.
+     * Long gaps, e.g. while paused or hidden, are capped so the animation
+     * resumes where it stopped instead of jumping ahead.
+     */
+    void advance(std::uint32_t delta_time)
+    {
+        if(!m_animating)
+        {
+            return;
+        }
+
+        auto const step = std::min(delta_time, max_animation_step_ms);
+        m_animation_time += step;
+        m_morph_time += step/3000.0f;
+    }
+
+    void set_animating(bool animating)
+    {
+        m_animating = animating;
+        m_dirty = true;
+    }
+
+    bool animating() const
+    {
+        return m_animating;
+    }
+
+    /* Forces a redraw although no scene input changed */
+    void invalidate()
+    {
+        m_dirty = true;
+    }
+
+    /* True when the last rendered image is out of date */
+    bool needs_redraw() const
     {
-        float rc = 3.0f * glm::cos(time_point * 0.001);
-        float sc = 2.5f * glm::sin(time_point * 0.001);
+        // Frames tick the device, which delivers the reload and query callbacks
+        return m_dirty || m_animating || m_reload ||
+            (m_occlusion && m_occlusion->frames_in_flight() != 0u);
+    }
+
+    void render(WGPUTextureView next_texture)
+    {
+        finish_shader_reload();
+
+        auto const gpu_sample = m_timer.take_sample();
+        if(gpu_sample)
+        {
+            m_gpu_frame_ms = *gpu_sample;
+            m_resolution.update(*gpu_sample);
+        }
+
+        m_dirty = false;
+
+        trace::scoped_span upload_span{"upload uniforms"};
 
+        // Objects carry their own world matrices, this is view projection
         glm::mat4 transform =
             m_projection_matrix *
-            glm::translate(glm::vec3{0.0f, 0.0f, -8.0f}) *
-            glm::rotate(rc, glm::vec3{1.0f, 0.0f, 0.0f}) *
-            glm::rotate(rc, glm::vec3{0.0f, 1.0f, 0.0f});
+            glm::translate(glm::vec3{0.0f, 0.0f, -8.0f});
 
-        wgpuQueueWriteBuffer(
-            m_app.wgpu_queue,
-            m_transformation_uniform,
-            0,
-            &transform,
-            sizeof(transform));
+        // Uniforms are only uploaded when they differ from the last upload
+        if(!m_uploaded.valid || transform != m_uploaded.transform)
+        {
+            write_buffer(m_transformation_uniform, 0, &transform, sizeof(transform));
+        }
 
         while(m_morph_time > 1.0f)
         {
@@ -741,95 +837,348 @@ class frame_renderer
         auto const morph_time =
             glm::clamp((m_morph_time * 4.0f) - 3.0f, 0.0f, 1.0f);
 
-        wgpuQueueWriteBuffer(
-            m_app.wgpu_queue,
-            m_transformation_uniform,
-            sizeof(transform),
-            &morph_time,
-            sizeof(morph_time));
+        auto const src_index = m_morph_index % morph_target_count;
+        auto const dst_index = (src_index+1) % morph_target_count;
+
+        // Most of the time the morph holds a shape and nothing changes
+        auto const morph_changed =
+            !m_uploaded.valid ||
+            morph_time != m_uploaded.morph_time ||
+            src_index != m_uploaded.morph_source;
+
+        if(morph_changed)
+        {
+            write_buffer(
+                m_transformation_uniform, sizeof(transform), &morph_time, sizeof(morph_time));
+        }
+
+        if(morph_changed && m_morph_mode == morph_mode::blend)
+        {
+            // Any mix of targets works, the shared weights mirror the
+            // pairwise morph
+            auto weights = std::array<float, morph_target_count>{};
+            weights[src_index] = 1.0f - morph_time;
+            weights[dst_index] = morph_time;
+
+            write_buffer(m_morph_weights, 0, weights.data(), sizeof(weights));
+        }
+
+        update_instance_transforms(transform);
+        upload_weight_rows();
+
+        m_uploaded =
+        {
+            .valid = true,
+            .transform = transform,
+            .morph_time = morph_time,
+            .morph_source = src_index
+        };
+
+        upload_span.end();
+        trace::scoped_span encode_span{"encode"};
+
+        auto const visible_count = static_cast<std::uint32_t>(m_visible_instances.size());
 
-        auto const src_index = m_morph_index % m_shape_vertex_buffers.size();
-        auto const dst_index = (src_index+1) % m_shape_vertex_buffers.size();
+        auto const mesh_draw = [&](
+            WGPURenderPipeline pipeline,
+            std::uint32_t color_index,
+            WGPUBuffer index_buffer,
+            std::size_t index_count)
+        {
+            auto const vertex_buffer_count =
+                m_morph_mode == morph_mode::blend ? 0u :
+                is_interleaved(m_vertex_encoding) ? 1u : 2u;
+            auto const vertex_buffer_size =
+                vertex_data_size * vertex_stride(m_vertex_encoding);
+
+            auto item = draw_item
+            {
+                .pipeline = pipeline,
+                .bind_group = m_bind_group,
+                .dynamic_offset_count = 1,
+                .dynamic_offsets =
+                {
+                    wgpu_app::uniform_buffer_offset_alignment * color_index
+                },
+                .vertex_buffer_count = vertex_buffer_count,
+                .vertex_buffers =
+                {
+                    draw_item::buffer_range
+                    {
+                        m_shape_vertex_buffers[src_index], 0, vertex_buffer_size
+                    },
+                    draw_item::buffer_range
+                    {
+                        m_shape_vertex_buffers[dst_index], 0, vertex_buffer_size
+                    }
+                },
+                .index_buffer =
+                {
+                    index_buffer, 0, index_count * sizeof(std::uint32_t)
+                },
+                .index_format = WGPUIndexFormat_Uint32,
+                .index_count = static_cast<std::uint32_t>(index_count),
+                .instance_count = visible_count
+            };
+
+            // The world matrices of the visible instances follow the mesh buffers
+            item.vertex_buffers[vertex_buffer_count] =
+            {
+                m_instance_transforms, 0,
+                (m_gpu_culling ? m_instance_count : visible_count) * sizeof(glm::mat4)
+            };
+            item.vertex_buffer_count = vertex_buffer_count + 1u;
+
+            // The cull pass writes the instance count, draws follow color order
+            if(m_gpu_culling)
+            {
+                item.indirect_buffer = m_gpu_culling->arguments();
+                item.indirect_offset = gpu_culling::arguments_offset(color_index);
+            }
+
+            return item;
+        };
+
+        m_render_queue.clear();
+        if(m_gpu_culling || visible_count != 0u)
+        {
+            // The queue keeps references, the items live until the next frame
+            m_mesh_draws =
+            {
+                mesh_draw(m_front_face_pipeline, 0, m_indices1, indices1_data.size()),
+                mesh_draw(m_front_face_pipeline, 1, m_indices2, indices2_data.size()),
+                mesh_draw(m_back_face_pipeline, 2, m_indices2, indices2_data.size())
+            };
+            m_render_queue.submit(
+                sort_key::make(0, front_face_pipeline_id, 0, 0), m_mesh_draws[0]);
+            m_render_queue.submit(
+                sort_key::make(0, front_face_pipeline_id, 1, 0), m_mesh_draws[1]);
+            m_render_queue.submit(
+                sort_key::make(0, back_face_pipeline_id, 2, 0), m_mesh_draws[2]);
+        }
+        m_render_queue.sort();
 
         WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
             m_app.wgpu_device, &command_encoder_descriptor);
 
+        if(m_gpu_culling && m_gpu_cull_pending)
+        {
+            m_gpu_culling->dispatch(encoder);
+            m_gpu_cull_pending = false;
+        }
+
+        m_timer.begin_frame();
+        if(m_occlusion)
+        {
+            m_occlusion->begin_frame();
+        }
+
         WGPURenderPassEncoder render_pass =
-            createRenderPassEncoder(encoder, next_texture);
-
-        wgpuRenderPassEncoderSetVertexBuffer(
-            render_pass, 0, m_shape_vertex_buffers[src_index],
-            0, cube_vertex_data.size() * sizeof(glm::vec3));
-        wgpuRenderPassEncoderSetVertexBuffer(
-            render_pass, 1, m_shape_vertex_buffers[dst_index],
-            0, hedron_vertex_data.size() * sizeof(glm::vec3));
-
-        // 1st draww
-        wgpuRenderPassEncoderSetPipeline(render_pass, m_front_face_pipeline);
-
-        std::uint32_t color_offset =
-            wgpu_app::uniform_buffer_offset_alignment * 0;
-        wgpuRenderPassEncoderSetBindGroup(
-            render_pass, 0, m_bind_group, 1, &color_offset);
-
-        wgpuRenderPassEncoderSetIndexBuffer(
-            render_pass,
-            m_indices1,
-            WGPUIndexFormat_Uint32,
-            0, indices1_data.size() * sizeof(std::uint32_t));
-
-        wgpuRenderPassEncoderDrawIndexed(
-            render_pass, indices1_data.size(), 1, 0, 0, 0);
-
-        // 2nd draw
-        color_offset =
-            wgpu_app::uniform_buffer_offset_alignment * 1;
-        wgpuRenderPassEncoderSetBindGroup(
-            render_pass, 0, m_bind_group, 1, &color_offset);
-
-        wgpuRenderPassEncoderSetIndexBuffer(
-            render_pass,
-            m_indices2,
-            WGPUIndexFormat_Uint32,
-            0, indices2_data.size() * sizeof(std::uint32_t));
-
-        wgpuRenderPassEncoderDrawIndexed(
-            render_pass, indices2_data.size(), 1, 0, 0, 0);
-
-        // 3rd draw
-        wgpuRenderPassEncoderSetPipeline(render_pass, m_back_face_pipeline);
-
-        color_offset =
-            wgpu_app::uniform_buffer_offset_alignment * 2;
-        wgpuRenderPassEncoderSetBindGroup(
-            render_pass, 0, m_bind_group, 1, &color_offset);
-
-        wgpuRenderPassEncoderSetIndexBuffer(
-            render_pass,
-            m_indices2,
-            WGPUIndexFormat_Uint32,
-            0, indices2_data.size() * sizeof(std::uint32_t));
-
-        wgpuRenderPassEncoderDrawIndexed(
-            render_pass, indices2_data.size(), 1, 0, 0, 0);
+            createRenderPassEncoder(encoder, m_resolution.scene_view());
+        m_resolution.set_scene_viewport(render_pass);
+
+        render_pass_state pass{render_pass, m_pass_statistics};
+        m_render_queue.encode(pass);
+
+        // Proxies test against the depth of everything drawn
+        if(m_occlusion)
+        {
+            std::array const dynamic_offsets{ 0u };
+            m_occlusion->draw(pass, m_bind_group, dynamic_offsets);
+        }
 
         // Draw done
 
         wgpuRenderPassEncoderEnd(render_pass);
 
+        m_timer.resolve(encoder);
+        if(m_occlusion)
+        {
+            m_occlusion->resolve(encoder);
+        }
+        auto const output_pass =
+            m_resolution.upscale(m_app.wgpu_queue, encoder, next_texture);
+
+        if(m_hud_visible)
+        {
+            trace::scoped_span hud_span{"hud"};
+            draw_hud(output_pass, gpu_sample);
+        }
+
+        wgpuRenderPassEncoderEnd(output_pass);
+        wgpuRenderPassEncoderRelease(output_pass);
+
         WGPUCommandBuffer command_buffer =
             wgpuCommandEncoderFinish(encoder, &command_buffer_descriptor);
 
+        encode_span.end();
+        trace::scoped_span submit_span{"submit"};
+
         wgpuQueueSubmit(m_app.wgpu_queue, 1, &command_buffer);
+        m_timer.submitted();
+        if(m_occlusion)
+        {
+            m_occlusion->submitted();
+        }
 
         wgpuCommandBufferRelease(command_buffer);
         wgpuRenderPassEncoderRelease(render_pass);
         wgpuCommandEncoderRelease(encoder);
+    }
+
+    render_pass_statistics const & pass_statistics() const
+    {
+        return m_pass_statistics;
+    }
+
+    morph_mode active_morph_mode() const
+    {
+        return m_morph_mode;
+    }
+
+    culling_mode active_culling_mode() const
+    {
+        return m_culling_mode;
+    }
+
+    bool occlusion_culling() const
+    {
+        return m_occlusion.has_value();
+    }
+
+    struct animation_state
+    {
+        std::uint32_t animation_time;
+        float morph_time;
+        std::size_t morph_index;
+        bool animating;
+    };
+
+    /* Carried over to a renderer recreated after a device loss */
+    animation_state animation() const
+    {
+        return { m_animation_time, m_morph_time, m_morph_index, m_animating };
+    }
+
+    void set_animation(animation_state const & state)
+    {
+        m_animation_time = state.animation_time;
+        m_morph_time = state.morph_time;
+        m_morph_index = state.morph_index;
+        m_animating = state.animating;
+        m_dirty = true;
+    }
+
+    gpu_timer const & frame_timer() const
+    {
+        return m_timer;
+    }
 
-        m_morph_time += delta_time/3000.0f;
+    float resolution_scale() const
+    {
+        return m_resolution.scale();
+    }
+
+    /* Latest measured GPU frame time, 0 until the first one arrived */
+    double gpu_frame_ms() const
+    {
+        return m_gpu_frame_ms;
+    }
+
+    std::uint32_t instance_count() const
+    {
+        return m_instance_count;
+    }
+
+    /* Instances drawn in the last frame, after frustum and occlusion culling */
+    std::uint32_t visible_instance_count() const
+    {
+        return static_cast<std::uint32_t>(m_visible_instances.size());
+    }
+
+    /* Instances in the view skipped because their row was occluded */
+    std::uint32_t occluded_instance_count() const
+    {
+        return m_occluded_instances;
+    }
+
+    /* World matrices recomputed since the renderer was created */
+    std::uint64_t recomputed_transforms() const
+    {
+        return m_recomputed_transforms;
+    }
+
+    /* Bytes written through the queue since the renderer was created */
+    std::uint64_t upload_bytes() const
+    {
+        return m_upload_bytes;
+    }
+
+    /* The HUD is created when first shown and kept while hidden */
+    void set_hud_visible(bool visible)
+    {
+        if(visible && !m_hud)
+        {
+            m_hud.emplace(
+                m_app.wgpu_device,
+                m_app.wgpu_queue,
+                m_app.memory,
+                m_app.surface_format,
+                wgpu_app::width,
+                wgpu_app::height);
+        }
+
+        m_hud_visible = visible;
+        m_dirty = true;
+    }
+
+    bool hud_visible() const
+    {
+        return m_hud_visible;
     }
 
     private:
+    void draw_hud(WGPURenderPassEncoder output_pass, std::optional<double> gpu_ms)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        auto const frame_ms = m_last_hud_frame == std::chrono::steady_clock::time_point{} ?
+            0.0 :
+            std::chrono::duration<double, std::milli>(now - m_last_hud_frame).count();
+        m_last_hud_frame = now;
+
+        // Counters of the previous frame, including its HUD draw
+        auto const state_calls = m_pass_statistics.issued + m_pass_statistics.elided;
+
+        m_upload_bytes += m_hud->update(
+            m_app.wgpu_queue,
+            {
+                .frame_ms = frame_ms,
+                .gpu_ms = gpu_ms,
+                .draws = m_pass_statistics.draws - m_hud_counted.draws,
+                .state_calls = state_calls - m_hud_counted.state_calls,
+                .upload_bytes = m_upload_bytes - m_hud_counted.upload_bytes,
+                .gpu_memory_bytes = m_app.memory.current_bytes(),
+                .resolution_scale = m_resolution.scale(),
+                .frames_in_flight = m_timer.frames_in_flight()
+            });
+
+        m_hud_counted =
+        {
+            .draws = m_pass_statistics.draws,
+            .state_calls = state_calls,
+            .upload_bytes = m_upload_bytes
+        };
+
+        render_pass_state pass{output_pass, m_pass_statistics};
+        m_hud->draw(pass);
+    }
+
+    void write_buffer(WGPUBuffer buffer, std::uint64_t offset, void const * data, std::size_t size)
+    {
+        wgpuQueueWriteBuffer(m_app.wgpu_queue, buffer, offset, data, size);
+        m_upload_bytes += size;
+    }
+
     WGPURenderPassEncoder createRenderPassEncoder(
         WGPUCommandEncoder encoder, WGPUTextureView target_view)
     {
@@ -843,121 +1192,1074 @@ class frame_renderer
             .clearValue = bg_color
         };
 
+        // Occlusion queries count the samples passing the depth test
+        auto const depth_attachment = m_occlusion ?
+            m_occlusion->depth_attachment() : WGPURenderPassDepthStencilAttachment{};
+
         WGPURenderPassDescriptor const render_pass_descriptor =
         {
             .nextInChain = nullptr,
             .label = "RenderPass",
             .colorAttachmentCount = 1,
             .colorAttachments = &color_attachment,
-            .depthStencilAttachment = nullptr,
-            .occlusionQuerySet = nullptr,
-            .timestampWriteCount = 0,
-            .timestampWrites = nullptr
+            .depthStencilAttachment = m_occlusion ? &depth_attachment : nullptr,
+            .occlusionQuerySet = m_occlusion ? m_occlusion->query_set() : nullptr,
+            .timestampWriteCount = m_timer.pass_timestamp_writes().size(),
+            .timestampWrites = m_timer.pass_timestamp_writes().data()
         };
 
         return wgpuCommandEncoderBeginRenderPass(encoder, &render_pass_descriptor);
     }
 
-    static bool validate_shader_module(WGPUShaderModule module)
+    WGPUShaderModule create_shader_module(std::string const & source) const
     {
-        struct user_data_t
+        WGPUShaderModuleWGSLDescriptor const code_descriptor =
         {
-            bool compilation_complete = false;
-            bool compilation_success = false;
-            std::mutex mutex;
-            std::condition_variable cv;
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_ShaderModuleWGSLDescriptor
+            },
+            .code = source.c_str()
         };
 
-        user_data_t user_data;
+        WGPUShaderModuleDescriptor const module_descriptor =
+        {
+            .nextInChain = &code_descriptor.chain,
+            .label = "ShaderModule"
+        };
 
-        auto const shader_compile_callback = [](
+        return wgpuDeviceCreateShaderModule(m_app.wgpu_device, &module_descriptor);
+    }
+
+    /*
+     * A shader compiling in the background. Its callbacks are delivered by
+     * wgpuDeviceTick on the render thread, so no locking is needed.
+     */
+    struct shader_reload
+    {
+        std::string source;
+        WGPUShaderModule module = nullptr;
+        WGPURenderPipeline front_face_pipeline = nullptr;
+        WGPURenderPipeline back_face_pipeline = nullptr;
+        int pending = 0;
+        bool failed = false;
+
+        void compiled(
             WGPUCompilationInfoRequestStatus status,
-            WGPUCompilationInfo const * compilation_info,
-            void * p_user_data)
+            WGPUCompilationInfo const * compilation_info)
         {
-            auto * user_data = reinterpret_cast<user_data_t *>(p_user_data);
-            std::unique_lock<std::mutex> lock{user_data->mutex};            
-
-            auto errors = std::size_t{0};
             if(compilation_info)
             {
                 for(auto i = std::size_t{0}; i < compilation_info->messageCount; ++i)
                 {
-                    auto const message = compilation_info->messages[i];
+                    auto const & message = compilation_info->messages[i];
                     if(message.type == WGPUCompilationMessageType_Error)
                     {
-                        ++errors;
-                        std::cerr << "Shader compile error: " << message.message << '\n';
+                        failed = true;
+                        std::cerr <<
+                            "Shader compile error at " <<
+                            message.lineNum << ':' << message.linePos << ": " <<
+                            message.message << '\n';
                     }
                 }
             }
 
-            user_data->compilation_success = 
-                (status == WGPUCompilationInfoRequestStatus_Success) &&
-                (errors == 0u);
-            user_data->compilation_complete = true;
-            lock.unlock();
-            user_data->cv.notify_all();
-        };
+            failed = failed || status != WGPUCompilationInfoRequestStatus_Success;
+            --pending;
+        }
 
-        wgpuShaderModuleGetCompilationInfo(
-            module, shader_compile_callback, &user_data);
-        
-        std::unique_lock<std::mutex> lock{user_data.mutex};
-        user_data.cv.wait(
-            lock, [&user_data] { return user_data.compilation_complete; });
+        void pipeline_created(
+            WGPUCreatePipelineAsyncStatus status,
+            WGPURenderPipeline pipeline,
+            char const * message,
+            WGPURenderPipeline & target)
+        {
+            if(status == WGPUCreatePipelineAsyncStatus_Success)
+            {
+                target = pipeline;
+            }
+            else
+            {
+                failed = true;
+                std::cerr << "Pipeline creation failed: " << (message ? message : "") << '\n';
+            }
 
-        return user_data.compilation_success;
-    }
+            --pending;
+        }
 
-    template <typename Container>
-    WGPUBuffer create_vertex_buffer(Container const & data, char const * label)
-    {
-        auto const size = data.size() * sizeof(typename Container::value_type);
-        WGPUBufferDescriptor const descriptor =
+        void release()
         {
-            .nextInChain = nullptr,
-            .label = label,
-            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
-            .size = size,
+            for(auto const pipeline: { front_face_pipeline, back_face_pipeline })
+            {
+                if(pipeline)
+                {
+                    wgpuRenderPipelineRelease(pipeline);
+                }
+            }
+
+            if(module)
+            {
+                wgpuShaderModuleRelease(module);
+            }
+        }
+    };
+
+    void start_shader_reload(std::string source)
+    {
+        m_reload = std::make_unique<shader_reload>();
+        m_reload->source = std::move(source);
+        m_reload->module = create_shader_module(m_reload->source);
+
+        if(!m_reload->module)
+        {
+            std::cerr << "Shader module creation failed, keeping the previous shader\n";
+            m_reload.reset();
+            return;
+        }
+
+        m_reload->pending = 3;
+
+        wgpuShaderModuleGetCompilationInfo(
+            m_reload->module,
+            [](
+                WGPUCompilationInfoRequestStatus status,
+                WGPUCompilationInfo const * compilation_info,
+                void * user_data)
+            {
+                reinterpret_cast<shader_reload *>(user_data)->compiled(
+                    status, compilation_info);
+            },
+            m_reload.get());
+
+        with_pipeline_descriptors(
+            m_reload->module,
+            [this](
+                WGPURenderPipelineDescriptor const & front_face_descriptor,
+                WGPURenderPipelineDescriptor const & back_face_descriptor)
+            {
+                wgpuDeviceCreateRenderPipelineAsync(
+                    m_app.wgpu_device, &front_face_descriptor,
+                    [](
+                        WGPUCreatePipelineAsyncStatus status,
+                        WGPURenderPipeline pipeline,
+                        char const * message,
+                        void * user_data)
+                    {
+                        auto & reload = *reinterpret_cast<shader_reload *>(user_data);
+                        reload.pipeline_created(
+                            status, pipeline, message, reload.front_face_pipeline);
+                    },
+                    m_reload.get());
+
+                wgpuDeviceCreateRenderPipelineAsync(
+                    m_app.wgpu_device, &back_face_descriptor,
+                    [](
+                        WGPUCreatePipelineAsyncStatus status,
+                        WGPURenderPipeline pipeline,
+                        char const * message,
+                        void * user_data)
+                    {
+                        auto & reload = *reinterpret_cast<shader_reload *>(user_data);
+                        reload.pipeline_created(
+                            status, pipeline, message, reload.back_face_pipeline);
+                    },
+                    m_reload.get());
+            });
+    }
+
+    /* Swaps in the pipelines of a completed reload, called at frame start */
+    void finish_shader_reload()
+    {
+        if(!m_reload || m_reload->pending != 0)
+        {
+            return;
+        }
+
+        auto const reload = std::move(m_reload);
+
+        if(reload->failed)
+        {
+            std::cerr << "Shader reload failed, keeping the previous shader\n";
+        }
+        else
+        {
+            std::swap(m_shader_module, reload->module);
+            std::swap(m_front_face_pipeline, reload->front_face_pipeline);
+            std::swap(m_back_face_pipeline, reload->back_face_pipeline);
+            m_shader_source = std::move(reload->source);
+            m_dirty = true;
+            std::cout << "Shader reloaded\n";
+        }
+
+        // Releases the previous objects, submitted frames keep their own references
+        reload->release();
+
+        if(m_queued_shader_source)
+        {
+            start_shader_reload(*std::exchange(m_queued_shader_source, std::nullopt));
+        }
+    }
+
+    /*
+     * Builds the descriptors of both mesh pipelines for module and passes
+     * them to create; they point into this stack frame.
+     */
+    template <typename Create>
+    void with_pipeline_descriptors(WGPUShaderModule module, Create && create) const
+    {
+        WGPUColorTargetState const color_target =
+        {
+            .nextInChain = nullptr,
+            .format = m_app.surface_format,
+            .blend = nullptr,
+            .writeMask = WGPUColorWriteMask_All
+        };
+
+        WGPUFragmentState const fragmet_state =
+        {
+            .nextInChain = nullptr,
+            .module = module,
+            .entryPoint = "fs_main",
+            .constantCount = 0u,
+            .constants = nullptr,
+            .targetCount = 1,
+            .targets = &color_target
+        };
+
+        auto const position_format = vertex_format(m_vertex_encoding);
+        auto const position_stride = vertex_stride(m_vertex_encoding);
+
+        std::array const src_vertex_attribs
+        {
+            WGPUVertexAttribute
+            {
+                .format = position_format,
+                .offset = 0,
+                .shaderLocation = 0
+            },
+        };
+
+        std::array const dst_vertex_attribs
+        {
+            WGPUVertexAttribute
+            {
+                .format = position_format,
+                .offset = 0,
+                .shaderLocation = 1
+            },
+        };
+
+        // Compressed encodings interleave both targets in one buffer
+        std::array const interleaved_vertex_attribs
+        {
+            src_vertex_attribs[0],
+            WGPUVertexAttribute
+            {
+                .format = position_format,
+                .offset = position_size(m_vertex_encoding),
+                .shaderLocation = 1
+            },
+        };
+
+        std::array const separate_buffer_layouts
+        {
+            WGPUVertexBufferLayout
+            {
+                .arrayStride = position_stride,
+                .stepMode = WGPUVertexStepMode_Vertex,
+                .attributeCount = src_vertex_attribs.size(),
+                .attributes = src_vertex_attribs.data()
+            },
+            WGPUVertexBufferLayout
+            {
+                .arrayStride = position_stride,
+                .stepMode = WGPUVertexStepMode_Vertex,
+                .attributeCount = dst_vertex_attribs.size(),
+                .attributes = dst_vertex_attribs.data()
+            }
+        };
+
+        WGPUVertexBufferLayout const interleaved_buffer_layout =
+        {
+            .arrayStride = position_stride,
+            .stepMode = WGPUVertexStepMode_Vertex,
+            .attributeCount = interleaved_vertex_attribs.size(),
+            .attributes = interleaved_vertex_attribs.data()
+        };
+
+        // One world matrix per instance, one column per attribute
+        std::array const instance_attribs
+        {
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Float32x4,
+                .offset = 0,
+                .shaderLocation = 2
+            },
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Float32x4,
+                .offset = sizeof(glm::vec4),
+                .shaderLocation = 3
+            },
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Float32x4,
+                .offset = 2 * sizeof(glm::vec4),
+                .shaderLocation = 4
+            },
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Float32x4,
+                .offset = 3 * sizeof(glm::vec4),
+                .shaderLocation = 5
+            }
+        };
+
+        WGPUVertexBufferLayout const instance_buffer_layout =
+        {
+            .arrayStride = sizeof(glm::mat4),
+            .stepMode = WGPUVertexStepMode_Instance,
+            .attributeCount = instance_attribs.size(),
+            .attributes = instance_attribs.data()
+        };
+
+        // Blended morphing fetches every target from storage buffers
+        auto const blend = m_morph_mode == morph_mode::blend;
+        auto const vertex_entry_point = blend ? "vs_blend" : "vs_main";
+
+        std::array<WGPUVertexBufferLayout, draw_item::max_vertex_buffers> buffer_layouts{};
+        auto buffer_layout_count = std::size_t{0};
+        if(!blend && is_interleaved(m_vertex_encoding))
+        {
+            buffer_layouts[buffer_layout_count++] = interleaved_buffer_layout;
+        }
+        else if(!blend)
+        {
+            for(auto const & layout: separate_buffer_layouts)
+            {
+                buffer_layouts[buffer_layout_count++] = layout;
+            }
+        }
+        buffer_layouts[buffer_layout_count++] = instance_buffer_layout;
+
+        // Occlusion proxies need the depth of the scene
+        auto const depth_stencil = occlusion_culler::scene_depth_state();
+        auto const * depth_stencil_state = m_occlusion_culling ? &depth_stencil : nullptr;
+
+        WGPURenderPipelineDescriptor const front_face_pipeline_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "RenderPipelineCCW",
+            .layout = m_pipeline_layout,
+            .vertex =
+            {
+                .nextInChain = nullptr,
+                .module = module,
+                .entryPoint = vertex_entry_point,
+                .constantCount = 0,
+                .constants = nullptr,
+                .bufferCount = buffer_layout_count,
+                .buffers = buffer_layouts.data()
+            },
+            .primitive =
+            {
+                .nextInChain = nullptr,
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .stripIndexFormat = WGPUIndexFormat_Undefined,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_Front
+            },
+            .depthStencil = depth_stencil_state,
+            .multisample =
+            {
+                .nextInChain = nullptr,
+                .count = 1,
+                .mask = ~std::uint32_t{0},
+                .alphaToCoverageEnabled = false
+            },
+            .fragment = &fragmet_state
+        };
+
+        WGPURenderPipelineDescriptor const back_face_pipeline_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "RenderPipelineCW",
+            .layout = m_pipeline_layout,
+            .vertex =
+            {
+                .nextInChain = nullptr,
+                .module = module,
+                .entryPoint = vertex_entry_point,
+                .constantCount = 0,
+                .constants = nullptr,
+                .bufferCount = buffer_layout_count,
+                .buffers = buffer_layouts.data()
+            },
+            .primitive =
+            {
+                .nextInChain = nullptr,
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .stripIndexFormat = WGPUIndexFormat_Undefined,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_Back
+            },
+            .depthStencil = depth_stencil_state,
+            .multisample =
+            {
+                .nextInChain = nullptr,
+                .count = 1,
+                .mask = ~std::uint32_t{0},
+                .alphaToCoverageEnabled = false
+            },
+            .fragment = &fragmet_state
+        };
+
+        create(front_face_pipeline_descriptor, back_face_pipeline_descriptor);
+    }
+
+    static bool validate_shader_module(WGPUShaderModule module)
+    {
+        struct user_data_t
+        {
+            bool compilation_complete = false;
+            bool compilation_success = false;
+            std::mutex mutex;
+            std::condition_variable cv;
+        };
+
+        user_data_t user_data;
+
+        auto const shader_compile_callback = [](
+            WGPUCompilationInfoRequestStatus status,
+            WGPUCompilationInfo const * compilation_info,
+            void * p_user_data)
+        {
+            auto * user_data = reinterpret_cast<user_data_t *>(p_user_data);
+            std::unique_lock<std::mutex> lock{user_data->mutex};            
+
+            auto errors = std::size_t{0};
+            if(compilation_info)
+            {
+                for(auto i = std::size_t{0}; i < compilation_info->messageCount; ++i)
+                {
+                    auto const message = compilation_info->messages[i];
+                    if(message.type == WGPUCompilationMessageType_Error)
+                    {
+                        ++errors;
+                        std::cerr << "Shader compile error: " << message.message << '\n';
+                    }
+                }
+            }
+
+            user_data->compilation_success = 
+                (status == WGPUCompilationInfoRequestStatus_Success) &&
+                (errors == 0u);
+            user_data->compilation_complete = true;
+            lock.unlock();
+            user_data->cv.notify_all();
+        };
+
+        wgpuShaderModuleGetCompilationInfo(
+            module, shader_compile_callback, &user_data);
+        
+        std::unique_lock<std::mutex> lock{user_data.mutex};
+        user_data.cv.wait(
+            lock, [&user_data] { return user_data.compilation_complete; });
+
+        return user_data.compilation_success;
+    }
+
+    void create_shape_vertex_buffers()
+    {
+        std::array const targets
+        {
+            std::span<glm::vec3 const>{cube_vertex_data},
+            std::span<glm::vec3 const>{hedron_vertex_data},
+            std::span<glm::vec3 const>{spikes_vertex_data},
+            std::span<glm::vec3 const>{tile1_vertex_data},
+            std::span<glm::vec3 const>{tile2_vertex_data}
+        };
+
+        static_assert(targets.size() == std::tuple_size_v<decltype(m_shape_vertex_buffers)>);
+
+        constexpr std::array labels
+        {
+            "CubeVertexBuffer",
+            "HedronVertexBuffer",
+            "SpikesVertexBuffer",
+            "Tile1VertexBuffer",
+            "Tile2VertexBuffer"
+        };
+
+        m_quantization = compute_quantization(m_vertex_encoding, targets);
+
+        for(auto i = std::size_t{0}; i != targets.size(); ++i)
+        {
+            if(is_interleaved(m_vertex_encoding))
+            {
+                // Buffer i holds the morph from target i to the next one
+                auto const next = (i+1) % targets.size();
+                m_shape_vertex_buffers[i] = create_vertex_buffer(
+                    encode_morph_pair(
+                        m_vertex_encoding, m_quantization,
+                        targets[i], targets[next]),
+                    labels[i]);
+            }
+            else
+            {
+                m_shape_vertex_buffers[i] =
+                    create_vertex_buffer(targets[i], labels[i]);
+            }
+        }
+    }
+
+    /*
+     * All targets in one storage buffer, target-major, plus the weights.
+     * Weight row 0 is shared by every instance, the others hold the
+     * weights of instances with their own mix. Each instance picks its row
+     * through the row buffer, packed like the visible world matrices, so a
+     * morph of the shared weights uploads one row whatever the instance
+     * count.
+     */
+    void create_morph_target_storage()
+    {
+        std::array const targets
+        {
+            &cube_vertex_data,
+            &hedron_vertex_data,
+            &spikes_vertex_data,
+            &tile1_vertex_data,
+            &tile2_vertex_data
+        };
+
+        static_assert(targets.size() == morph_target_count);
+
+        auto positions = std::vector<glm::vec4>{};
+        positions.reserve(morph_target_count * vertex_data_size);
+
+        for(auto const * target: targets)
+        {
+            for(auto const & p: *target)
+            {
+                positions.emplace_back(p, 1.0f);
+            }
+        }
+
+        // Positions are stored unquantized
+        m_quantization = position_quantization{};
+
+        m_morph_targets = create_buffer_with_data(
+            positions, WGPUBufferUsage_Storage, "MorphTargetBuffer");
+
+        WGPUBufferDescriptor const weights_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "MorphWeightBuffer",
+            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+            .size = morph_weights_size(),
+            .mappedAtCreation = false
+        };
+
+        m_morph_weights =
+            m_app.memory.create_buffer(m_app.wgpu_device, weights_descriptor);
+
+        // The cull pass writes the rows of the visible instances as storage
+        WGPUBufferDescriptor const rows_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "MorphWeightRowBuffer",
+            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+            .size = morph_weight_rows_size(),
+            .mappedAtCreation = false
+        };
+
+        m_morph_weight_rows =
+            m_app.memory.create_buffer(m_app.wgpu_device, rows_descriptor);
+
+        if(!m_morph_weights || !m_morph_weight_rows)
+        {
+            throw std::runtime_error{"Morph weight buffer creation failed"};
+        }
+
+        // New buffers are zeroed: every instance starts on the shared row
+        m_instance_weight_rows.assign(m_instance_count, 0u);
+        m_weight_row_count = 1u;
+
+        // The first instance shows a mix of all targets
+        auto even_mix = std::array<float, morph_target_count>{};
+        even_mix.fill(1.0f / static_cast<float>(morph_target_count));
+        set_instance_weights(0u, even_mix);
+    }
+
+    /* The shared row and room for one row per instance */
+    std::uint64_t morph_weights_size() const
+    {
+        return (1u + std::uint64_t{m_instance_count}) * morph_target_count * sizeof(float);
+    }
+
+    /* One row index per instance */
+    std::uint64_t morph_weight_rows_size() const
+    {
+        return std::uint64_t{m_instance_count} * sizeof(std::uint32_t);
+    }
+
+    /* Gives an instance its own weights instead of the shared ones */
+    void set_instance_weights(
+        std::uint32_t instance,
+        std::span<float const> weights)
+    {
+        if(weights.size() != morph_target_count)
+        {
+            throw std::runtime_error{"One weight per morph target expected"};
+        }
+
+        auto & row = m_instance_weight_rows[instance];
+        if(row == 0u)
+        {
+            row = m_weight_row_count++;
+            m_weight_rows_dirty = true;
+        }
+
+        write_buffer(
+            m_morph_weights,
+            std::uint64_t{row} * morph_target_count * sizeof(float),
+            weights.data(),
+            weights.size_bytes());
+    }
+
+    /*
+     * The instances form a grid below a root node: one node per row and
+     * the instances of a row below it. One row at a time spins while the
+     * others keep their last pose, so a frame only recomputes and uploads
+     * the subtree of that row.
+     */
+    void create_instance_transforms()
+    {
+        auto const columns = grid_columns(m_instance_count);
+        auto const rows = grid_rows(m_instance_count);
+        m_grid_columns = columns;
+        auto const scale = 1.0f / static_cast<float>(std::max(rows, columns));
+        auto const cell = grid_extent * scale;
+
+        m_transforms.reserve(1u + rows + m_instance_count);
+        auto const root =
+            m_transforms.add_node(transform_hierarchy::no_parent, glm::mat4{1.0f});
+
+        m_first_row_node = root + 1u;
+        for(auto row = 0u; row != rows; ++row)
+        {
+            auto const y = (0.5f * static_cast<float>(rows - 1u) - static_cast<float>(row)) * cell;
+            m_transforms.add_node(root, glm::translate(glm::vec3{0.0f, y, 0.0f}));
+        }
+
+        m_first_instance_node = m_first_row_node + rows;
+        for(auto i = 0u; i != m_instance_count; ++i)
+        {
+            auto const column = static_cast<float>(i % columns);
+            auto const x = (column - 0.5f * static_cast<float>(columns - 1u)) * cell;
+            m_transforms.add_node(
+                m_first_row_node + i / columns,
+                glm::translate(glm::vec3{x, 0.0f, 0.0f}) * glm::scale(glm::vec3{scale}));
+        }
+
+        // The cull pass writes the visible matrices as storage
+        WGPUBufferUsageFlags usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex;
+        if(m_culling_mode == culling_mode::gpu)
+        {
+            usage |= WGPUBufferUsage_Storage;
+        }
+
+        WGPUBufferDescriptor const descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "InstanceTransformBuffer",
+            .usage = usage,
+            .size = m_instance_count * sizeof(glm::mat4),
             .mappedAtCreation = false
         };
 
-        WGPUBuffer buffer =
-            wgpuDeviceCreateBuffer(m_app.wgpu_device, &descriptor);
+        m_instance_transforms = m_app.memory.create_buffer(m_app.wgpu_device, descriptor);
 
-        wgpuQueueWriteBuffer(
-            m_app.wgpu_queue,
-            buffer,
-            0,
-            data.data(),
-            data.size() * sizeof(typename Container::value_type));
+        if(!m_instance_transforms)
+        {
+            throw std::runtime_error{"Instance buffer creation failed"};
+        }
 
-        return buffer;
+        m_bounding_radius = mesh_bounding_radius();
+
+        if(m_culling_mode == culling_mode::gpu)
+        {
+            // One indirect draw per mesh draw, in color order
+            std::array const index_counts
+            {
+                static_cast<std::uint32_t>(indices1_data.size()),
+                static_cast<std::uint32_t>(indices2_data.size()),
+                static_cast<std::uint32_t>(indices2_data.size())
+            };
+
+            m_gpu_culling.emplace(
+                m_app.wgpu_device,
+                m_app.memory,
+                m_instance_count,
+                m_bounding_radius,
+                m_instance_transforms,
+                m_morph_weight_rows,
+                index_counts);
+        }
+        else
+        {
+            m_culler.resize(m_instance_count);
+            m_instance_slots.assign(m_instance_count, no_slot);
+        }
+
+        if(m_occlusion_culling)
+        {
+            // Rows are the occlusion objects, one query each
+            m_occlusion.emplace(
+                m_app.wgpu_device,
+                m_app.memory,
+                rows,
+                m_pipeline_layout,
+                m_app.surface_format,
+                m_resolution.texture_width(),
+                m_resolution.texture_height());
+        }
+    }
+
+    static std::uint32_t grid_columns(std::uint32_t instance_count)
+    {
+        return static_cast<std::uint32_t>(
+            std::ceil(std::sqrt(static_cast<double>(instance_count))));
+    }
+
+    static std::uint32_t grid_rows(std::uint32_t instance_count)
+    {
+        auto const columns = grid_columns(instance_count);
+        return (instance_count + columns - 1u) / columns;
+    }
+
+    /*
+     * Poses the spinning row, culls the instances against the view frustum
+     * and uploads the world matrices of the visible ones, packed at the
+     * start of the instance buffer. While the visible set stays the same,
+     * every instance keeps its slot and only changed matrices are written.
+     */
+    void update_instance_transforms(glm::mat4 const & view_projection)
+    {
+        if(m_posed_time != m_animation_time)
+        {
+            m_posed_time = m_animation_time;
+
+            auto const rows = m_first_instance_node - m_first_row_node;
+            auto const row = m_first_row_node + (m_animation_time / row_spin_ms) % rows;
+            auto const angle = 3.0f * glm::cos(m_animation_time * 0.001f);
+
+            auto local =
+                glm::rotate(angle, glm::vec3{1.0f, 0.0f, 0.0f}) *
+                glm::rotate(angle, glm::vec3{0.0f, 1.0f, 0.0f});
+            local[3] = m_transforms.local(row)[3];
+            m_transforms.set_local(row, local);
+        }
+
+        auto const recomputed = m_transforms.update();
+        m_recomputed_transforms += recomputed;
+
+        // Query results arrive frames later and can change what is drawn
+        auto const occlusion_changed = m_occlusion && m_occlusion->take_changes();
+
+        if(recomputed == 0u &&
+            m_culled_view_projection == view_projection &&
+            !occlusion_changed)
+        {
+            return;
+        }
+
+        if(m_gpu_culling)
+        {
+            update_gpu_culling(view_projection);
+            return;
+        }
+
+        trace::scoped_span cull_span{"cull"};
+
+        // Bounding spheres follow the instances whose world matrix changed
+        auto const world = m_transforms.world();
+        for(auto const range: m_transforms.changed_ranges())
+        {
+            for(auto node = std::max(range.begin, m_first_instance_node); node < range.end; ++node)
+            {
+                auto const & m = world[node];
+                auto const scale = std::max({
+                    glm::length(glm::vec3{m[0].x, m[0].y, m[0].z}),
+                    glm::length(glm::vec3{m[1].x, m[1].y, m[1].z}),
+                    glm::length(glm::vec3{m[2].x, m[2].y, m[2].z})});
+
+                m_culler.set_sphere(
+                    node - m_first_instance_node,
+                    glm::vec3{m[3].x, m[3].y, m[3].z},
+                    m_bounding_radius * scale);
+            }
+        }
+
+        // Results against another view say nothing about this one
+        if(m_occlusion && m_culled_view_projection != view_projection)
+        {
+            m_occlusion->reset();
+        }
+
+        m_culled_view_projection = view_projection;
+        auto visible = m_culler.cull(frustum::from_matrix(view_projection));
+        auto const instances = world.subspan(m_first_instance_node);
+
+        if(m_occlusion)
+        {
+            auto const in_view = visible.size();
+            visible = remove_occluded(visible);
+            m_occluded_instances = static_cast<std::uint32_t>(in_view - visible.size());
+        }
+
+        if(!std::ranges::equal(visible, m_visible_instances))
+        {
+            // New visible set: repack all of it
+            for(auto const instance: m_visible_instances)
+            {
+                m_instance_slots[instance] = no_slot;
+            }
+            m_visible_instances.assign(visible.begin(), visible.end());
+
+            m_packed_transforms.resize(visible.size());
+            for(auto slot = std::size_t{0}; slot != visible.size(); ++slot)
+            {
+                m_instance_slots[visible[slot]] = static_cast<std::uint32_t>(slot);
+                m_packed_transforms[slot] = instances[visible[slot]];
+            }
+
+            // Weight rows follow their instance into the new slot
+            m_weight_rows_dirty = true;
+
+            if(!m_packed_transforms.empty())
+            {
+                write_buffer(
+                    m_instance_transforms, 0, m_packed_transforms.data(),
+                    m_packed_transforms.size() * sizeof(glm::mat4));
+            }
+
+            return;
+        }
+
+        // Same slots: write the changed visible matrices, one write per run of slots
+        for(auto const range: m_transforms.changed_ranges())
+        {
+            auto const begin = std::max(range.begin, m_first_instance_node) - m_first_instance_node;
+            auto const end = range.end > m_first_instance_node ?
+                range.end - m_first_instance_node : 0u;
+
+            for(auto instance = begin; instance < end;)
+            {
+                auto const first_slot = m_instance_slots[instance];
+                auto run = 1u;
+                while(instance + run < end &&
+                    first_slot != no_slot &&
+                    m_instance_slots[instance + run] == first_slot + run)
+                {
+                    ++run;
+                }
+
+                if(first_slot != no_slot)
+                {
+                    write_buffer(
+                        m_instance_transforms,
+                        first_slot * sizeof(glm::mat4),
+                        &instances[instance],
+                        run * sizeof(glm::mat4));
+                }
+
+                instance += run;
+            }
+        }
+    }
+
+    /*
+     * Sets the bounds of the rows in the view as occlusion proxies and
+     * returns the visible instances whose row is not hidden.
+     */
+    std::span<std::uint32_t const> remove_occluded(std::span<std::uint32_t const> visible)
+    {
+        // Visible instances are sorted, so each row is one run
+        m_proxy_rows.clear();
+        m_proxy_boxes.clear();
+        for(auto const instance: visible)
+        {
+            auto const row = instance / m_grid_columns;
+            auto const sphere = m_culler.sphere(instance);
+            auto const center = glm::vec3{sphere.x, sphere.y, sphere.z};
+            auto const extent = glm::vec3{sphere.w};
+
+            if(m_proxy_rows.empty() || m_proxy_rows.back() != row)
+            {
+                m_proxy_rows.push_back(row);
+                m_proxy_boxes.push_back({ center - extent, center + extent });
+            }
+            else
+            {
+                auto & box = m_proxy_boxes.back();
+                box.min = glm::min(box.min, center - extent);
+                box.max = glm::max(box.max, center + extent);
+            }
+        }
+
+        m_upload_bytes += m_occlusion->set_proxies(
+            m_app.wgpu_queue, m_proxy_rows, m_proxy_boxes);
+
+        m_unoccluded_instances.clear();
+        for(auto const instance: visible)
+        {
+            if(!m_occlusion->hidden(instance / m_grid_columns))
+            {
+                m_unoccluded_instances.push_back(instance);
+            }
+        }
+
+        return m_unoccluded_instances;
+    }
+
+    /*
+     * Uploads the weight row of each instance in the order the draws read
+     * them: packed like the visible world matrices, or by instance for the
+     * cull pass to pack. While every instance uses the shared row the
+     * zeroed buffers are already right.
+     */
+    void upload_weight_rows()
+    {
+        if(!m_weight_rows_dirty || m_weight_row_count == 1u)
+        {
+            return;
+        }
+
+        m_weight_rows_dirty = false;
+
+        if(m_gpu_culling)
+        {
+            write_buffer(
+                m_gpu_culling->instance_weight_rows(), 0, m_instance_weight_rows.data(),
+                m_instance_weight_rows.size() * sizeof(std::uint32_t));
+            m_gpu_cull_pending = true;
+            return;
+        }
+
+        m_packed_weight_rows.resize(m_visible_instances.size());
+        for(auto slot = std::size_t{0}; slot != m_visible_instances.size(); ++slot)
+        {
+            m_packed_weight_rows[slot] = m_instance_weight_rows[m_visible_instances[slot]];
+        }
+
+        if(!m_packed_weight_rows.empty())
+        {
+            write_buffer(
+                m_morph_weight_rows, 0, m_packed_weight_rows.data(),
+                m_packed_weight_rows.size() * sizeof(std::uint32_t));
+        }
+    }
+
+    /* Uploads the changed world matrices and schedules a cull pass */
+    void update_gpu_culling(glm::mat4 const & view_projection)
+    {
+        auto const world = m_transforms.world();
+        for(auto const range: m_transforms.changed_ranges())
+        {
+            auto const begin = std::max(range.begin, m_first_instance_node);
+            if(begin >= range.end)
+            {
+                continue;
+            }
+
+            write_buffer(
+                m_gpu_culling->world_transforms(),
+                (begin - m_first_instance_node) * sizeof(glm::mat4),
+                &world[begin],
+                (range.end - begin) * sizeof(glm::mat4));
+        }
+
+        if(m_culled_view_projection != view_projection)
+        {
+            m_culled_view_projection = view_projection;
+            m_upload_bytes += m_gpu_culling->update(
+                m_app.wgpu_queue, frustum::from_matrix(view_projection));
+        }
+
+        m_gpu_cull_pending = true;
+    }
+
+    /* Radius around the origin containing every morph target */
+    static float mesh_bounding_radius()
+    {
+        auto radius = 0.0f;
+        for(auto const * target:
+            {
+                &cube_vertex_data,
+                &hedron_vertex_data,
+                &spikes_vertex_data,
+                &tile1_vertex_data,
+                &tile2_vertex_data
+            })
+        {
+            for(auto const & p: *target)
+            {
+                radius = std::max(radius, glm::length(p));
+            }
+        }
+
+        return radius;
+    }
+
+    template <typename Container>
+    WGPUBuffer create_vertex_buffer(Container const & data, char const * label)
+    {
+        return create_buffer_with_data(data, WGPUBufferUsage_Vertex, label);
     }
 
     template <typename Container>
     WGPUBuffer create_index_buffer(Container const & data, char const * label)
+    {
+        return create_buffer_with_data(data, WGPUBufferUsage_Index, label);
+    }
+
+    // Creates the buffer mapped and copies the data straight into the mapped
+    // range, avoiding the extra staging copy done by wgpuQueueWriteBuffer.
+    template <typename Container>
+    WGPUBuffer create_buffer_with_data(
+        Container const & data, WGPUBufferUsageFlags usage, char const * label)
     {
         auto const size = data.size() * sizeof(typename Container::value_type);
+        auto const mapped_size = (size + 3u) & ~std::size_t{3u};
         WGPUBufferDescriptor const descriptor =
         {
             .nextInChain = nullptr,
             .label = label,
-            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Index,
-            .size = size,
-            .mappedAtCreation = false
+            .usage = usage,
+            .size = mapped_size,
+            .mappedAtCreation = true
         };
 
-        WGPUBuffer buffer =
-            wgpuDeviceCreateBuffer(m_app.wgpu_device, &descriptor);
+        WGPUBuffer buffer = m_app.memory.create_buffer(m_app.wgpu_device, descriptor);
 
-        wgpuQueueWriteBuffer(
-            m_app.wgpu_queue,
-            buffer,
-            0,
-            data.data(),
-            data.size() * sizeof(typename Container::value_type));
+        if(!buffer)
+        {
+            throw std::runtime_error{"Buffer creation failed"};
+        }
+
+        void * mapped = wgpuBufferGetMappedRange(buffer, 0, mapped_size);
+
+        if(!mapped)
+        {
+            m_app.memory.release(buffer);
+            throw std::runtime_error{"Mapping buffer at creation failed"};
+        }
+
+        std::memcpy(mapped, data.data(), size);
+        wgpuBufferUnmap(buffer);
 
         return buffer;
     }
@@ -973,9 +2275,24 @@ class frame_renderer
             .mappedAtCreation = false
         };
 
-        return wgpuDeviceCreateBuffer(m_app.wgpu_device, &descriptor);
+        return m_app.memory.create_buffer(m_app.wgpu_device, descriptor);
     }
 
+    // Position scale and bias follow morph_t in the transformation uniform,
+    // then the target and vertex counts used by blended morphing
+    static constexpr std::uint64_t quantization_uniform_offset = 80u;
+    static constexpr std::uint64_t morph_info_uniform_offset = 112u;
+
+    static constexpr std::size_t morph_target_count = 5;
+
+    // Instance grid: side length in world units, time each row spins
+    static constexpr float grid_extent = 6.0f;
+    static constexpr std::uint32_t row_spin_ms = 2000u;
+
+    // Pipeline ids used in draw sort keys
+    static constexpr std::uint32_t front_face_pipeline_id = 0;
+    static constexpr std::uint32_t back_face_pipeline_id = 1;
+
     static constexpr WGPUCommandEncoderDescriptor command_encoder_descriptor =
     {
         .nextInChain = nullptr,
@@ -996,58 +2313,196 @@ class frame_renderer
         int_to_glm_color(0xFFFFEFEF),
     };
 
-    static constexpr WGPUShaderModuleWGSLDescriptor mesh_shader_code_descriptor =
+    // Default mesh shader, replaced by --shader=<file> and hot reloads
+    static constexpr char const * builtin_mesh_shader = R"WGSL(
+struct vertex_transform
+{
+    projection: mat4x4f,
+    morph_t: f32,
+    position_scale: vec4f,
+    position_bias: vec4f,
+    morph_target_count: u32,
+    morph_vertex_count: u32,
+};
+
+@group(0) @binding(0) var<uniform> transform: vertex_transform;
+@group(0) @binding(1) var<uniform> color: vec4f;
+
+struct instance_input
+{
+    @location(2) world_0: vec4f,
+    @location(3) world_1: vec4f,
+    @location(4) world_2: vec4f,
+    @location(5) world_3: vec4f,
+};
+
+fn world_matrix(instance: instance_input) -> mat4x4f
+{
+    return mat4x4f(instance.world_0, instance.world_1, instance.world_2, instance.world_3);
+}
+
+@vertex
+fn vs_main(
+    @location(0) src_vertex: vec3f,
+    @location(1) dst_vertex: vec3f,
+    instance: instance_input)
+    -> @builtin(position) vec4f
+{
+    let encoded_pos = mix(src_vertex, dst_vertex, transform.morph_t);
+    let vertex_pos =
+        encoded_pos * transform.position_scale.xyz + transform.position_bias.xyz;
+    return transform.projection * world_matrix(instance) * vec4f(vertex_pos, 1.0);
+}
+
+@group(0) @binding(2) var<storage, read> morph_targets: array<vec4f>;
+@group(0) @binding(3) var<storage, read> morph_weights: array<f32>;
+@group(0) @binding(4) var<storage, read> morph_weight_rows: array<u32>;
+
+@vertex
+fn vs_blend(
+    @builtin(vertex_index) vertex_index: u32,
+    @builtin(instance_index) instance_index: u32,
+    instance: instance_input)
+    -> @builtin(position) vec4f
+{
+    // Row 0 holds the shared weights, the others per-instance mixes
+    let weights_base = morph_weight_rows[instance_index] * transform.morph_target_count;
+    var encoded_pos = vec3f(0.0);
+    for(var target_index = 0u; target_index < transform.morph_target_count; target_index++)
+    {
+        let weight = morph_weights[weights_base + target_index];
+        if(weight != 0.0)
+        {
+            let index = target_index * transform.morph_vertex_count + vertex_index;
+            encoded_pos += weight * morph_targets[index].xyz;
+        }
+    }
+
+    let vertex_pos =
+        encoded_pos * transform.position_scale.xyz + transform.position_bias.xyz;
+    return transform.projection * world_matrix(instance) * vec4f(vertex_pos, 1.0);
+}
+
+@fragment
+fn fs_main() -> @location(0) vec4f
+{
+    return color;
+}
+)WGSL";
+
+    static constexpr std::array binding_layout_entries
+    {
+        WGPUBindGroupLayoutEntry
+        {
+            .nextInChain = nullptr,
+            .binding = 0,
+            .visibility = WGPUShaderStage_Vertex,
+            .buffer = 
+            {
+                .nextInChain = nullptr,
+                .type = WGPUBufferBindingType_Uniform,
+                .hasDynamicOffset = false,
+                .minBindingSize = sizeof(glm::mat4) * 2
+            },
+            .sampler =
+            {
+                .nextInChain = nullptr,
+                .type = WGPUSamplerBindingType_Undefined
+            },
+            .texture =
+            {
+                .nextInChain = nullptr,
+                .sampleType = WGPUTextureSampleType_Undefined,
+                .viewDimension = WGPUTextureViewDimension_Undefined,
+                .multisampled = false
+            },
+            .storageTexture =
+            {
+                .nextInChain = nullptr,
+                .access = WGPUStorageTextureAccess_Undefined,
+                .format = WGPUTextureFormat_Undefined,
+                .viewDimension = WGPUTextureViewDimension_Undefined
+            }
+        },
+        WGPUBindGroupLayoutEntry
+        {
+            .nextInChain = nullptr,
+            .binding = 1,
+            .visibility = WGPUShaderStage_Fragment,
+            .buffer = 
+            {
+                .nextInChain = nullptr,
+                .type = WGPUBufferBindingType_Uniform,
+                .hasDynamicOffset = true,
+                .minBindingSize = sizeof(WGPUColor)
+            },
+            .sampler =
+            {
+                .nextInChain = nullptr,
+                .type = WGPUSamplerBindingType_Undefined
+            },
+            .texture =
+            {
+                .nextInChain = nullptr,
+                .sampleType = WGPUTextureSampleType_Undefined,
+                .viewDimension = WGPUTextureViewDimension_Undefined,
+                .multisampled = false
+            },
+            .storageTexture =
+            {
+                .nextInChain = nullptr,
+                .access = WGPUStorageTextureAccess_Undefined,
+                .format = WGPUTextureFormat_Undefined,
+                .viewDimension = WGPUTextureViewDimension_Undefined
+            }
+        } 
+    };
+
+    static constexpr std::array morph_storage_layout_entries
     {
-        .chain =
-        { 
-            .next = nullptr,
-            .sType = WGPUSType_ShaderModuleWGSLDescriptor
+        WGPUBindGroupLayoutEntry
+        {
+            .nextInChain = nullptr,
+            .binding = 2,
+            .visibility = WGPUShaderStage_Vertex,
+            .buffer =
+            {
+                .nextInChain = nullptr,
+                .type = WGPUBufferBindingType_ReadOnlyStorage,
+                .hasDynamicOffset = false,
+                .minBindingSize = sizeof(glm::vec4)
+            },
+            .sampler =
+            {
+                .nextInChain = nullptr,
+                .type = WGPUSamplerBindingType_Undefined
+            },
+            .texture =
+            {
+                .nextInChain = nullptr,
+                .sampleType = WGPUTextureSampleType_Undefined,
+                .viewDimension = WGPUTextureViewDimension_Undefined,
+                .multisampled = false
+            },
+            .storageTexture =
+            {
+                .nextInChain = nullptr,
+                .access = WGPUStorageTextureAccess_Undefined,
+                .format = WGPUTextureFormat_Undefined,
+                .viewDimension = WGPUTextureViewDimension_Undefined
+            }
         },
-        .code = R"WGSL(
-struct vertex_transform
-{
-    projection: mat4x4f,
-    morph_t: f32,
-};
-
-@group(0) @binding(0) var<uniform> transform: vertex_transform;
-@group(0) @binding(1) var<uniform> color: vec4f;
-
-@vertex
-fn vs_main(@location(0) src_vertex: vec3f, @location(1) dst_vertex: vec3f)
-    -> @builtin(position) vec4f
-{
-    let vertex_pos = mix(src_vertex, dst_vertex, transform.morph_t);
-    return transform.projection * vec4f(vertex_pos, 1.0);
-}
-
-@fragment
-fn fs_main() -> @location(0) vec4f
-{
-    return color;
-}
-        )WGSL"
-    };
-
-    static constexpr WGPUShaderModuleDescriptor shader_module_descriptor =
-    {
-        .nextInChain = &mesh_shader_code_descriptor.chain,
-        .label = "ShaderModule"
-    };
-
-    static constexpr std::array binding_layout_entries
-    {
         WGPUBindGroupLayoutEntry
         {
             .nextInChain = nullptr,
-            .binding = 0,
+            .binding = 3,
             .visibility = WGPUShaderStage_Vertex,
-            .buffer = 
+            .buffer =
             {
                 .nextInChain = nullptr,
-                .type = WGPUBufferBindingType_Uniform,
+                .type = WGPUBufferBindingType_ReadOnlyStorage,
                 .hasDynamicOffset = false,
-                .minBindingSize = sizeof(glm::mat4) * 2
+                .minBindingSize = sizeof(float)
             },
             .sampler =
             {
@@ -1072,14 +2527,14 @@ fn fs_main() -> @location(0) vec4f
         WGPUBindGroupLayoutEntry
         {
             .nextInChain = nullptr,
-            .binding = 1,
-            .visibility = WGPUShaderStage_Fragment,
-            .buffer = 
+            .binding = 4,
+            .visibility = WGPUShaderStage_Vertex,
+            .buffer =
             {
                 .nextInChain = nullptr,
-                .type = WGPUBufferBindingType_Uniform,
-                .hasDynamicOffset = true,
-                .minBindingSize = sizeof(WGPUColor)
+                .type = WGPUBufferBindingType_ReadOnlyStorage,
+                .hasDynamicOffset = false,
+                .minBindingSize = sizeof(std::uint32_t)
             },
             .sampler =
             {
@@ -1100,7 +2555,7 @@ fn fs_main() -> @location(0) vec4f
                 .format = WGPUTextureFormat_Undefined,
                 .viewDimension = WGPUTextureViewDimension_Undefined
             }
-        } 
+        }
     };
 
     static constexpr std::array cube_vertex_data
@@ -1242,25 +2697,104 @@ fn fs_main() -> @location(0) vec4f
     };
 
     wgpu_app & m_app;
+    vertex_encoding m_vertex_encoding;
+    morph_mode m_morph_mode;
+    std::uint32_t m_instance_count;
+    culling_mode m_culling_mode;
+    bool m_occlusion_culling;
+    position_quantization m_quantization;
+    std::string m_shader_source;
     WGPUShaderModule m_shader_module = nullptr;
+    WGPUPipelineLayout m_pipeline_layout = nullptr;
     WGPURenderPipeline m_front_face_pipeline = nullptr;
     WGPURenderPipeline m_back_face_pipeline = nullptr;
-
-    std::array<WGPUBuffer, 5> m_shape_vertex_buffers;
+    std::unique_ptr<shader_reload> m_reload;
+    std::optional<std::string> m_queued_shader_source;
+
+    std::array<WGPUBuffer, morph_target_count> m_shape_vertex_buffers{};
+    WGPUBuffer m_morph_targets = nullptr;
+    WGPUBuffer m_morph_weights = nullptr;
+    WGPUBuffer m_morph_weight_rows = nullptr;
+    std::vector<std::uint32_t> m_instance_weight_rows;
+    std::vector<std::uint32_t> m_packed_weight_rows;
+    std::uint32_t m_weight_row_count = 1u;
+    bool m_weight_rows_dirty = false;
 
     WGPUBuffer m_indices1;
     WGPUBuffer m_indices2;
 
+    transform_hierarchy m_transforms;
+    std::uint32_t m_first_row_node = 0u;
+    std::uint32_t m_first_instance_node = 0u;
+    std::optional<std::uint32_t> m_posed_time;
+    std::uint64_t m_recomputed_transforms = 0u;
+    WGPUBuffer m_instance_transforms = nullptr;
+
+    static constexpr std::uint32_t no_slot = ~std::uint32_t{0};
+
+    frustum_culler m_culler;
+    std::optional<gpu_culling> m_gpu_culling;
+    bool m_gpu_cull_pending = false;
+    float m_bounding_radius = 0.0f;
+    std::optional<glm::mat4> m_culled_view_projection;
+    std::vector<std::uint32_t> m_visible_instances;
+    std::vector<std::uint32_t> m_instance_slots;
+    std::vector<glm::mat4> m_packed_transforms;
+
+    std::optional<occlusion_culler> m_occlusion;
+    std::uint32_t m_grid_columns = 1u;
+    std::vector<std::uint32_t> m_proxy_rows;
+    std::vector<occlusion_culler::box> m_proxy_boxes;
+    std::vector<std::uint32_t> m_unoccluded_instances;
+    std::uint32_t m_occluded_instances = 0u;
+
     WGPUBuffer m_transformation_uniform;
     WGPUBuffer m_color_uniform;
     WGPUBindGroup m_bind_group;
 
+    static constexpr std::uint32_t max_animation_step_ms = 100u;
+
+    /* Uniform values as last written to the GPU */
+    struct uploaded_uniforms
+    {
+        bool valid = false;
+        glm::mat4 transform;
+        float morph_time = 0.0f;
+        std::size_t morph_source = 0;
+    };
+
     glm::mat4 m_projection_matrix;
+    std::uint32_t m_animation_time = 0u;
     float m_morph_time = 0.0f;
     std::size_t m_morph_index = 0;
+    bool m_animating = true;
+    bool m_dirty = true;
+    uploaded_uniforms m_uploaded;
+
+    std::array<draw_item, 3> m_mesh_draws{};
+    render_queue m_render_queue;
+    render_pass_statistics m_pass_statistics;
+
+    gpu_timer m_timer;
+    dynamic_resolution m_resolution;
+    double m_gpu_frame_ms = 0.0;
+    std::uint64_t m_upload_bytes = 0u;
+
+    /* Totals when the HUD last showed them, for per frame counts */
+    struct hud_counted_totals
+    {
+        std::uint64_t draws = 0u;
+        std::uint64_t state_calls = 0u;
+        std::uint64_t upload_bytes = 0u;
+    };
+
+    std::optional<performance_hud> m_hud;
+    bool m_hud_visible = false;
+    hud_counted_totals m_hud_counted;
+    std::chrono::steady_clock::time_point m_last_hud_frame;
 }; /* class frame_renderer */
 
-void print_wgpu_info(wgpu_app const & app)
+void print_wgpu_info(wgpu_app & app)
 {
     WGPUAdapterProperties properties
     {
@@ -1280,6 +2814,7 @@ void print_wgpu_info(wgpu_app const & app)
     std::cout << " - backendType: " << properties.backendType << '\n';
     std::cout << " - compatibilityMode: " <<
         (properties.compatibilityMode ? "true" : "false") << '\n';
+    std::cout << "Surface format: " << surface_format_name(app.surface_format) << '\n';
 
     WGPUSupportedLimits supported_limits;
     if(wgpuAdapterGetLimits(app.wgpu_adapter, &supported_limits))
@@ -1301,55 +2836,447 @@ void print_wgpu_info(wgpu_app const & app)
     {
         std::cout << " - " << feature << '\n';
     }
+
+    std::cout << "Device tier: " << device_tier_name(app.device_config.tier) << '\n';
+    std::cout << "Enabled device features:\n";
+    for(auto const feature: app.device_config.features)
+    {
+        std::cout << " - " << feature << '\n';
+    }
+
+    texture_loader const textures{app.wgpu_device, app.wgpu_queue, app.memory};
+    std::cout << "Preferred texture family: " <<
+        texture_family_suffix(textures.preferred_family()) << '\n';
 }
 
+struct demo_options
+{
+    vertex_encoding encoding = vertex_encoding::snorm16x4;
+    morph_mode morph = morph_mode::blend;
+    resolution_settings resolution;
+    std::string trace_path;
+    std::string telemetry_name;
+    std::string shader_path;
+    std::string expected_calls_path;
+    std::size_t max_frames = 0u;
+    std::uint32_t fixed_step_ms = 0u;
+    std::uint32_t instances = 1u;
+    culling_mode culling = culling_mode::cpu;
+    bool occlusion = false;
+    bool hud = false;
+    std::uint64_t memory_budget = gpu_memory::no_budget;
+    budget_policy memory_policy = budget_policy::warn;
+    present_policy present = present_policy::adaptive;
+
+    static demo_options parse(int argc, char const * argv[])
+    {
+        auto options = demo_options{};
+
+        for(auto i = 1; i < argc; ++i)
+        {
+            auto const arg = std::string_view{argv[i]};
+
+            if(auto const value = option_value(arg, "--vertex-encoding="))
+            {
+                if(!parse_vertex_encoding(*value, options.encoding))
+                {
+                    throw std::runtime_error{
+                        "Unknown vertex encoding: " + std::string{*value}};
+                }
+            }
+            else if(auto const value = option_value(arg, "--morph="))
+            {
+                if(!parse_morph_mode(*value, options.morph))
+                {
+                    throw std::runtime_error{
+                        "Unknown morph mode: " + std::string{*value}};
+                }
+            }
+            else if(auto const value = option_value(arg, "--culling="))
+            {
+                if(!parse_culling_mode(*value, options.culling))
+                {
+                    throw std::runtime_error{
+                        "Unknown culling mode: " + std::string{*value}};
+                }
+            }
+            else if(auto const value = option_value(arg, "--min-scale="))
+            {
+                options.resolution.min_scale = parse_number<float>(arg, *value);
+            }
+            else if(auto const value = option_value(arg, "--max-scale="))
+            {
+                options.resolution.max_scale = parse_number<float>(arg, *value);
+            }
+            else if(auto const value = option_value(arg, "--target-fps="))
+            {
+                options.resolution.target_frame_ms =
+                    1000.0 / parse_number<double>(arg, *value);
+            }
+            else if(auto const value = option_value(arg, "--memory-budget="))
+            {
+                options.memory_budget = static_cast<std::uint64_t>(
+                    parse_number<double>(arg, *value) * 1024.0 * 1024.0);
+            }
+            else if(auto const value = option_value(arg, "--memory-budget-policy="))
+            {
+                if(!parse_budget_policy(*value, options.memory_policy))
+                {
+                    throw std::runtime_error{
+                        "Unknown memory budget policy: " + std::string{*value}};
+                }
+            }
+            else if(auto const value = option_value(arg, "--present-mode="))
+            {
+                if(!parse_present_policy(*value, options.present))
+                {
+                    throw std::runtime_error{
+                        "Unknown present mode: " + std::string{*value}};
+                }
+            }
+            else if(auto const value = option_value(arg, "--trace="))
+            {
+                options.trace_path = *value;
+            }
+            else if(auto const value = option_value(arg, "--shader="))
+            {
+                options.shader_path = *value;
+            }
+            else if(auto const value = option_value(arg, "--telemetry="))
+            {
+                options.telemetry_name = *value;
+            }
+            else if(auto const value = option_value(arg, "--frames="))
+            {
+                options.max_frames = parse_number<std::size_t>(arg, *value);
+            }
+            else if(auto const value = option_value(arg, "--fixed-step="))
+            {
+                options.fixed_step_ms = parse_number<std::uint32_t>(arg, *value);
+            }
+            else if(auto const value = option_value(arg, "--expect-calls="))
+            {
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+                options.expected_calls_path = *value;
+#else
+                throw std::runtime_error{
+                    "--expect-calls needs a build with SDL_WEBGPU_MOCK_BACKEND"};
+#endif
+            }
+            else if(auto const value = option_value(arg, "--instances="))
+            {
+                options.instances = parse_number<std::uint32_t>(arg, *value);
+            }
+            else if(arg == "--hud")
+            {
+                options.hud = true;
+            }
+            else if(arg == "--occlusion")
+            {
+                options.occlusion = true;
+            }
+            else
+            {
+                throw std::runtime_error{
+                    "Unknown argument: " + std::string{arg}};
+            }
+        }
+
+        return options;
+    }
+
+    private:
+    static std::optional<std::string_view> option_value(
+        std::string_view arg, std::string_view name)
+    {
+        if(arg.substr(0, name.size()) != name)
+        {
+            return std::nullopt;
+        }
+
+        return arg.substr(name.size());
+    }
+
+    template <typename T>
+    static T parse_number(std::string_view arg, std::string_view value)
+    {
+        auto result = T{};
+        auto const [end, error] =
+            std::from_chars(value.data(), value.data() + value.size(), result);
+
+        if(error != std::errc{} || end != value.data() + value.size() || !(result > T{0}))
+        {
+            throw std::runtime_error{"Invalid value: " + std::string{arg}};
+        }
+
+        return result;
+    }
+};
+
 int main(int argc, char const * argv[])
 {
     try
     {
+        auto const options = demo_options::parse(argc, argv);
+
+        if(!options.trace_path.empty())
+        {
+            trace::enable(true);
+            trace::name_thread("main");
+        }
+
+        // Outlives the device, whose release may still deliver work done callbacks
+        latency_tracker latency;
+
         wgpu_app app;
+        app.memory.set_budget(options.memory_budget, options.memory_policy);
 
         print_wgpu_info(app);
 
-        frame_renderer renderer(app);
+        // Recreated from scratch when the device is lost
+        auto renderer = std::optional<frame_renderer>{};
+        // Hot reloads start from the built-in shader when the file is new
+        auto shader_source = std::string{frame_renderer::builtin_shader()};
+        std::optional<file_watcher> shader_watcher;
+        if(!options.shader_path.empty())
+        {
+            if(!std::filesystem::exists(options.shader_path))
+            {
+                write_text_file(options.shader_path, shader_source);
+                std::cout << "Wrote the built-in shader to " << options.shader_path << '\n';
+            }
+
+            shader_source = read_text_file(options.shader_path);
+            shader_watcher.emplace(options.shader_path);
+            std::cout << "Watching " << options.shader_path << " for changes\n";
+        }
+
+        renderer.emplace(
+            app, options.encoding, options.morph, options.resolution, shader_source,
+            options.instances, options.culling, options.occlusion);
+        renderer->set_hud_visible(options.hud);
+
+        std::cout <<
+            "Morph mode: " << morph_mode_name(renderer->active_morph_mode()) << '\n';
+        if(renderer->active_morph_mode() != morph_mode::blend)
+        {
+            // Blended morphing reads unquantized positions from storage
+            std::cout <<
+                "Vertex encoding: " << vertex_encoding_name(options.encoding) << '\n';
+        }
+        std::cout <<
+            "Culling: " << culling_mode_name(renderer->active_culling_mode()) <<
+            (renderer->occlusion_culling() ? " with occlusion queries" : "") << '\n';
+        if(options.occlusion && !renderer->occlusion_culling())
+        {
+            std::cout << "Occlusion culling needs CPU culling and at most " <<
+                occlusion_culler::max_objects << " grid rows, disabled\n";
+        }
+        std::cout <<
+            "Frame timing: " <<
+            (renderer->frame_timer().uses_timestamps() ? "timestamp queries" : "CPU") << '\n';
 
         auto done = false;
         auto const begin_time = SDL_GetTicks();
         auto prev_time = begin_time;
         auto frame_count = std::size_t{0};
 
+        frame_scheduler scheduler(app.sdl_window);
+
+        present_mode_controller present_modes{
+            options.present, present_mode_controller::refresh_rate(app.sdl_window)};
+        if(present_modes.mode() != app.present_mode &&
+            !app.set_present_mode(present_modes.mode()))
+        {
+            std::cout <<
+                present_mode_name(present_modes.mode()) <<
+                " is not supported by the surface\n";
+            present_modes.reject(present_modes.mode());
+        }
+        std::cout <<
+            "Present mode: " << present_policy_name(options.present) << ", starting with " <<
+            present_mode_name(app.present_mode) << '\n';
+
+        // Live counters for webgpu-telemetry, see telemetry_reader.cpp
+        std::optional<telemetry::writer> telemetry_writer;
+        if(!options.telemetry_name.empty())
+        {
+            telemetry_writer.emplace(options.telemetry_name);
+            std::cout << "Publishing telemetry as " << options.telemetry_name << '\n';
+        }
+
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+        // WebGPU calls made by the latest render(), the CPU cost to keep an eye on
+        auto frame_calls = webgpu_mock::statistics{};
+#endif
+
         while(!done)
         {
-            auto event = SDL_Event{};
-            while(SDL_PollEvent(&event))
+            WEBGPU_SDL_TRACE_SCOPE("frame");
+
+            trace::scoped_span wait_span{"wait events"};
+            scheduler.wait([&done, &app, &latency, &renderer](SDL_Event const & event)
             {
+                latency.input_event(event);
+
                 if(event.type == SDL_QUIT)
                 {
                     done = true;
                 }
+                else if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_l)
+                {
+                    wgpuDeviceForceLoss(
+                        app.wgpu_device, WGPUDeviceLostReason_Undefined,
+                        "Device loss requested from keyboard");
+                }
+                else if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_p)
+                {
+                    renderer->set_animating(!renderer->animating());
+                }
+                else if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_h)
+                {
+                    renderer->set_hud_visible(!renderer->hud_visible());
+                }
+            });
+            wait_span.end();
+
+            if(shader_watcher && shader_watcher->changed())
+            {
+                try
+                {
+                    renderer->reload_shader(read_text_file(shader_watcher->path()));
+                }
+                catch(std::runtime_error const & e)
+                {
+                    std::cerr << e.what() << '\n';
+                }
+            }
+
+            // Scene damage is tracked by the renderer, window damage by the scheduler
+            scheduler.set_animating(renderer->animating());
+            if(renderer->needs_redraw())
+            {
+                scheduler.request_frame();
+            }
+
+            // Delivers device lost, map and work done callbacks, e.g. frame
+            // timings, also on iterations that render nothing
+            {
+                WEBGPU_SDL_TRACE_SCOPE("device tick");
+                wgpuDeviceTick(app.wgpu_device);
+            }
+
+            if(app.device_loss.lost())
+            {
+                WEBGPU_SDL_TRACE_SCOPE("device recovery");
+                std::cerr << "Device lost: " << app.device_loss.message() << '\n';
+
+                auto const recovery_begin = SDL_GetPerformanceCounter();
+                auto const animation = renderer->animation();
+                auto const hud_visible = renderer->hud_visible();
+                auto shader = renderer->shader_source();
+
+                renderer.reset();
+                app.recover_device();
+                renderer.emplace(
+                    app, options.encoding, options.morph, options.resolution, std::move(shader),
+                    options.instances, options.culling, options.occlusion);
+                renderer->set_animation(animation);
+                renderer->set_hud_visible(hud_visible);
+
+                auto const recovery_ms =
+                    1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - recovery_begin) /
+                    static_cast<double>(SDL_GetPerformanceFrequency());
+                std::cout <<
+                    "Device recovered in " << recovery_ms << "ms, " <<
+                    app.pipeline_cache.hits() << " pipeline cache hits\n";
+
+                scheduler.request_frame();
+            }
+
+            if(done || !scheduler.frame_due())
+            {
+                continue;
             }
 
             auto const current_time = SDL_GetTicks();
-            auto const delta_time = current_time - prev_time;
-            auto const elapsed_time = current_time - begin_time;
+            // A fixed step makes every run animate, and so upload, the same way
+            auto const delta_time =
+                options.fixed_step_ms != 0u ? options.fixed_step_ms : current_time - prev_time;
 
+            trace::scoped_span acquire_span{"acquire"};
             WGPUTextureView next_texture =
                 wgpuSwapChainGetCurrentTextureView(app.wgpu_swap_chain);
+            acquire_span.end();
 
             if(!next_texture)
             {
                 std::cerr <<
                     "Retrieving next texture view from swap chain failed\n";
+                scheduler.acquire_failed();
                 continue;
             }
 
-            renderer.render(next_texture, elapsed_time, delta_time);
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+            auto const calls_before_render = webgpu_mock::snapshot();
+#endif
+            renderer->advance(delta_time);
+            renderer->render(next_texture);
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+            frame_calls = webgpu_mock::difference(webgpu_mock::snapshot(), calls_before_render);
+#endif
+            latency.frame_submitted(app.wgpu_queue);
 
             wgpuTextureViewRelease(next_texture);
+
+            trace::scoped_span present_span{"present"};
             wgpuSwapChainPresent(app.wgpu_swap_chain);
+            scheduler.frame_presented();
+            latency.frame_presented();
+            present_span.end();
+
+            if(present_modes.frame_presented())
+            {
+                WEBGPU_SDL_TRACE_SCOPE("present mode switch");
+                auto const mode = present_modes.mode();
+                if(app.set_present_mode(mode))
+                {
+                    std::cout << "Switched to " << present_mode_name(mode) << '\n';
+                }
+                else
+                {
+                    std::cout <<
+                        present_mode_name(mode) << " is not supported by the surface, staying with " <<
+                        present_mode_name(app.present_mode) << '\n';
+                    present_modes.reject(mode);
+                }
+            }
+
+            if(telemetry_writer)
+            {
+                auto const & statistics = renderer->pass_statistics();
+                telemetry_writer->publish(
+                {
+                    .gpu_ms = renderer->gpu_frame_ms(),
+                    .draw_calls_total = statistics.draws,
+                    .state_calls_issued_total = statistics.issued,
+                    .state_calls_elided_total = statistics.elided,
+                    .upload_bytes_total = renderer->upload_bytes(),
+                    .gpu_memory_bytes = app.memory.current_bytes(),
+                    .gpu_memory_peak_bytes = app.memory.peak_bytes(),
+                    .frames_in_flight = renderer->frame_timer().frames_in_flight(),
+                    .present_mode = telemetry_present_mode(app.present_mode),
+                    .resolution_scale = renderer->resolution_scale(),
+                });
+            }
 
             prev_time = current_time;
             ++frame_count;
+
+            if(frame_count == options.max_frames)
+            {
+                done = true;
+            }
         }
         auto const elapsed_time = prev_time - begin_time;
         std::cout << frame_count << " frames in " << elapsed_time << "ms\n";
@@ -1358,6 +3285,57 @@ int main(int argc, char const * argv[])
             static_cast<double>(elapsed_time);
         std::cout << frame_rate << "Hz\n";
 
+        auto const & pass_statistics = renderer->pass_statistics();
+        std::cout <<
+            "Render pass state calls: " <<
+            pass_statistics.issued << " issued, " <<
+            pass_statistics.elided << " elided, " <<
+            pass_statistics.draws << " draws\n";
+        std::cout << "Final resolution scale: " << renderer->resolution_scale() << '\n';
+        std::cout <<
+            "World matrices recomputed: " << renderer->recomputed_transforms() <<
+            " for " << renderer->instance_count() << " instances\n";
+        if(renderer->active_culling_mode() == culling_mode::cpu)
+        {
+            std::cout << "Visible instances: " << renderer->visible_instance_count() << '\n';
+        }
+        if(renderer->occlusion_culling())
+        {
+            std::cout << "Occluded instances: " << renderer->occluded_instance_count() << '\n';
+        }
+        latency.report(std::cout);
+        std::cout << "Present mode switches: " << present_modes.switches() << '\n';
+        app.memory.report(std::cout);
+
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+        std::cout << "WebGPU calls in the last frame: ";
+        webgpu_mock::report(std::cout, frame_calls);
+#endif
+
+        if(trace::enabled())
+        {
+            trace::write_chrome_json(options.trace_path);
+            std::cout << "Trace written to " << options.trace_path << '\n';
+        }
+
+#if defined(SDL_WEBGPU_MOCK_BACKEND)
+        // Regression gate, see demo/frame_calls
+        if(!options.expected_calls_path.empty())
+        {
+            auto baseline = std::istringstream{read_text_file(options.expected_calls_path)};
+            auto const expected = webgpu_mock::parse_report(baseline);
+
+            auto drift = std::ostringstream{};
+            if(webgpu_mock::report_drift(drift, expected, frame_calls))
+            {
+                std::cerr << "WebGPU calls in the last frame drifted:\n" << drift.str();
+                throw std::runtime_error{
+                    "WebGPU calls differ from " + options.expected_calls_path};
+            }
+            std::cout << "WebGPU calls match " << options.expected_calls_path << '\n';
+        }
+#endif
+
     }
     catch (std::exception const & e)
     {
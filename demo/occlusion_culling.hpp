@@ -0,0 +1,684 @@
+#ifndef SDL_WEBGPU_DEMO_OCCLUSION_CULLING_HPP
+#define SDL_WEBGPU_DEMO_OCCLUSION_CULLING_HPP
+
+#include "gpu_memory.hpp"
+#include "render_pass_state.hpp"
+#include "trace.hpp"
+
+#include <webgpu/webgpu.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/*
+ * Skips objects that were hidden behind others in recent frames. After
+ * the scene is drawn, every object in the view gets a bounding box proxy
+ * drawn inside its own occlusion query, depth tested against the scene
+ * but writing nothing; the query counts the samples that passed. The
+ * counts are resolved into a ring of readback buffers like the GPU timer's
+ * and arrive a few frames later without stalling.
+ *
+ * Hidden objects keep their proxies, so they are re-tested every frame and
+ * reappear with the first result that shows samples. Hiding is the
+ * conservative direction: it takes hide_after occluded results in a row,
+ * objects entering the view start visible, and reset() makes everything
+ * visible again and drops the results still in flight.
+ */
+class occlusion_culler
+{
+    public:
+    static constexpr std::uint32_t slot_count = 3u;
+    static constexpr std::uint32_t hide_after = 2u;
+
+    // Largest query set WebGPU allows
+    static constexpr std::uint32_t max_objects = 4096u;
+
+    static constexpr WGPUTextureFormat depth_format = WGPUTextureFormat_Depth32Float;
+
+    struct box
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    static bool supported(std::uint32_t object_count)
+    {
+        return object_count != 0u && object_count <= max_objects;
+    }
+
+    /* Depth state of the pipelines drawing the scene the proxies test against */
+    static WGPUDepthStencilState scene_depth_state()
+    {
+        return depth_state(true, WGPUCompareFunction_Less);
+    }
+
+    /*
+     * layout must be the scene's pipeline layout, whose group 0 starts with
+     * the view projection matrix at binding 0; width and height are the
+     * size of the scene target.
+     */
+    occlusion_culler(
+        WGPUDevice device,
+        gpu_memory & memory,
+        std::uint32_t object_count,
+        WGPUPipelineLayout layout,
+        WGPUTextureFormat color_format,
+        std::uint32_t width,
+        std::uint32_t height) :
+        m_device(device),
+        m_memory(memory),
+        m_occluded_results(object_count, 0u),
+        m_hidden(object_count, 0u),
+        m_tested(object_count, 0u)
+    {
+        if(!supported(object_count))
+        {
+            throw std::runtime_error{"Too many objects for occlusion queries"};
+        }
+
+        for(auto & slot: m_slots)
+        {
+            slot.owner = this;
+        }
+
+        try
+        {
+            create_resources(object_count, width, height);
+            create_pipeline(layout, color_format);
+        }
+        catch(...)
+        {
+            release();
+            throw;
+        }
+    }
+
+    ~occlusion_culler()
+    {
+        release();
+    }
+
+    occlusion_culler(occlusion_culler const &) = delete;
+    occlusion_culler & operator=(occlusion_culler const &) = delete;
+
+    bool hidden(std::uint32_t object) const
+    {
+        return m_hidden[object] != 0u;
+    }
+
+    /* True once if results changed which objects are hidden since the last call */
+    bool take_changes()
+    {
+        return std::exchange(m_changed, false);
+    }
+
+    /* Makes every object visible and ignores results still in flight */
+    void reset()
+    {
+        ++m_generation;
+        std::fill(m_occluded_results.begin(), m_occluded_results.end(), 0u);
+
+        if(std::any_of(m_hidden.begin(), m_hidden.end(), [](auto h) { return h != 0u; }))
+        {
+            std::fill(m_hidden.begin(), m_hidden.end(), 0u);
+            m_changed = true;
+        }
+    }
+
+    /* Frames whose results have not arrived yet */
+    std::uint32_t frames_in_flight() const
+    {
+        return static_cast<std::uint32_t>(std::count_if(
+            m_slots.begin(), m_slots.end(),
+            [](auto const & slot) { return slot.pending; }));
+    }
+
+    /*
+     * Sets the objects tested from now on, ascending, with their bounds.
+     * Returns the bytes uploaded, nothing when the proxies did not change.
+     */
+    std::size_t set_proxies(
+        WGPUQueue queue,
+        std::span<std::uint32_t const> objects,
+        std::span<box const> boxes)
+    {
+        auto const same_boxes = std::ranges::equal(
+            boxes, m_boxes,
+            [](box const & a, box const & b) { return a.min == b.min && a.max == b.max; });
+
+        if(same_boxes && std::ranges::equal(objects, m_objects))
+        {
+            return 0u;
+        }
+
+        // Objects entering the view have no recent result and start visible
+        for(auto const object: objects)
+        {
+            if(m_tested[object])
+            {
+                continue;
+            }
+
+            m_occluded_results[object] = 0u;
+            if(m_hidden[object])
+            {
+                m_hidden[object] = 0u;
+                m_changed = true;
+            }
+        }
+
+        // Results still in flight only apply to objects tested now
+        for(auto const object: m_objects)
+        {
+            m_tested[object] = 0u;
+        }
+        for(auto const object: objects)
+        {
+            m_tested[object] = 1u;
+        }
+
+        m_objects.assign(objects.begin(), objects.end());
+        m_boxes.assign(boxes.begin(), boxes.end());
+
+        if(m_boxes.empty())
+        {
+            return 0u;
+        }
+
+        auto const size = m_boxes.size() * sizeof(box);
+        wgpuQueueWriteBuffer(queue, m_box_buffer, 0u, m_boxes.data(), size);
+
+        return size;
+    }
+
+    /* Picks a slot for the frame being recorded; without one nothing is tested */
+    void begin_frame()
+    {
+        auto const free_slot = std::find_if(
+            m_slots.begin(), m_slots.end(),
+            [](auto const & slot) { return !slot.pending; });
+
+        m_current = free_slot == m_slots.end() || m_objects.empty() ?
+            nullptr : &*free_slot;
+    }
+
+    /* The occlusion query set of the scene pass, if this frame tests */
+    WGPUQuerySet query_set() const
+    {
+        return m_current ? m_query_set : nullptr;
+    }
+
+    WGPURenderPassDepthStencilAttachment depth_attachment() const
+    {
+        return
+        {
+            .view = m_depth_view,
+            .depthLoadOp = WGPULoadOp_Clear,
+            .depthStoreOp = WGPUStoreOp_Discard,
+            .depthClearValue = 1.0f,
+            .depthReadOnly = false,
+            .stencilLoadOp = WGPULoadOp_Undefined,
+            .stencilStoreOp = WGPUStoreOp_Undefined,
+            .stencilClearValue = 0u,
+            .stencilReadOnly = true
+        };
+    }
+
+    /* Draws the proxies, last in the scene pass; bind_group is the scene's */
+    void draw(
+        render_pass_state & pass,
+        WGPUBindGroup bind_group,
+        std::span<std::uint32_t const> dynamic_offsets)
+    {
+        if(!m_current)
+        {
+            return;
+        }
+
+        WEBGPU_SDL_TRACE_SCOPE("occlusion proxies");
+
+        pass.set_pipeline(m_pipeline);
+        pass.set_bind_group(0u, bind_group, dynamic_offsets.size(), dynamic_offsets.data());
+        pass.set_vertex_buffer(0u, m_box_buffer, 0u, m_boxes.size() * sizeof(box));
+
+        for(auto query = 0u; query != m_objects.size(); ++query)
+        {
+            pass.begin_occlusion_query(query);
+            pass.draw(box_vertex_count, 1u, 0u, query);
+            pass.end_occlusion_query();
+        }
+    }
+
+    /* Records the copy of this frame's results, after the scene pass */
+    void resolve(WGPUCommandEncoder encoder)
+    {
+        if(!m_current)
+        {
+            return;
+        }
+
+        auto const count = static_cast<std::uint32_t>(m_objects.size());
+        wgpuCommandEncoderResolveQuerySet(
+            encoder, m_query_set, 0u, count, m_resolve_buffer, 0u);
+        wgpuCommandEncoderCopyBufferToBuffer(
+            encoder, m_resolve_buffer, 0u,
+            m_current->readback, 0u, count * sizeof(std::uint64_t));
+
+        m_current->objects.assign(m_objects.begin(), m_objects.end());
+        m_current->generation = m_generation;
+    }
+
+    /* Starts the readback, call right after submitting the frame */
+    void submitted()
+    {
+        if(!m_current)
+        {
+            return;
+        }
+
+        auto & slot = *m_current;
+        slot.pending = true;
+        m_current = nullptr;
+
+        wgpuBufferMapAsync(
+            slot.readback, WGPUMapMode_Read, 0u,
+            slot.objects.size() * sizeof(std::uint64_t),
+            &occlusion_culler::on_readback_mapped, &slot);
+    }
+
+    private:
+    struct slot_t
+    {
+        occlusion_culler * owner = nullptr;
+        WGPUBuffer readback = nullptr;
+        std::vector<std::uint32_t> objects;
+        std::uint64_t generation = 0u;
+        bool pending = false;
+    };
+
+    static constexpr std::uint32_t box_vertex_count = 36u;
+
+    static WGPUDepthStencilState depth_state(bool write, WGPUCompareFunction compare)
+    {
+        WGPUStencilFaceState const stencil_face =
+        {
+            .compare = WGPUCompareFunction_Always,
+            .failOp = WGPUStencilOperation_Keep,
+            .depthFailOp = WGPUStencilOperation_Keep,
+            .passOp = WGPUStencilOperation_Keep
+        };
+
+        return
+        {
+            .nextInChain = nullptr,
+            .format = depth_format,
+            .depthWriteEnabled = write,
+            .depthCompare = compare,
+            .stencilFront = stencil_face,
+            .stencilBack = stencil_face,
+            .stencilReadMask = 0u,
+            .stencilWriteMask = 0u,
+            .depthBias = 0,
+            .depthBiasSlopeScale = 0.0f,
+            .depthBiasClamp = 0.0f
+        };
+    }
+
+    static void on_readback_mapped(WGPUBufferMapAsyncStatus status, void * user_data)
+    {
+        WEBGPU_SDL_TRACE_SCOPE("occlusion readback");
+        auto & slot = *reinterpret_cast<slot_t *>(user_data);
+        auto & owner = *slot.owner;
+
+        if(status == WGPUBufferMapAsyncStatus_Success)
+        {
+            auto const size = slot.objects.size() * sizeof(std::uint64_t);
+            auto const * samples = reinterpret_cast<std::uint64_t const *>(
+                wgpuBufferGetConstMappedRange(slot.readback, 0u, size));
+
+            if(samples && slot.generation == owner.m_generation)
+            {
+                owner.apply_results(slot.objects, samples);
+            }
+
+            wgpuBufferUnmap(slot.readback);
+        }
+
+        slot.pending = false;
+    }
+
+    void apply_results(std::span<std::uint32_t const> objects, std::uint64_t const * samples)
+    {
+        for(auto i = std::size_t{0}; i != objects.size(); ++i)
+        {
+            auto const object = objects[i];
+            if(!m_tested[object])
+            {
+                continue;
+            }
+
+            std::uint64_t passed;
+            std::memcpy(&passed, samples + i, sizeof(passed));
+
+            auto & occluded = m_occluded_results[object];
+            occluded = passed == 0u ? std::min(occluded + 1u, hide_after) : 0u;
+
+            auto const hide = static_cast<std::uint8_t>(occluded == hide_after);
+            if(m_hidden[object] != hide)
+            {
+                m_hidden[object] = hide;
+                m_changed = true;
+            }
+        }
+    }
+
+    void create_resources(std::uint32_t object_count, std::uint32_t width, std::uint32_t height)
+    {
+        WGPUTextureDescriptor const depth_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "SceneDepth",
+            .usage = WGPUTextureUsage_RenderAttachment,
+            .dimension = WGPUTextureDimension_2D,
+            .size = { width, height, 1u },
+            .format = depth_format,
+            .mipLevelCount = 1u,
+            .sampleCount = 1u,
+            .viewFormatCount = 0u,
+            .viewFormats = nullptr
+        };
+
+        m_depth_texture = m_memory.create_texture(m_device, depth_descriptor);
+
+        if(!m_depth_texture)
+        {
+            throw std::runtime_error{"Scene depth buffer creation failed"};
+        }
+
+        m_depth_view = wgpuTextureCreateView(m_depth_texture, nullptr);
+
+        WGPUQuerySetDescriptor const query_set_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "OcclusionQueries",
+            .type = WGPUQueryType_Occlusion,
+            .count = object_count,
+            .pipelineStatistics = nullptr,
+            .pipelineStatisticsCount = 0u
+        };
+
+        m_query_set = wgpuDeviceCreateQuerySet(m_device, &query_set_descriptor);
+
+        auto const results_size = object_count * sizeof(std::uint64_t);
+
+        WGPUBufferDescriptor const resolve_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "OcclusionResolve",
+            .usage = WGPUBufferUsage_QueryResolve | WGPUBufferUsage_CopySrc,
+            .size = results_size,
+            .mappedAtCreation = false
+        };
+
+        m_resolve_buffer = m_memory.create_buffer(m_device, resolve_descriptor);
+
+        for(auto & slot: m_slots)
+        {
+            WGPUBufferDescriptor const readback_descriptor =
+            {
+                .nextInChain = nullptr,
+                .label = "OcclusionReadback",
+                .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+                .size = results_size,
+                .mappedAtCreation = false
+            };
+
+            slot.readback = m_memory.create_buffer(m_device, readback_descriptor);
+
+            if(!slot.readback)
+            {
+                throw std::runtime_error{"Occlusion readback buffer creation failed"};
+            }
+        }
+
+        WGPUBufferDescriptor const box_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "OcclusionProxyBuffer",
+            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+            .size = object_count * sizeof(box),
+            .mappedAtCreation = false
+        };
+
+        m_box_buffer = m_memory.create_buffer(m_device, box_descriptor);
+
+        if(!m_query_set || !m_resolve_buffer || !m_box_buffer)
+        {
+            throw std::runtime_error{"Occlusion query resource creation failed"};
+        }
+    }
+
+    void create_pipeline(WGPUPipelineLayout layout, WGPUTextureFormat color_format)
+    {
+        WGPUShaderModuleWGSLDescriptor const code_descriptor =
+        {
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_ShaderModuleWGSLDescriptor
+            },
+            .code = proxy_shader
+        };
+
+        WGPUShaderModuleDescriptor const module_descriptor =
+        {
+            .nextInChain = &code_descriptor.chain,
+            .label = "OcclusionProxyShader"
+        };
+
+        auto const module = wgpuDeviceCreateShaderModule(m_device, &module_descriptor);
+
+        // Proxies only count samples, the scene image stays untouched
+        WGPUColorTargetState const color_target =
+        {
+            .nextInChain = nullptr,
+            .format = color_format,
+            .blend = nullptr,
+            .writeMask = WGPUColorWriteMask_None
+        };
+
+        WGPUFragmentState const fragment_state =
+        {
+            .nextInChain = nullptr,
+            .module = module,
+            .entryPoint = "fs_main",
+            .constantCount = 0u,
+            .constants = nullptr,
+            .targetCount = 1u,
+            .targets = &color_target
+        };
+
+        std::array const box_attribs
+        {
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Float32x3,
+                .offset = offsetof(box, min),
+                .shaderLocation = 0
+            },
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Float32x3,
+                .offset = offsetof(box, max),
+                .shaderLocation = 1
+            }
+        };
+
+        WGPUVertexBufferLayout const box_layout =
+        {
+            .arrayStride = sizeof(box),
+            .stepMode = WGPUVertexStepMode_Instance,
+            .attributeCount = box_attribs.size(),
+            .attributes = box_attribs.data()
+        };
+
+        // Equal depth passes, so a proxy touching its object's surface counts
+        auto const depth_stencil = depth_state(false, WGPUCompareFunction_LessEqual);
+
+        WGPURenderPipelineDescriptor const pipeline_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "OcclusionProxyPipeline",
+            .layout = layout,
+            .vertex =
+            {
+                .nextInChain = nullptr,
+                .module = module,
+                .entryPoint = "vs_main",
+                .constantCount = 0u,
+                .constants = nullptr,
+                .bufferCount = 1u,
+                .buffers = &box_layout
+            },
+            .primitive =
+            {
+                .nextInChain = nullptr,
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .stripIndexFormat = WGPUIndexFormat_Undefined,
+                .frontFace = WGPUFrontFace_CCW,
+                // Inner faces still count when the camera is inside a box
+                .cullMode = WGPUCullMode_None
+            },
+            .depthStencil = &depth_stencil,
+            .multisample =
+            {
+                .nextInChain = nullptr,
+                .count = 1,
+                .mask = ~std::uint32_t{0},
+                .alphaToCoverageEnabled = false
+            },
+            .fragment = &fragment_state
+        };
+
+        m_pipeline = wgpuDeviceCreateRenderPipeline(m_device, &pipeline_descriptor);
+        wgpuShaderModuleRelease(module);
+
+        if(!m_pipeline)
+        {
+            throw std::runtime_error{"Occlusion proxy pipeline creation failed"};
+        }
+    }
+
+    void release()
+    {
+        for(auto & slot: m_slots)
+        {
+            if(slot.readback)
+            {
+                // Destroying fires any pending map callback while we still exist
+                wgpuBufferDestroy(slot.readback);
+                m_memory.release(slot.readback);
+                slot.readback = nullptr;
+            }
+        }
+
+        if(m_pipeline)
+        {
+            wgpuRenderPipelineRelease(m_pipeline);
+            m_pipeline = nullptr;
+        }
+
+        for(auto * buffer: { &m_box_buffer, &m_resolve_buffer })
+        {
+            if(*buffer)
+            {
+                m_memory.release(*buffer);
+                *buffer = nullptr;
+            }
+        }
+
+        if(m_query_set)
+        {
+            wgpuQuerySetRelease(m_query_set);
+            m_query_set = nullptr;
+        }
+
+        if(m_depth_view)
+        {
+            wgpuTextureViewRelease(m_depth_view);
+            m_depth_view = nullptr;
+        }
+
+        if(m_depth_texture)
+        {
+            wgpuTextureDestroy(m_depth_texture);
+            m_memory.release(m_depth_texture);
+            m_depth_texture = nullptr;
+        }
+    }
+
+    static constexpr char const * proxy_shader = R"WGSL(
+struct vertex_transform
+{
+    view_projection: mat4x4f,
+};
+
+@group(0) @binding(0) var<uniform> transform: vertex_transform;
+
+@vertex
+fn vs_main(
+    @builtin(vertex_index) index: u32,
+    @location(0) box_min: vec3f,
+    @location(1) box_max: vec3f) -> @builtin(position) vec4f
+{
+    // Two triangles per face, corner bits select max over min per axis
+    var corners = array<u32, 36>(
+        0u, 2u, 6u, 0u, 6u, 4u,
+        1u, 5u, 7u, 1u, 7u, 3u,
+        0u, 4u, 5u, 0u, 5u, 1u,
+        2u, 3u, 7u, 2u, 7u, 6u,
+        0u, 1u, 3u, 0u, 3u, 2u,
+        4u, 6u, 7u, 4u, 7u, 5u);
+
+    let corner = corners[index];
+    let t = vec3f(vec3u(corner & 1u, (corner >> 1u) & 1u, (corner >> 2u) & 1u));
+
+    return transform.view_projection * vec4f(mix(box_min, box_max, t), 1.0);
+}
+
+@fragment
+fn fs_main() -> @location(0) vec4f
+{
+    return vec4f(0.0);
+}
+)WGSL";
+
+    WGPUDevice m_device;
+    gpu_memory & m_memory;
+    WGPUTexture m_depth_texture = nullptr;
+    WGPUTextureView m_depth_view = nullptr;
+    WGPUQuerySet m_query_set = nullptr;
+    WGPUBuffer m_resolve_buffer = nullptr;
+    WGPUBuffer m_box_buffer = nullptr;
+    WGPURenderPipeline m_pipeline = nullptr;
+    std::array<slot_t, slot_count> m_slots{};
+    slot_t * m_current = nullptr;
+
+    std::vector<std::uint32_t> m_objects;
+    std::vector<box> m_boxes;
+    std::vector<std::uint32_t> m_occluded_results;
+    std::vector<std::uint8_t> m_hidden;
+    std::vector<std::uint8_t> m_tested;
+    std::uint64_t m_generation = 0u;
+    bool m_changed = false;
+}; /* class occlusion_culler */
+
+#endif /* SDL_WEBGPU_DEMO_OCCLUSION_CULLING_HPP */
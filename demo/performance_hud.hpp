@@ -0,0 +1,726 @@
+#ifndef SDL_WEBGPU_DEMO_PERFORMANCE_HUD_HPP
+#define SDL_WEBGPU_DEMO_PERFORMANCE_HUD_HPP
+
+#include "gpu_memory.hpp"
+#include "render_pass_state.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/* Counters of one frame as shown by the HUD */
+struct hud_frame_statistics
+{
+    double frame_ms;
+    std::optional<double> gpu_ms;
+    std::uint64_t draws;
+    std::uint64_t state_calls;
+    std::uint64_t upload_bytes;
+    std::uint64_t gpu_memory_bytes;
+    float resolution_scale;
+    std::uint32_t frames_in_flight;
+};
+
+/*
+ * Overlay with CPU and GPU frame time graphs and the frame's counters,
+ * drawn at output resolution on top of the final image.
+ *
+ * Everything is a quad from one small glyph atlas, panels and bars use a
+ * solid cell of it. The quads are written as 16 byte instances into one
+ * vertex buffer and drawn with a single instanced draw, the vertex shader
+ * expands each instance into two triangles. Rebuilding a few hundred quads
+ * and uploading them costs a few microseconds; the HUD measures its own
+ * CPU time and shows it in the last line.
+ */
+class performance_hud
+{
+    public:
+    static constexpr std::size_t history_size = 160u;
+    static constexpr std::size_t max_quads = 1024u;
+
+    performance_hud(
+        WGPUDevice device,
+        WGPUQueue queue,
+        gpu_memory & memory,
+        WGPUTextureFormat format,
+        std::uint32_t output_width,
+        std::uint32_t output_height) :
+        m_device(device),
+        m_memory(memory)
+    {
+        create_atlas(queue);
+        create_pipeline(format, output_width, output_height);
+
+        WGPUBufferDescriptor const instance_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "HudQuads",
+            .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex,
+            .size = max_quads * sizeof(quad),
+            .mappedAtCreation = false
+        };
+
+        m_instances = m_memory.create_buffer(m_device, instance_descriptor);
+
+        if(!m_instances)
+        {
+            throw std::runtime_error{"HUD buffer creation failed"};
+        }
+
+        m_quads.reserve(max_quads);
+    }
+
+    ~performance_hud()
+    {
+        m_memory.release(m_instances);
+        wgpuBindGroupRelease(m_bind_group);
+        wgpuRenderPipelineRelease(m_pipeline);
+        wgpuTextureViewRelease(m_atlas_view);
+        wgpuTextureDestroy(m_atlas);
+        m_memory.release(m_atlas);
+    }
+
+    performance_hud(performance_hud const &) = delete;
+    performance_hud & operator=(performance_hud const &) = delete;
+
+    /* Adds a frame to the graphs and uploads the quads; returns the bytes written */
+    std::size_t update(WGPUQueue queue, hud_frame_statistics const & statistics)
+    {
+        auto const begin = std::chrono::steady_clock::now();
+
+        if(statistics.gpu_ms)
+        {
+            m_gpu_ms = *statistics.gpu_ms;
+        }
+
+        m_cpu_history[m_next] = static_cast<float>(statistics.frame_ms);
+        m_gpu_history[m_next] = static_cast<float>(m_gpu_ms);
+        m_next = (m_next + 1u) % history_size;
+
+        // Text shows smoothed values, graphs the individual frames
+        m_frame_ms_average = smooth(m_frame_ms_average, statistics.frame_ms);
+        m_gpu_ms_average = smooth(m_gpu_ms_average, m_gpu_ms);
+
+        m_quads.clear();
+        add_panel();
+        add_graphs();
+        add_text(statistics);
+
+        auto const size = m_quads.size() * sizeof(quad);
+        wgpuQueueWriteBuffer(queue, m_instances, 0u, m_quads.data(), size);
+
+        auto const end = std::chrono::steady_clock::now();
+        m_build_ms = smooth(
+            m_build_ms, std::chrono::duration<double, std::milli>(end - begin).count());
+
+        return size;
+    }
+
+    /* Draws the quads of the last update, the pass must cover the whole output */
+    void draw(render_pass_state & pass) const
+    {
+        pass.set_pipeline(m_pipeline);
+        pass.set_bind_group(0, m_bind_group);
+        pass.set_vertex_buffer(0, m_instances, 0u, m_quads.size() * sizeof(quad));
+        pass.draw(6u, static_cast<std::uint32_t>(m_quads.size()));
+    }
+
+    private:
+    /* One instance: output rectangle in pixels, atlas rectangle in texels, color */
+    struct quad
+    {
+        std::uint16_t x;
+        std::uint16_t y;
+        std::uint16_t width;
+        std::uint16_t height;
+        std::uint8_t texel_x;
+        std::uint8_t texel_y;
+        std::uint8_t texel_width;
+        std::uint8_t texel_height;
+        std::uint32_t color;
+    };
+
+    static_assert(sizeof(quad) == 16u);
+
+    struct glyph_rows
+    {
+        char character;
+        std::array<std::uint8_t, 7> rows;
+    };
+
+    // The atlas holds ASCII 32 to 127 in 8x8 cells, 16 per row. Glyphs are
+    // 5x7 pixels in the top left corner of their cell, the cell of 127 is
+    // solid and used for panels and bars.
+    static constexpr std::uint32_t cell_size = 8u;
+    static constexpr std::uint32_t atlas_columns = 16u;
+    static constexpr std::uint32_t atlas_width = atlas_columns * cell_size;
+    static constexpr std::uint32_t atlas_rows = 6u;
+    static constexpr std::uint32_t atlas_height = atlas_rows * cell_size;
+    static constexpr char first_character = ' ';
+    static constexpr char solid_character = 127;
+
+    static constexpr std::uint32_t glyph_width = 5u;
+    static constexpr std::uint32_t glyph_height = 7u;
+    static constexpr std::uint32_t pixel_scale = 2u;
+    static constexpr std::uint32_t advance = (glyph_width + 1u) * pixel_scale;
+    static constexpr std::uint32_t line_height = (glyph_height + 3u) * pixel_scale;
+
+    static constexpr std::uint32_t margin = 8u;
+    static constexpr std::uint32_t padding = 8u;
+    static constexpr std::uint32_t bar_width = 2u;
+    static constexpr std::uint32_t graph_width = history_size * bar_width;
+    static constexpr std::uint32_t graph_height = 64u;
+    static constexpr std::uint32_t text_lines = 5u;
+    static constexpr std::uint32_t panel_width = graph_width + 2u * padding;
+    static constexpr std::uint32_t panel_height =
+        graph_height + text_lines * line_height + 3u * padding;
+
+    // The graph spans two 60 Hz frames, the line marks one
+    static constexpr double budget_ms = 1000.0 / 60.0;
+    static constexpr double graph_ms = 2.0 * budget_ms;
+
+    // Packed as 0xAABBGGRR for the Unorm8x4 color attribute
+    static constexpr std::uint32_t panel_color = 0xC0101010u;
+    static constexpr std::uint32_t budget_color = 0x80FFFFFFu;
+    static constexpr std::uint32_t cpu_color = 0xFF60C060u;
+    static constexpr std::uint32_t cpu_over_budget_color = 0xFF4040E0u;
+    static constexpr std::uint32_t gpu_color = 0xFF20A0F0u;
+    static constexpr std::uint32_t text_color = 0xFFFFFFFFu;
+    static constexpr std::uint32_t gpu_text_color = 0xFF20A0F0u;
+
+    static constexpr std::array glyphs
+    {
+        glyph_rows{'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+        glyph_rows{'(', {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}},
+        glyph_rows{')', {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}},
+        glyph_rows{'+', {0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00}},
+        glyph_rows{'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+        glyph_rows{'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+        glyph_rows{'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+        glyph_rows{'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+        glyph_rows{'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+        glyph_rows{'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+        glyph_rows{'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+        glyph_rows{'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+        glyph_rows{'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+        glyph_rows{'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+        glyph_rows{'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+        glyph_rows{'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+        glyph_rows{'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+        glyph_rows{':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+        glyph_rows{'=', {0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00}},
+        glyph_rows{'A', {0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+        glyph_rows{'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+        glyph_rows{'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+        glyph_rows{'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+        glyph_rows{'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+        glyph_rows{'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+        glyph_rows{'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+        glyph_rows{'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+        glyph_rows{'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+        glyph_rows{'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+        glyph_rows{'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+        glyph_rows{'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+        glyph_rows{'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+        glyph_rows{'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+        glyph_rows{'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+        glyph_rows{'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+        glyph_rows{'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+        glyph_rows{'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+        glyph_rows{'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+        glyph_rows{'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+        glyph_rows{'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+        glyph_rows{'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+        glyph_rows{'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+        glyph_rows{'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+        glyph_rows{'Y', {0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x04}},
+        glyph_rows{'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    };
+
+    static double smooth(double average, double value)
+    {
+        return average == 0.0 ? value : average + 0.1 * (value - average);
+    }
+
+    static std::uint16_t pixels(double value)
+    {
+        return static_cast<std::uint16_t>(std::clamp(value, 0.0, 65535.0));
+    }
+
+    void add_quad(quad const & q)
+    {
+        if(m_quads.size() != max_quads)
+        {
+            m_quads.push_back(q);
+        }
+    }
+
+    void add_solid(
+        std::uint32_t x, std::uint32_t y,
+        std::uint32_t width, std::uint32_t height,
+        std::uint32_t color)
+    {
+        auto const cell = static_cast<std::uint32_t>(solid_character - first_character);
+
+        add_quad(
+        {
+            .x = static_cast<std::uint16_t>(x),
+            .y = static_cast<std::uint16_t>(y),
+            .width = static_cast<std::uint16_t>(width),
+            .height = static_cast<std::uint16_t>(height),
+            .texel_x = static_cast<std::uint8_t>((cell % atlas_columns) * cell_size),
+            .texel_y = static_cast<std::uint8_t>((cell / atlas_columns) * cell_size),
+            .texel_width = 1u,
+            .texel_height = 1u,
+            .color = color
+        });
+    }
+
+    void add_string(
+        std::uint32_t x, std::uint32_t y, std::string_view text, std::uint32_t color)
+    {
+        auto const right = margin + panel_width - padding;
+
+        for(auto c: text)
+        {
+            if(x + advance > right)
+            {
+                break;
+            }
+
+            if(c >= 'a' && c <= 'z')
+            {
+                c = static_cast<char>(c - 'a' + 'A');
+            }
+
+            auto const cell = static_cast<std::uint32_t>(c - first_character);
+            if(c > first_character && cell < m_has_glyph.size() && m_has_glyph[cell])
+            {
+                add_quad(
+                {
+                    .x = static_cast<std::uint16_t>(x),
+                    .y = static_cast<std::uint16_t>(y),
+                    .width = static_cast<std::uint16_t>(glyph_width * pixel_scale),
+                    .height = static_cast<std::uint16_t>(glyph_height * pixel_scale),
+                    .texel_x = static_cast<std::uint8_t>((cell % atlas_columns) * cell_size),
+                    .texel_y = static_cast<std::uint8_t>((cell / atlas_columns) * cell_size),
+                    .texel_width = static_cast<std::uint8_t>(glyph_width),
+                    .texel_height = static_cast<std::uint8_t>(glyph_height),
+                    .color = color
+                });
+            }
+
+            x += advance;
+        }
+    }
+
+    template <typename... Args>
+    void add_line(std::uint32_t line, std::uint32_t color, char const * format, Args... args)
+    {
+        std::array<char, 64> text{};
+        auto const length = std::snprintf(text.data(), text.size(), format, args...);
+        if(length <= 0)
+        {
+            return;
+        }
+
+        add_string(
+            margin + padding,
+            margin + 2u * padding + graph_height + line * line_height,
+            std::string_view{
+                text.data(), std::min(static_cast<std::size_t>(length), text.size() - 1u)},
+            color);
+    }
+
+    void add_panel()
+    {
+        add_solid(margin, margin, panel_width, panel_height, panel_color);
+    }
+
+    void add_graphs()
+    {
+        auto const left = margin + padding;
+        auto const bottom = margin + padding + graph_height;
+        auto const scale = graph_height / graph_ms;
+
+        // Oldest frame on the left
+        for(auto i = std::size_t{0}; i != history_size; ++i)
+        {
+            auto const index = (m_next + i) % history_size;
+            auto const x = left + static_cast<std::uint32_t>(i) * bar_width;
+
+            auto const cpu_ms = static_cast<double>(m_cpu_history[index]);
+            auto const cpu_height = pixels(std::min(cpu_ms, graph_ms) * scale);
+            if(cpu_height != 0u)
+            {
+                add_solid(
+                    x, bottom - cpu_height, bar_width, cpu_height,
+                    cpu_ms > budget_ms ? cpu_over_budget_color : cpu_color);
+            }
+
+            // GPU times are drawn as a line over the bars
+            auto const gpu_ms = static_cast<double>(m_gpu_history[index]);
+            if(gpu_ms > 0.0)
+            {
+                auto const gpu_height = std::max<std::uint16_t>(
+                    pixels(std::min(gpu_ms, graph_ms) * scale), 2u);
+                add_solid(x, bottom - gpu_height, bar_width, 2u, gpu_color);
+            }
+        }
+
+        add_solid(left, bottom - pixels(budget_ms * scale), graph_width, 1u, budget_color);
+    }
+
+    void add_text(hud_frame_statistics const & statistics)
+    {
+        auto const fps = m_frame_ms_average > 0.0 ? 1000.0 / m_frame_ms_average : 0.0;
+
+        add_line(0u, text_color, "CPU %6.2f MS  %4.0f FPS", m_frame_ms_average, fps);
+        add_line(
+            1u, gpu_text_color, "GPU %6.2f MS  SCALE %.2f",
+            m_gpu_ms_average, static_cast<double>(statistics.resolution_scale));
+        add_line(
+            2u, text_color, "DRAWS %llu  CALLS %llu",
+            static_cast<unsigned long long>(statistics.draws),
+            static_cast<unsigned long long>(statistics.state_calls));
+        add_line(
+            3u, text_color, "UPLOAD %.1f KB  IN FLIGHT %u",
+            static_cast<double>(statistics.upload_bytes) / 1024.0,
+            static_cast<unsigned>(statistics.frames_in_flight));
+        add_line(
+            4u, text_color, "MEM %.1f MB  HUD %.3f MS",
+            static_cast<double>(statistics.gpu_memory_bytes) / (1024.0 * 1024.0),
+            m_build_ms);
+    }
+
+    void create_atlas(WGPUQueue queue)
+    {
+        auto texels = std::vector<std::uint8_t>(atlas_width * atlas_height, 0u);
+
+        auto const fill_cell = [&](std::uint32_t cell, auto const & covered)
+        {
+            auto const cell_x = (cell % atlas_columns) * cell_size;
+            auto const cell_y = (cell / atlas_columns) * cell_size;
+
+            for(auto y = 0u; y != cell_size; ++y)
+            {
+                for(auto x = 0u; x != cell_size; ++x)
+                {
+                    if(covered(x, y))
+                    {
+                        texels[(cell_y + y) * atlas_width + cell_x + x] = 0xFFu;
+                    }
+                }
+            }
+        };
+
+        for(auto const & glyph: glyphs)
+        {
+            auto const cell = static_cast<std::uint32_t>(glyph.character - first_character);
+            fill_cell(cell, [&glyph](std::uint32_t x, std::uint32_t y)
+            {
+                return
+                    x < glyph_width && y < glyph_height &&
+                    ((glyph.rows[y] >> (glyph_width - 1u - x)) & 1u) != 0u;
+            });
+            m_has_glyph[cell] = true;
+        }
+
+        fill_cell(
+            static_cast<std::uint32_t>(solid_character - first_character),
+            [](std::uint32_t, std::uint32_t) { return true; });
+
+        WGPUTextureDescriptor const texture_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "HudAtlas",
+            .usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst,
+            .dimension = WGPUTextureDimension_2D,
+            .size = { atlas_width, atlas_height, 1u },
+            .format = WGPUTextureFormat_R8Unorm,
+            .mipLevelCount = 1u,
+            .sampleCount = 1u,
+            .viewFormatCount = 0u,
+            .viewFormats = nullptr
+        };
+
+        m_atlas = m_memory.create_texture(m_device, texture_descriptor);
+
+        if(!m_atlas)
+        {
+            throw std::runtime_error{"HUD atlas creation failed"};
+        }
+
+        WGPUImageCopyTexture const destination =
+        {
+            .nextInChain = nullptr,
+            .texture = m_atlas,
+            .mipLevel = 0u,
+            .origin = { 0u, 0u, 0u },
+            .aspect = WGPUTextureAspect_All
+        };
+
+        WGPUTextureDataLayout const layout =
+        {
+            .nextInChain = nullptr,
+            .offset = 0u,
+            .bytesPerRow = atlas_width,
+            .rowsPerImage = atlas_height
+        };
+
+        WGPUExtent3D const extent =
+        {
+            .width = atlas_width,
+            .height = atlas_height,
+            .depthOrArrayLayers = 1u
+        };
+
+        wgpuQueueWriteTexture(
+            queue, &destination, texels.data(), texels.size(), &layout, &extent);
+
+        m_atlas_view = wgpuTextureCreateView(m_atlas, nullptr);
+    }
+
+    void create_pipeline(
+        WGPUTextureFormat format, std::uint32_t output_width, std::uint32_t output_height)
+    {
+        WGPUShaderModuleWGSLDescriptor const code_descriptor =
+        {
+            .chain =
+            {
+                .next = nullptr,
+                .sType = WGPUSType_ShaderModuleWGSLDescriptor
+            },
+            .code = R"WGSL(
+override output_width: f32;
+override output_height: f32;
+
+@group(0) @binding(0) var atlas: texture_2d<f32>;
+
+struct hud_quad
+{
+    @location(0) rect: vec4u,
+    @location(1) atlas_rect: vec4u,
+    @location(2) color: vec4f,
+};
+
+struct hud_vertex
+{
+    @builtin(position) position: vec4f,
+    @location(0) texel: vec2f,
+    @location(1) color: vec4f,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32, quad: hud_quad) -> hud_vertex
+{
+    // Corners (0,0) (1,0) (0,1) (0,1) (1,0) (1,1)
+    let corner = vec2u((0x32u >> index) & 1u, (0x2Cu >> index) & 1u);
+    let pixel = vec2f(quad.rect.xy + corner * quad.rect.zw);
+
+    var out: hud_vertex;
+    out.position = vec4f(
+        pixel.x / output_width * 2.0 - 1.0,
+        1.0 - pixel.y / output_height * 2.0,
+        0.0,
+        1.0);
+    out.texel = vec2f(quad.atlas_rect.xy + corner * quad.atlas_rect.zw);
+    out.color = quad.color;
+    return out;
+}
+
+@fragment
+fn fs_main(in: hud_vertex) -> @location(0) vec4f
+{
+    let coverage = textureLoad(atlas, vec2i(in.texel), 0).r;
+    return vec4f(in.color.rgb, in.color.a * coverage);
+}
+            )WGSL"
+        };
+
+        WGPUShaderModuleDescriptor const module_descriptor =
+        {
+            .nextInChain = &code_descriptor.chain,
+            .label = "HudShader"
+        };
+
+        auto const module = wgpuDeviceCreateShaderModule(m_device, &module_descriptor);
+
+        std::array const constants
+        {
+            WGPUConstantEntry
+            {
+                .nextInChain = nullptr,
+                .key = "output_width",
+                .value = static_cast<double>(output_width)
+            },
+            WGPUConstantEntry
+            {
+                .nextInChain = nullptr,
+                .key = "output_height",
+                .value = static_cast<double>(output_height)
+            }
+        };
+
+        std::array const attributes
+        {
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Uint16x4,
+                .offset = offsetof(quad, x),
+                .shaderLocation = 0
+            },
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Uint8x4,
+                .offset = offsetof(quad, texel_x),
+                .shaderLocation = 1
+            },
+            WGPUVertexAttribute
+            {
+                .format = WGPUVertexFormat_Unorm8x4,
+                .offset = offsetof(quad, color),
+                .shaderLocation = 2
+            }
+        };
+
+        WGPUVertexBufferLayout const instance_layout =
+        {
+            .arrayStride = sizeof(quad),
+            .stepMode = WGPUVertexStepMode_Instance,
+            .attributeCount = attributes.size(),
+            .attributes = attributes.data()
+        };
+
+        WGPUBlendState const blend =
+        {
+            .color =
+            {
+                .operation = WGPUBlendOperation_Add,
+                .srcFactor = WGPUBlendFactor_SrcAlpha,
+                .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha
+            },
+            .alpha =
+            {
+                .operation = WGPUBlendOperation_Add,
+                .srcFactor = WGPUBlendFactor_One,
+                .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha
+            }
+        };
+
+        WGPUColorTargetState const color_target =
+        {
+            .nextInChain = nullptr,
+            .format = format,
+            .blend = &blend,
+            .writeMask = WGPUColorWriteMask_All
+        };
+
+        WGPUFragmentState const fragment_state =
+        {
+            .nextInChain = nullptr,
+            .module = module,
+            .entryPoint = "fs_main",
+            .constantCount = 0u,
+            .constants = nullptr,
+            .targetCount = 1,
+            .targets = &color_target
+        };
+
+        WGPURenderPipelineDescriptor const pipeline_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "HudPipeline",
+            .layout = nullptr,
+            .vertex =
+            {
+                .nextInChain = nullptr,
+                .module = module,
+                .entryPoint = "vs_main",
+                .constantCount = constants.size(),
+                .constants = constants.data(),
+                .bufferCount = 1,
+                .buffers = &instance_layout
+            },
+            .primitive =
+            {
+                .nextInChain = nullptr,
+                .topology = WGPUPrimitiveTopology_TriangleList,
+                .stripIndexFormat = WGPUIndexFormat_Undefined,
+                .frontFace = WGPUFrontFace_CCW,
+                .cullMode = WGPUCullMode_None
+            },
+            .depthStencil = nullptr,
+            .multisample =
+            {
+                .nextInChain = nullptr,
+                .count = 1,
+                .mask = ~std::uint32_t{0},
+                .alphaToCoverageEnabled = false
+            },
+            .fragment = &fragment_state
+        };
+
+        m_pipeline = wgpuDeviceCreateRenderPipeline(m_device, &pipeline_descriptor);
+        wgpuShaderModuleRelease(module);
+
+        if(!m_pipeline)
+        {
+            throw std::runtime_error{"HUD pipeline creation failed"};
+        }
+
+        WGPUBindGroupEntry const atlas_entry =
+        {
+            .nextInChain = nullptr,
+            .binding = 0,
+            .buffer = nullptr,
+            .offset = 0,
+            .size = 0,
+            .sampler = nullptr,
+            .textureView = m_atlas_view
+        };
+
+        auto const bind_group_layout = wgpuRenderPipelineGetBindGroupLayout(m_pipeline, 0);
+
+        WGPUBindGroupDescriptor const bind_group_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "HudBindGroup",
+            .layout = bind_group_layout,
+            .entryCount = 1,
+            .entries = &atlas_entry
+        };
+
+        m_bind_group = wgpuDeviceCreateBindGroup(m_device, &bind_group_descriptor);
+        wgpuBindGroupLayoutRelease(bind_group_layout);
+    }
+
+    WGPUDevice m_device;
+    gpu_memory & m_memory;
+    WGPUTexture m_atlas = nullptr;
+    WGPUTextureView m_atlas_view = nullptr;
+    WGPURenderPipeline m_pipeline = nullptr;
+    WGPUBindGroup m_bind_group = nullptr;
+    WGPUBuffer m_instances = nullptr;
+    std::array<bool, atlas_columns * atlas_rows> m_has_glyph{};
+
+    std::vector<quad> m_quads;
+    std::array<float, history_size> m_cpu_history{};
+    std::array<float, history_size> m_gpu_history{};
+    std::size_t m_next = 0u;
+    double m_gpu_ms = 0.0;
+    double m_frame_ms_average = 0.0;
+    double m_gpu_ms_average = 0.0;
+    double m_build_ms = 0.0;
+}; /* class performance_hud */
+
+#endif /* SDL_WEBGPU_DEMO_PERFORMANCE_HUD_HPP */
@@ -0,0 +1,257 @@
+#ifndef SDL_WEBGPU_DEMO_PRESENT_MODE_HPP
+#define SDL_WEBGPU_DEMO_PRESENT_MODE_HPP
+
+#include <webgpu/webgpu.h>
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+enum class present_policy
+{
+    adaptive,
+    fifo,
+    mailbox,
+    immediate
+};
+
+constexpr char const * present_policy_name(present_policy policy)
+{
+    switch(policy)
+    {
+        case present_policy::adaptive: return "adaptive";
+        case present_policy::fifo: return "fifo";
+        case present_policy::mailbox: return "mailbox";
+        case present_policy::immediate: return "immediate";
+    }
+
+    return "unknown";
+}
+
+inline bool parse_present_policy(std::string_view name, present_policy & policy)
+{
+    for(auto const candidate:
+        {
+            present_policy::adaptive,
+            present_policy::fifo,
+            present_policy::mailbox,
+            present_policy::immediate
+        })
+    {
+        if(name == present_policy_name(candidate))
+        {
+            policy = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+constexpr char const * present_mode_name(WGPUPresentMode mode)
+{
+    switch(mode)
+    {
+        case WGPUPresentMode_Fifo: return "Fifo";
+        case WGPUPresentMode_Mailbox: return "Mailbox";
+        case WGPUPresentMode_Immediate: return "Immediate";
+        default: return "unknown";
+    }
+}
+
+/*
+ * Chooses the present mode from the measured interval between presents.
+ * With Fifo a frame that misses a vblank waits for the next one, so a
+ * frame taking slightly longer than the refresh interval halves the frame
+ * rate. When too many of the recent frames miss their vblank, the adaptive
+ * policy switches to Mailbox, which presents the newest finished frame
+ * without waiting. Once frames fit comfortably into the refresh interval
+ * again for a while, it switches back to Fifo, which paces the loop and
+ * saves power.
+ *
+ * Intervals much longer than the refresh interval are pauses of the render
+ * loop (e.g. render on demand), not slow frames, and restart the window.
+ * The fixed policies never switch.
+ *
+ * A mode the surface refuses is reported with reject(); the controller
+ * falls back to Fifo, which every surface supports, and never picks that
+ * mode again.
+ */
+class present_mode_controller
+{
+    public:
+    static constexpr std::size_t window_size = 60u;
+    static constexpr std::size_t missed_to_switch = 12u;
+    static constexpr std::size_t stable_to_switch_back = 180u;
+    static constexpr double default_refresh_hz = 60.0;
+
+    present_mode_controller(present_policy policy, double refresh_hz) :
+        m_policy(policy),
+        m_refresh_ms(1000.0 / (refresh_hz > 0.0 ? refresh_hz : default_refresh_hz)),
+        m_mode(initial_mode(policy))
+    {
+    }
+
+    /* Refresh rate of the display showing the window, 60 Hz if unknown */
+    static double refresh_rate(SDL_Window * window)
+    {
+        auto mode = SDL_DisplayMode{};
+        if(SDL_GetWindowDisplayMode(window, &mode) != 0 || mode.refresh_rate <= 0)
+        {
+            return default_refresh_hz;
+        }
+
+        return static_cast<double>(mode.refresh_rate);
+    }
+
+    WGPUPresentMode mode() const
+    {
+        return m_mode;
+    }
+
+    std::uint64_t switches() const
+    {
+        return m_switches;
+    }
+
+    bool supports(WGPUPresentMode mode) const
+    {
+        return (m_rejected & mode_bit(mode)) == 0u;
+    }
+
+    /* The surface refused mode(), or mode for later */
+    void reject(WGPUPresentMode mode)
+    {
+        m_rejected |= mode_bit(mode);
+
+        if(m_mode != mode || mode == WGPUPresentMode_Fifo)
+        {
+            return;
+        }
+
+        // Only the adaptive policy gets to a mode by switching, and that
+        // switch never happened
+        if(m_policy == present_policy::adaptive)
+        {
+            --m_switches;
+        }
+
+        m_mode = WGPUPresentMode_Fifo;
+        restart_window();
+    }
+
+    /* Call after every present; true when the swap chain needs mode() now */
+    bool frame_presented()
+    {
+        auto const now = SDL_GetPerformanceCounter();
+        auto const previous = std::exchange(m_last_present, now);
+
+        if(m_policy != present_policy::adaptive || previous == 0u)
+        {
+            return false;
+        }
+
+        auto const interval_ms =
+            1000.0 * static_cast<double>(now - previous) /
+            static_cast<double>(SDL_GetPerformanceFrequency());
+
+        if(interval_ms > pause_factor * m_refresh_ms)
+        {
+            restart_window();
+            return false;
+        }
+
+        return m_mode == WGPUPresentMode_Fifo ?
+            watch_fifo(interval_ms) :
+            watch_mailbox(interval_ms);
+    }
+
+    private:
+    static constexpr double missed_factor = 1.5;
+    static constexpr double stable_factor = 0.8;
+    static constexpr double pause_factor = 4.0;
+
+    static WGPUPresentMode initial_mode(present_policy policy)
+    {
+        switch(policy)
+        {
+            case present_policy::mailbox: return WGPUPresentMode_Mailbox;
+            case present_policy::immediate: return WGPUPresentMode_Immediate;
+            default: return WGPUPresentMode_Fifo;
+        }
+    }
+
+    static constexpr std::uint32_t mode_bit(WGPUPresentMode mode)
+    {
+        return 1u << (static_cast<std::uint32_t>(mode) & 31u);
+    }
+
+    bool watch_fifo(double interval_ms)
+    {
+        if(!supports(WGPUPresentMode_Mailbox))
+        {
+            return false;
+        }
+
+        auto const missed = interval_ms > missed_factor * m_refresh_ms;
+
+        m_missed_count -= m_missed[m_next];
+        m_missed[m_next] = missed;
+        m_missed_count += missed;
+        m_next = (m_next + 1u) % window_size;
+        m_frames = std::min(m_frames + 1u, window_size);
+
+        if(m_frames < window_size || m_missed_count < missed_to_switch)
+        {
+            return false;
+        }
+
+        return switch_to(WGPUPresentMode_Mailbox);
+    }
+
+    bool watch_mailbox(double interval_ms)
+    {
+        m_stable = interval_ms < stable_factor * m_refresh_ms ? m_stable + 1u : 0u;
+
+        if(m_stable < stable_to_switch_back)
+        {
+            return false;
+        }
+
+        return switch_to(WGPUPresentMode_Fifo);
+    }
+
+    bool switch_to(WGPUPresentMode mode)
+    {
+        m_mode = mode;
+        ++m_switches;
+        restart_window();
+        return true;
+    }
+
+    void restart_window()
+    {
+        m_missed.fill(false);
+        m_missed_count = 0u;
+        m_next = 0u;
+        m_frames = 0u;
+        m_stable = 0u;
+    }
+
+    present_policy m_policy;
+    double m_refresh_ms;
+    WGPUPresentMode m_mode;
+    std::uint64_t m_last_present = 0u;
+    std::uint64_t m_switches = 0u;
+    std::uint32_t m_rejected = 0u;
+    std::array<bool, window_size> m_missed{};
+    std::size_t m_missed_count = 0u;
+    std::size_t m_next = 0u;
+    std::size_t m_frames = 0u;
+    std::size_t m_stable = 0u;
+}; /* class present_mode_controller */
+
+#endif /* SDL_WEBGPU_DEMO_PRESENT_MODE_HPP */
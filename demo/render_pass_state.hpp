@@ -0,0 +1,212 @@
+#ifndef SDL_WEBGPU_DEMO_RENDER_PASS_STATE_HPP
+#define SDL_WEBGPU_DEMO_RENDER_PASS_STATE_HPP
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+struct render_pass_statistics
+{
+    std::uint64_t issued = 0u;
+    std::uint64_t elided = 0u;
+    std::uint64_t draws = 0u;
+};
+
+/*
+ * Thin wrapper around a render pass encoder that remembers the currently
+ * bound pipeline, bind groups (with their dynamic offsets), vertex buffers
+ * and index buffer, and drops wgpuRenderPassEncoderSet* calls that would not
+ * change anything. Each set call has a validation cost in the
+ * implementation, which adds up with many draws.
+ *
+ * Bindings persist across pipeline changes in WebGPU, so only a new render
+ * pass resets the tracked state.
+ */
+class render_pass_state
+{
+    public:
+    static constexpr std::size_t max_bind_groups = 4u;
+    static constexpr std::size_t max_dynamic_offsets = 8u;
+    static constexpr std::size_t max_vertex_buffers = 8u;
+
+    render_pass_state(
+        WGPURenderPassEncoder encoder, render_pass_statistics & statistics) :
+        m_encoder(encoder),
+        m_statistics(statistics)
+    {
+    }
+
+    render_pass_state(render_pass_state const &) = delete;
+    render_pass_state & operator=(render_pass_state const &) = delete;
+
+    WGPURenderPassEncoder encoder() const
+    {
+        return m_encoder;
+    }
+
+    void set_pipeline(WGPURenderPipeline pipeline)
+    {
+        if(pipeline == m_pipeline)
+        {
+            ++m_statistics.elided;
+            return;
+        }
+
+        wgpuRenderPassEncoderSetPipeline(m_encoder, pipeline);
+        m_pipeline = pipeline;
+        ++m_statistics.issued;
+    }
+
+    void set_bind_group(
+        std::uint32_t index,
+        WGPUBindGroup group,
+        std::size_t dynamic_offset_count = 0u,
+        std::uint32_t const * dynamic_offsets = nullptr)
+    {
+        if(index < max_bind_groups && dynamic_offset_count <= max_dynamic_offsets)
+        {
+            auto & bound = m_bind_groups[index];
+            auto const same =
+                bound.group == group &&
+                bound.dynamic_offset_count == dynamic_offset_count &&
+                std::equal(
+                    dynamic_offsets, dynamic_offsets + dynamic_offset_count,
+                    bound.dynamic_offsets.begin());
+
+            if(same)
+            {
+                ++m_statistics.elided;
+                return;
+            }
+
+            bound.group = group;
+            bound.dynamic_offset_count = dynamic_offset_count;
+            std::copy_n(
+                dynamic_offsets, dynamic_offset_count,
+                bound.dynamic_offsets.begin());
+        }
+        else if(index < max_bind_groups)
+        {
+            /* Too many offsets to track, forget what was bound */
+            m_bind_groups[index] = {};
+        }
+
+        wgpuRenderPassEncoderSetBindGroup(
+            m_encoder, index, group, dynamic_offset_count, dynamic_offsets);
+        ++m_statistics.issued;
+    }
+
+    void set_vertex_buffer(
+        std::uint32_t slot,
+        WGPUBuffer buffer,
+        std::uint64_t offset,
+        std::uint64_t size)
+    {
+        auto const binding = buffer_binding_t{ buffer, offset, size };
+
+        if(slot < max_vertex_buffers)
+        {
+            if(m_vertex_buffers[slot] == binding)
+            {
+                ++m_statistics.elided;
+                return;
+            }
+
+            m_vertex_buffers[slot] = binding;
+        }
+
+        wgpuRenderPassEncoderSetVertexBuffer(m_encoder, slot, buffer, offset, size);
+        ++m_statistics.issued;
+    }
+
+    void set_index_buffer(
+        WGPUBuffer buffer,
+        WGPUIndexFormat format,
+        std::uint64_t offset,
+        std::uint64_t size)
+    {
+        auto const binding = buffer_binding_t{ buffer, offset, size };
+
+        if(m_index_buffer == binding && m_index_format == format)
+        {
+            ++m_statistics.elided;
+            return;
+        }
+
+        wgpuRenderPassEncoderSetIndexBuffer(m_encoder, buffer, format, offset, size);
+        m_index_buffer = binding;
+        m_index_format = format;
+        ++m_statistics.issued;
+    }
+
+    void draw(
+        std::uint32_t vertex_count,
+        std::uint32_t instance_count = 1u,
+        std::uint32_t first_vertex = 0u,
+        std::uint32_t first_instance = 0u)
+    {
+        wgpuRenderPassEncoderDraw(
+            m_encoder, vertex_count, instance_count, first_vertex, first_instance);
+        ++m_statistics.draws;
+    }
+
+    void draw_indexed(
+        std::uint32_t index_count,
+        std::uint32_t instance_count = 1u,
+        std::uint32_t first_index = 0u,
+        std::int32_t base_vertex = 0,
+        std::uint32_t first_instance = 0u)
+    {
+        wgpuRenderPassEncoderDrawIndexed(
+            m_encoder, index_count, instance_count,
+            first_index, base_vertex, first_instance);
+        ++m_statistics.draws;
+    }
+
+    void draw_indexed_indirect(WGPUBuffer indirect_buffer, std::uint64_t indirect_offset)
+    {
+        wgpuRenderPassEncoderDrawIndexedIndirect(m_encoder, indirect_buffer, indirect_offset);
+        ++m_statistics.draws;
+    }
+
+    /* Queries index of the pass's occlusion query set until the matching end */
+    void begin_occlusion_query(std::uint32_t query_index)
+    {
+        wgpuRenderPassEncoderBeginOcclusionQuery(m_encoder, query_index);
+    }
+
+    void end_occlusion_query()
+    {
+        wgpuRenderPassEncoderEndOcclusionQuery(m_encoder);
+    }
+
+    private:
+    struct bind_group_binding_t
+    {
+        WGPUBindGroup group = nullptr;
+        std::size_t dynamic_offset_count = 0u;
+        std::array<std::uint32_t, max_dynamic_offsets> dynamic_offsets{};
+    };
+
+    struct buffer_binding_t
+    {
+        WGPUBuffer buffer = nullptr;
+        std::uint64_t offset = 0u;
+        std::uint64_t size = 0u;
+
+        bool operator==(buffer_binding_t const &) const = default;
+    };
+
+    WGPURenderPassEncoder m_encoder;
+    render_pass_statistics & m_statistics;
+
+    WGPURenderPipeline m_pipeline = nullptr;
+    std::array<bind_group_binding_t, max_bind_groups> m_bind_groups{};
+    std::array<buffer_binding_t, max_vertex_buffers> m_vertex_buffers{};
+    buffer_binding_t m_index_buffer{};
+    WGPUIndexFormat m_index_format = WGPUIndexFormat_Undefined;
+}; /* class render_pass_state */
+
+#endif /* SDL_WEBGPU_DEMO_RENDER_PASS_STATE_HPP */
@@ -0,0 +1,231 @@
+#ifndef SDL_WEBGPU_DEMO_STAGING_BELT_HPP
+#define SDL_WEBGPU_DEMO_STAGING_BELT_HPP
+
+#include "gpu_memory.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Collects many small buffer uploads into a few large staging buffers that
+ * are created mapped, so the data is written straight into memory visible to
+ * the GPU. flush() records all pending copies into one command buffer and
+ * submits it. Chunks are not reused after a flush; the belt is meant for
+ * bursts of initial uploads (e.g. while loading), not for per-frame data.
+ */
+class staging_belt
+{
+    public:
+    static constexpr std::uint64_t copy_alignment = 4u;
+    static constexpr std::uint64_t default_chunk_size = 64u * 1024u;
+
+    staging_belt(
+        WGPUDevice device,
+        gpu_memory & memory,
+        std::uint64_t chunk_size = default_chunk_size) :
+        m_device(device),
+        m_memory(memory),
+        m_chunk_size(align(chunk_size))
+    {
+    }
+
+    ~staging_belt()
+    {
+        release_chunks();
+    }
+
+    staging_belt(staging_belt const &) = delete;
+    staging_belt & operator=(staging_belt const &) = delete;
+
+    void write(
+        WGPUBuffer destination,
+        std::uint64_t destination_offset,
+        void const * data,
+        std::size_t size)
+    {
+        if(destination_offset % copy_alignment || size % copy_alignment)
+        {
+            throw std::runtime_error{
+                "Staging belt writes must be 4 byte aligned"};
+        }
+
+        if(size == 0u)
+        {
+            return;
+        }
+
+        auto & chunk = acquire_chunk(size);
+        std::memcpy(chunk.mapped + chunk.used, data, size);
+
+        m_copies.push_back(
+        {
+            .source = chunk.buffer,
+            .source_offset = chunk.used,
+            .destination = destination,
+            .destination_offset = destination_offset,
+            .size = size
+        });
+
+        chunk.used += size;
+        m_pending_bytes += size;
+    }
+
+    template <typename T>
+    void write(
+        WGPUBuffer destination, std::uint64_t destination_offset, T const & value)
+    {
+        write(destination, destination_offset, &value, sizeof(value));
+    }
+
+    void flush(WGPUQueue queue)
+    {
+        if(m_copies.empty())
+        {
+            release_chunks();
+            return;
+        }
+
+        for(auto & chunk: m_chunks)
+        {
+            wgpuBufferUnmap(chunk.buffer);
+            chunk.mapped = nullptr;
+        }
+
+        WGPUCommandEncoderDescriptor const encoder_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "StagingBeltEncoder"
+        };
+
+        WGPUCommandEncoder encoder =
+            wgpuDeviceCreateCommandEncoder(m_device, &encoder_descriptor);
+
+        for(auto const & copy: m_copies)
+        {
+            wgpuCommandEncoderCopyBufferToBuffer(
+                encoder,
+                copy.source, copy.source_offset,
+                copy.destination, copy.destination_offset,
+                copy.size);
+        }
+
+        WGPUCommandBufferDescriptor const command_buffer_descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "StagingBeltCommands"
+        };
+
+        WGPUCommandBuffer command_buffer =
+            wgpuCommandEncoderFinish(encoder, &command_buffer_descriptor);
+
+        wgpuQueueSubmit(queue, 1, &command_buffer);
+
+        wgpuCommandBufferRelease(command_buffer);
+        wgpuCommandEncoderRelease(encoder);
+
+        m_copies.clear();
+        m_pending_bytes = 0u;
+
+        /* The submitted command buffer keeps the staging buffers alive */
+        release_chunks();
+    }
+
+    std::uint64_t pending_bytes() const
+    {
+        return m_pending_bytes;
+    }
+
+    private:
+    struct chunk_t
+    {
+        WGPUBuffer buffer = nullptr;
+        std::uint8_t * mapped = nullptr;
+        std::uint64_t size = 0u;
+        std::uint64_t used = 0u;
+    };
+
+    struct copy_t
+    {
+        WGPUBuffer source;
+        std::uint64_t source_offset;
+        WGPUBuffer destination;
+        std::uint64_t destination_offset;
+        std::uint64_t size;
+    };
+
+    static constexpr std::uint64_t align(std::uint64_t size)
+    {
+        return (size + copy_alignment - 1u) & ~(copy_alignment - 1u);
+    }
+
+    chunk_t & acquire_chunk(std::size_t size)
+    {
+        if(!m_chunks.empty())
+        {
+            auto & current = m_chunks.back();
+            if(current.size - current.used >= size)
+            {
+                return current;
+            }
+        }
+
+        auto const chunk_size = std::max<std::uint64_t>(m_chunk_size, size);
+
+        WGPUBufferDescriptor const descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = "StagingBeltChunk",
+            .usage = WGPUBufferUsage_CopySrc,
+            .size = chunk_size,
+            .mappedAtCreation = true
+        };
+
+        WGPUBuffer buffer = m_memory.create_buffer(m_device, descriptor);
+
+        if(!buffer)
+        {
+            throw std::runtime_error{"Staging buffer creation failed"};
+        }
+
+        auto * mapped = static_cast<std::uint8_t *>(
+            wgpuBufferGetMappedRange(buffer, 0, chunk_size));
+
+        if(!mapped)
+        {
+            m_memory.release(buffer);
+            throw std::runtime_error{"Staging buffer mapping failed"};
+        }
+
+        return m_chunks.emplace_back(chunk_t
+        {
+            .buffer = buffer,
+            .mapped = mapped,
+            .size = chunk_size,
+            .used = 0u
+        });
+    }
+
+    void release_chunks()
+    {
+        for(auto const & chunk: m_chunks)
+        {
+            m_memory.release(chunk.buffer);
+        }
+
+        m_chunks.clear();
+    }
+
+    WGPUDevice m_device;
+    gpu_memory & m_memory;
+    std::uint64_t m_chunk_size;
+    std::uint64_t m_pending_bytes = 0u;
+    std::vector<chunk_t> m_chunks;
+    std::vector<copy_t> m_copies;
+}; /* class staging_belt */
+
+#endif /* SDL_WEBGPU_DEMO_STAGING_BELT_HPP */
@@ -0,0 +1,47 @@
+#ifndef SDL_WEBGPU_DEMO_SURFACE_FORMAT_HPP
+#define SDL_WEBGPU_DEMO_SURFACE_FORMAT_HPP
+
+#include <webgpu/webgpu.h>
+
+/*
+ * Picks the swap chain format from the surface's preferred format, which
+ * is the one the compositor scans out without converting. Any other format
+ * costs a conversion blit per frame in the compositor.
+ *
+ * The demo writes display encoded colors, so an sRGB preference is mapped
+ * to its linear counterpart. Both share the same memory layout, so the
+ * compositor still scans the image out directly.
+ */
+inline WGPUTextureFormat choose_surface_format(WGPUSurface surface, WGPUAdapter adapter)
+{
+    auto const preferred = wgpuSurfaceGetPreferredFormat(surface, adapter);
+
+    switch(preferred)
+    {
+        case WGPUTextureFormat_BGRA8UnormSrgb:
+            return WGPUTextureFormat_BGRA8Unorm;
+        case WGPUTextureFormat_RGBA8UnormSrgb:
+            return WGPUTextureFormat_RGBA8Unorm;
+        case WGPUTextureFormat_Undefined:
+            // No preference reported; BGRA8Unorm is supported everywhere
+            return WGPUTextureFormat_BGRA8Unorm;
+        default:
+            return preferred;
+    }
+}
+
+constexpr char const * surface_format_name(WGPUTextureFormat format)
+{
+    switch(format)
+    {
+        case WGPUTextureFormat_BGRA8Unorm: return "BGRA8Unorm";
+        case WGPUTextureFormat_BGRA8UnormSrgb: return "BGRA8UnormSrgb";
+        case WGPUTextureFormat_RGBA8Unorm: return "RGBA8Unorm";
+        case WGPUTextureFormat_RGBA8UnormSrgb: return "RGBA8UnormSrgb";
+        case WGPUTextureFormat_RGB10A2Unorm: return "RGB10A2Unorm";
+        case WGPUTextureFormat_RGBA16Float: return "RGBA16Float";
+        default: return "other";
+    }
+}
+
+#endif /* SDL_WEBGPU_DEMO_SURFACE_FORMAT_HPP */
@@ -0,0 +1,299 @@
+#ifndef SDL_WEBGPU_DEMO_TELEMETRY_HPP
+#define SDL_WEBGPU_DEMO_TELEMETRY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Live frame statistics in a named shared memory segment. The render
+ * thread publishes after every frame with a handful of stores and no
+ * system call; monitors map the same segment read only and sample it
+ * whenever they like.
+ *
+ * The segment is a seqlock: the sequence number is odd while the writer
+ * updates the counters, and a reader retries until it copied the counters
+ * between two equal, even sequence numbers. The writer never waits.
+ */
+namespace telemetry
+{
+constexpr std::uint32_t segment_magic = 0x54475753u; /* "SWGT" */
+constexpr std::uint32_t segment_version = 2u;
+
+/* Present mode as published, so readers need not know webgpu.h's values */
+enum class present_mode_id : std::uint32_t
+{
+    unknown,
+    fifo,
+    mailbox,
+    immediate
+};
+
+constexpr char const * present_mode_name(present_mode_id mode)
+{
+    switch(mode)
+    {
+        case present_mode_id::fifo: return "Fifo";
+        case present_mode_id::mailbox: return "Mailbox";
+        case present_mode_id::immediate: return "Immediate";
+        default: return "unknown";
+    }
+}
+
+/* Totals count since the renderer was created and restart after a device loss */
+struct counters
+{
+    std::uint64_t frame_index;
+    double frame_ms;
+    double average_frame_ms;
+    double gpu_ms;
+    std::uint64_t draw_calls_total;
+    std::uint64_t state_calls_issued_total;
+    std::uint64_t state_calls_elided_total;
+    std::uint64_t upload_bytes_total;
+    std::uint64_t gpu_memory_bytes;
+    std::uint64_t gpu_memory_peak_bytes;
+    std::uint32_t frames_in_flight;
+    present_mode_id present_mode;
+    float resolution_scale;
+    std::uint32_t reserved;
+};
+
+struct segment
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t size;
+    std::uint32_t process_id;
+    std::atomic<std::uint32_t> sequence;
+    std::uint32_t padding;
+    counters data;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+/* A named shared memory mapping of one segment */
+class shared_segment
+{
+    public:
+    enum class access
+    {
+        create,
+        read
+    };
+
+    shared_segment(std::string const & name, access mode) :
+        m_name(name),
+        m_owner(mode == access::create)
+    {
+#if defined(_WIN32)
+        m_mapping = m_owner ?
+            CreateFileMappingA(
+                INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                0, sizeof(segment), name.c_str()) :
+            OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+
+        if(!m_mapping)
+        {
+            throw std::runtime_error{"Can't open telemetry segment: " + name};
+        }
+
+        m_segment = static_cast<segment *>(MapViewOfFile(
+            m_mapping, m_owner ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, sizeof(segment)));
+
+        if(!m_segment)
+        {
+            CloseHandle(m_mapping);
+            throw std::runtime_error{"Can't map telemetry segment: " + name};
+        }
+#else
+        // POSIX names are a single path component starting with a slash
+        m_name = "/" + name;
+
+        auto const fd = m_owner ?
+            shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644) :
+            shm_open(m_name.c_str(), O_RDONLY, 0);
+
+        if(fd < 0)
+        {
+            throw std::runtime_error{"Can't open telemetry segment: " + name};
+        }
+
+        if(m_owner && ftruncate(fd, sizeof(segment)) != 0)
+        {
+            close(fd);
+            shm_unlink(m_name.c_str());
+            throw std::runtime_error{"Can't size telemetry segment: " + name};
+        }
+
+        auto const address = mmap(
+            nullptr, sizeof(segment),
+            m_owner ? PROT_READ | PROT_WRITE : PROT_READ,
+            MAP_SHARED, fd, 0);
+        close(fd);
+
+        if(address == MAP_FAILED)
+        {
+            if(m_owner)
+            {
+                shm_unlink(m_name.c_str());
+            }
+            throw std::runtime_error{"Can't map telemetry segment: " + name};
+        }
+
+        m_segment = static_cast<segment *>(address);
+#endif
+    }
+
+    ~shared_segment()
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_segment);
+        CloseHandle(m_mapping);
+#else
+        munmap(m_segment, sizeof(segment));
+        if(m_owner)
+        {
+            shm_unlink(m_name.c_str());
+        }
+#endif
+    }
+
+    shared_segment(shared_segment const &) = delete;
+    shared_segment & operator=(shared_segment const &) = delete;
+
+    segment & get() const
+    {
+        return *m_segment;
+    }
+
+    private:
+    std::string m_name;
+    bool m_owner;
+    segment * m_segment = nullptr;
+#if defined(_WIN32)
+    HANDLE m_mapping = nullptr;
+#endif
+}; /* class shared_segment */
+
+class writer
+{
+    public:
+    explicit writer(std::string const & name) :
+        m_shared(name, shared_segment::access::create)
+    {
+        auto & s = m_shared.get();
+        s.sequence.store(1u, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        s.size = sizeof(segment);
+        s.version = segment_version;
+#if defined(_WIN32)
+        s.process_id = static_cast<std::uint32_t>(GetCurrentProcessId());
+#else
+        s.process_id = static_cast<std::uint32_t>(getpid());
+#endif
+        s.data = counters{};
+        s.magic = segment_magic;
+
+        s.sequence.store(2u, std::memory_order_release);
+    }
+
+    /* Call once per presented frame; fills in the frame times itself */
+    void publish(counters data)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        if(m_frame_index != 0u)
+        {
+            data.frame_ms =
+                std::chrono::duration<double, std::milli>(now - m_last_publish).count();
+            m_average_frame_ms = m_average_frame_ms == 0.0 ?
+                data.frame_ms :
+                m_average_frame_ms + 0.05 * (data.frame_ms - m_average_frame_ms);
+        }
+        m_last_publish = now;
+
+        data.frame_index = m_frame_index++;
+        data.average_frame_ms = m_average_frame_ms;
+
+        auto & s = m_shared.get();
+        auto const sequence = s.sequence.load(std::memory_order_relaxed);
+
+        s.sequence.store(sequence + 1u, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&s.data, &data, sizeof(data));
+        s.sequence.store(sequence + 2u, std::memory_order_release);
+    }
+
+    private:
+    shared_segment m_shared;
+    std::uint64_t m_frame_index = 0u;
+    double m_average_frame_ms = 0.0;
+    std::chrono::steady_clock::time_point m_last_publish;
+}; /* class writer */
+
+class reader
+{
+    public:
+    explicit reader(std::string const & name) :
+        m_shared(name, shared_segment::access::read)
+    {
+    }
+
+    /* Copies a consistent snapshot; false if the segment is not a valid one */
+    bool read(counters & data) const
+    {
+        auto const & s = m_shared.get();
+
+        for(;;)
+        {
+            auto const before = s.sequence.load(std::memory_order_acquire);
+            if(before & 1u)
+            {
+                continue;
+            }
+
+            if(s.magic != segment_magic || s.version != segment_version)
+            {
+                return false;
+            }
+
+            std::memcpy(&data, &s.data, sizeof(data));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if(s.sequence.load(std::memory_order_relaxed) == before)
+            {
+                return true;
+            }
+        }
+    }
+
+    std::uint32_t process_id() const
+    {
+        return m_shared.get().process_id;
+    }
+
+    private:
+    shared_segment m_shared;
+}; /* class reader */
+} /* namespace telemetry */
+
+#endif /* SDL_WEBGPU_DEMO_TELEMETRY_HPP */
@@ -0,0 +1,167 @@
+#include "telemetry.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/*
+ * Samples the telemetry segment of a running demo started with
+ * --telemetry=<name> and prints one line per interval. Per frame values
+ * are averages over the frames presented during the interval.
+ */
+namespace
+{
+struct reader_options
+{
+    std::string name;
+    std::uint32_t interval_ms = 1000u;
+    std::uint64_t samples = 0u;
+
+    static reader_options parse(int argc, char const * argv[])
+    {
+        auto options = reader_options{};
+
+        for(auto i = 1; i < argc; ++i)
+        {
+            auto const arg = std::string_view{argv[i]};
+
+            if(auto const value = option_value(arg, "--interval="))
+            {
+                options.interval_ms = parse_number<std::uint32_t>(arg, *value);
+            }
+            else if(auto const value = option_value(arg, "--samples="))
+            {
+                options.samples = parse_number<std::uint64_t>(arg, *value);
+            }
+            else if(options.name.empty() && arg.substr(0, 2) != "--")
+            {
+                options.name = arg;
+            }
+            else
+            {
+                throw std::runtime_error{"Unknown argument: " + std::string{arg}};
+            }
+        }
+
+        if(options.name.empty())
+        {
+            throw std::runtime_error{
+                "Usage: webgpu-telemetry <name> [--interval=<ms>] [--samples=<count>]"};
+        }
+
+        return options;
+    }
+
+    private:
+    static std::optional<std::string_view> option_value(
+        std::string_view arg, std::string_view name)
+    {
+        if(arg.substr(0, name.size()) != name)
+        {
+            return std::nullopt;
+        }
+
+        return arg.substr(name.size());
+    }
+
+    template <typename T>
+    static T parse_number(std::string_view arg, std::string_view value)
+    {
+        auto result = T{};
+        auto const [end, error] =
+            std::from_chars(value.data(), value.data() + value.size(), result);
+
+        if(error != std::errc{} || end != value.data() + value.size() || !(result > T{0}))
+        {
+            throw std::runtime_error{"Invalid value: " + std::string{arg}};
+        }
+
+        return result;
+    }
+};
+
+double per_frame(std::uint64_t later, std::uint64_t earlier, std::uint64_t frames)
+{
+    // Totals restart when the demo recovers from a device loss
+    if(frames == 0u || later < earlier)
+    {
+        return 0.0;
+    }
+
+    return static_cast<double>(later - earlier) / static_cast<double>(frames);
+}
+} /* namespace */
+
+int main(int argc, char const * argv[])
+{
+    try
+    {
+        auto const options = reader_options::parse(argc, argv);
+        telemetry::reader const reader{options.name};
+
+        auto previous = telemetry::counters{};
+        if(!reader.read(previous))
+        {
+            throw std::runtime_error{"Not a telemetry segment: " + options.name};
+        }
+
+        std::cout << "Process " << reader.process_id() << '\n';
+        std::cout <<
+            "   frame  frame ms   avg ms   gpu ms  draws/f  issued/f  elided/f" <<
+            "  upload B/f   GPU MiB  in flight  scale  mode\n";
+        std::cout << std::fixed;
+
+        for(auto sample = std::uint64_t{0};
+            options.samples == 0u || sample != options.samples;
+            ++sample)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds{options.interval_ms});
+
+            auto current = telemetry::counters{};
+            if(!reader.read(current))
+            {
+                throw std::runtime_error{"Telemetry segment became invalid"};
+            }
+
+            auto const frames = current.frame_index - previous.frame_index;
+
+            std::cout <<
+                std::setw(8) << current.frame_index <<
+                std::setprecision(2) <<
+                std::setw(10) << current.frame_ms <<
+                std::setw(9) << current.average_frame_ms <<
+                std::setw(9) << current.gpu_ms <<
+                std::setprecision(1) <<
+                std::setw(9) <<
+                per_frame(current.draw_calls_total, previous.draw_calls_total, frames) <<
+                std::setw(10) <<
+                per_frame(current.state_calls_issued_total, previous.state_calls_issued_total, frames) <<
+                std::setw(10) <<
+                per_frame(current.state_calls_elided_total, previous.state_calls_elided_total, frames) <<
+                std::setw(12) <<
+                per_frame(current.upload_bytes_total, previous.upload_bytes_total, frames) <<
+                std::setw(10) <<
+                static_cast<double>(current.gpu_memory_bytes) / (1024.0 * 1024.0) <<
+                std::setw(11) << current.frames_in_flight <<
+                std::setprecision(2) <<
+                std::setw(7) << current.resolution_scale <<
+                "  " << telemetry::present_mode_name(current.present_mode) << '\n' << std::flush;
+
+            previous = current;
+        }
+    }
+    catch (std::exception const & e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
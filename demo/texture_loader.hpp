@@ -0,0 +1,701 @@
+#ifndef SDL_WEBGPU_DEMO_TEXTURE_LOADER_HPP
+#define SDL_WEBGPU_DEMO_TEXTURE_LOADER_HPP
+
+#include "gpu_memory.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SDL_WEBGPU_DEMO_HAVE_SSE2 1
+#endif
+
+/*
+ * Loads textures that have been transcoded offline into one KTX2 file per
+ * compression family, named "<base>.<family>.ktx2" (e.g. "stone.bc.ktx2",
+ * "stone.astc.ktx2"). The loader picks the best family the device has
+ * enabled and uploads the whole mip chain with wgpuQueueWriteTexture. When
+ * no compressed family is usable, an "rgba8" variant is used, or the "bc"
+ * variant is decoded on the CPU if it holds BC1 or BC3 data.
+ *
+ * Only KTX2 files without supercompression are supported.
+ */
+enum class texture_family
+{
+    bc,
+    astc,
+    etc2,
+    rgba8
+};
+
+constexpr char const * texture_family_suffix(texture_family family)
+{
+    switch(family)
+    {
+        case texture_family::bc: return "bc";
+        case texture_family::astc: return "astc";
+        case texture_family::etc2: return "etc2";
+        case texture_family::rgba8: return "rgba8";
+    }
+
+    return "";
+}
+
+struct loaded_texture
+{
+    WGPUTexture texture = nullptr;
+    WGPUTextureView view = nullptr;
+    WGPUTextureFormat format = WGPUTextureFormat_Undefined;
+    texture_family family = texture_family::rgba8;
+    std::uint32_t width = 0u;
+    std::uint32_t height = 0u;
+    std::uint32_t mip_level_count = 0u;
+    std::uint64_t size_in_bytes = 0u;
+    gpu_memory * memory = nullptr;
+
+    void release()
+    {
+        if(view)
+        {
+            wgpuTextureViewRelease(view);
+            view = nullptr;
+        }
+
+        if(texture)
+        {
+            memory->release(texture);
+            texture = nullptr;
+        }
+    }
+};
+
+class texture_loader
+{
+    public:
+    texture_loader(WGPUDevice device, WGPUQueue queue, gpu_memory & memory) :
+        m_device(device),
+        m_queue(queue),
+        m_memory(memory)
+    {
+        /* Ordered from most to least preferred */
+        constexpr std::array candidates
+        {
+            std::pair{texture_family::bc, WGPUFeatureName_TextureCompressionBC},
+            std::pair{texture_family::astc, WGPUFeatureName_TextureCompressionASTC},
+            std::pair{texture_family::etc2, WGPUFeatureName_TextureCompressionETC2},
+        };
+
+        for(auto const & [family, feature]: candidates)
+        {
+            if(wgpuDeviceHasFeature(m_device, feature))
+            {
+                m_families.push_back(family);
+            }
+        }
+    }
+
+    /* Best compressed family supported by the device, rgba8 if none */
+    texture_family preferred_family() const
+    {
+        return m_families.empty() ? texture_family::rgba8 : m_families.front();
+    }
+
+    loaded_texture load(std::string const & base_path, char const * label) const
+    {
+        /* A corrupt variant only rules out itself, the next one is tried */
+        auto last_error = std::string{};
+        auto const read_variant = [&](texture_family family) -> std::optional<image_t>
+        {
+            auto const path = variant_path(base_path, family);
+            auto const file = read_file(path);
+            if(!file)
+            {
+                return std::nullopt;
+            }
+
+            try
+            {
+                return parse_ktx2(*file);
+            }
+            catch(std::runtime_error const & error)
+            {
+                last_error = path + ": " + error.what();
+                return std::nullopt;
+            }
+        };
+
+        for(auto const family: m_families)
+        {
+            if(auto const image = read_variant(family))
+            {
+                if(is_usable(image->format, family))
+                {
+                    return upload(*image, family, label);
+                }
+            }
+        }
+
+        if(auto const image = read_variant(texture_family::rgba8))
+        {
+            if(is_usable(image->format, texture_family::rgba8))
+            {
+                return upload(*image, texture_family::rgba8, label);
+            }
+        }
+
+        if(auto const image = read_variant(texture_family::bc))
+        {
+            if(can_decode_on_cpu(image->format))
+            {
+                return upload(decode_to_rgba8(*image), texture_family::rgba8, label);
+            }
+        }
+
+        auto message = "No usable texture variant for " + base_path;
+        if(!last_error.empty())
+        {
+            message += " (" + last_error + ")";
+        }
+
+        throw std::runtime_error{message};
+    }
+
+    private:
+    struct mip_level_t
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::vector<std::uint8_t> data;
+    };
+
+    struct image_t
+    {
+        WGPUTextureFormat format = WGPUTextureFormat_Undefined;
+        std::vector<mip_level_t> levels;
+    };
+
+    /* Enough for a 2^31 texel wide texture */
+    static constexpr std::uint32_t max_level_count = 32u;
+
+    struct format_info_t
+    {
+        std::uint32_t block_width;
+        std::uint32_t block_height;
+        std::uint32_t block_bytes;
+    };
+
+    static std::string variant_path(
+        std::string const & base_path, texture_family family)
+    {
+        return base_path + '.' + texture_family_suffix(family) + ".ktx2";
+    }
+
+    static std::optional<std::vector<std::uint8_t>> read_file(
+        std::string const & path)
+    {
+        std::ifstream stream{path, std::ios::binary};
+        if(!stream)
+        {
+            return std::nullopt;
+        }
+
+        return std::vector<std::uint8_t>{
+            std::istreambuf_iterator<char>{stream},
+            std::istreambuf_iterator<char>{}};
+    }
+
+    static WGPUTextureFormat format_from_vk(std::uint32_t vk_format)
+    {
+        switch(vk_format)
+        {
+            case 37: return WGPUTextureFormat_RGBA8Unorm;
+            case 43: return WGPUTextureFormat_RGBA8UnormSrgb;
+            case 131: case 133: return WGPUTextureFormat_BC1RGBAUnorm;
+            case 132: case 134: return WGPUTextureFormat_BC1RGBAUnormSrgb;
+            case 137: return WGPUTextureFormat_BC3RGBAUnorm;
+            case 138: return WGPUTextureFormat_BC3RGBAUnormSrgb;
+            case 145: return WGPUTextureFormat_BC7RGBAUnorm;
+            case 146: return WGPUTextureFormat_BC7RGBAUnormSrgb;
+            case 147: return WGPUTextureFormat_ETC2RGB8Unorm;
+            case 148: return WGPUTextureFormat_ETC2RGB8UnormSrgb;
+            case 151: return WGPUTextureFormat_ETC2RGBA8Unorm;
+            case 152: return WGPUTextureFormat_ETC2RGBA8UnormSrgb;
+            case 157: return WGPUTextureFormat_ASTC4x4Unorm;
+            case 158: return WGPUTextureFormat_ASTC4x4UnormSrgb;
+            default: return WGPUTextureFormat_Undefined;
+        }
+    }
+
+    static format_info_t format_info(WGPUTextureFormat format)
+    {
+        switch(format)
+        {
+            case WGPUTextureFormat_BC1RGBAUnorm:
+            case WGPUTextureFormat_BC1RGBAUnormSrgb:
+            case WGPUTextureFormat_ETC2RGB8Unorm:
+            case WGPUTextureFormat_ETC2RGB8UnormSrgb:
+                return { 4u, 4u, 8u };
+
+            case WGPUTextureFormat_BC3RGBAUnorm:
+            case WGPUTextureFormat_BC3RGBAUnormSrgb:
+            case WGPUTextureFormat_BC7RGBAUnorm:
+            case WGPUTextureFormat_BC7RGBAUnormSrgb:
+            case WGPUTextureFormat_ETC2RGBA8Unorm:
+            case WGPUTextureFormat_ETC2RGBA8UnormSrgb:
+            case WGPUTextureFormat_ASTC4x4Unorm:
+            case WGPUTextureFormat_ASTC4x4UnormSrgb:
+                return { 4u, 4u, 16u };
+
+            default:
+                return { 1u, 1u, 4u };
+        }
+    }
+
+    static bool is_usable(WGPUTextureFormat format, texture_family family)
+    {
+        switch(family)
+        {
+            case texture_family::bc:
+                return
+                    format == WGPUTextureFormat_BC1RGBAUnorm ||
+                    format == WGPUTextureFormat_BC1RGBAUnormSrgb ||
+                    format == WGPUTextureFormat_BC3RGBAUnorm ||
+                    format == WGPUTextureFormat_BC3RGBAUnormSrgb ||
+                    format == WGPUTextureFormat_BC7RGBAUnorm ||
+                    format == WGPUTextureFormat_BC7RGBAUnormSrgb;
+            case texture_family::astc:
+                return
+                    format == WGPUTextureFormat_ASTC4x4Unorm ||
+                    format == WGPUTextureFormat_ASTC4x4UnormSrgb;
+            case texture_family::etc2:
+                return
+                    format == WGPUTextureFormat_ETC2RGB8Unorm ||
+                    format == WGPUTextureFormat_ETC2RGB8UnormSrgb ||
+                    format == WGPUTextureFormat_ETC2RGBA8Unorm ||
+                    format == WGPUTextureFormat_ETC2RGBA8UnormSrgb;
+            case texture_family::rgba8:
+                return
+                    format == WGPUTextureFormat_RGBA8Unorm ||
+                    format == WGPUTextureFormat_RGBA8UnormSrgb;
+        }
+
+        return false;
+    }
+
+    static bool can_decode_on_cpu(WGPUTextureFormat format)
+    {
+        return
+            format == WGPUTextureFormat_BC1RGBAUnorm ||
+            format == WGPUTextureFormat_BC1RGBAUnormSrgb ||
+            format == WGPUTextureFormat_BC3RGBAUnorm ||
+            format == WGPUTextureFormat_BC3RGBAUnormSrgb;
+    }
+
+    template <typename T>
+    static T read_le(std::vector<std::uint8_t> const & data, std::size_t offset)
+    {
+        if(offset + sizeof(T) > data.size())
+        {
+            throw std::runtime_error{"Truncated KTX2 file"};
+        }
+
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    static image_t parse_ktx2(std::vector<std::uint8_t> const & file)
+    {
+        static constexpr std::array<std::uint8_t, 12> identifier
+        {
+            0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+        };
+
+        if(file.size() < 80u ||
+           !std::equal(identifier.begin(), identifier.end(), file.begin()))
+        {
+            throw std::runtime_error{"Not a KTX2 file"};
+        }
+
+        auto const vk_format = read_le<std::uint32_t>(file, 12);
+        auto const width = read_le<std::uint32_t>(file, 20);
+        auto const height = read_le<std::uint32_t>(file, 24);
+        auto const depth = read_le<std::uint32_t>(file, 28);
+        auto const layers = read_le<std::uint32_t>(file, 32);
+        auto const faces = read_le<std::uint32_t>(file, 36);
+        auto const level_count =
+            std::max(read_le<std::uint32_t>(file, 40), std::uint32_t{1});
+        auto const supercompression = read_le<std::uint32_t>(file, 44);
+
+        if(depth > 1u || layers > 1u || faces != 1u || supercompression != 0u ||
+           width == 0u || height == 0u || level_count > max_level_count)
+        {
+            throw std::runtime_error{"Unsupported KTX2 layout"};
+        }
+
+        auto image = image_t{ .format = format_from_vk(vk_format) };
+        auto const info = format_info(image.format);
+        image.levels.reserve(level_count);
+
+        /* Level index starts right after the fixed size header */
+        constexpr auto level_index_offset = std::size_t{80};
+        for(auto level = std::uint32_t{0}; level != level_count; ++level)
+        {
+            auto const entry = level_index_offset + level * 24u;
+            auto const offset = read_le<std::uint64_t>(file, entry);
+            auto const length = read_le<std::uint64_t>(file, entry + 8u);
+
+            /* Written so that a corrupt offset cannot wrap around */
+            if(offset > file.size() || length > file.size() - offset)
+            {
+                throw std::runtime_error{"Truncated KTX2 level data"};
+            }
+
+            auto const level_width = std::max(width >> level, std::uint32_t{1});
+            auto const level_height = std::max(height >> level, std::uint32_t{1});
+
+            /* Uploads and CPU decoding read whole blocks of every level */
+            auto const blocks_wide =
+                (std::uint64_t{level_width} + info.block_width - 1u) / info.block_width;
+            auto const blocks_high =
+                (std::uint64_t{level_height} + info.block_height - 1u) / info.block_height;
+            if(image.format != WGPUTextureFormat_Undefined &&
+               length < blocks_wide * blocks_high * info.block_bytes)
+            {
+                throw std::runtime_error{"KTX2 level data smaller than its size"};
+            }
+
+            image.levels.push_back(
+            {
+                .width = level_width,
+                .height = level_height,
+                .data = std::vector<std::uint8_t>(
+                    file.begin() + static_cast<std::ptrdiff_t>(offset),
+                    file.begin() + static_cast<std::ptrdiff_t>(offset + length))
+            });
+        }
+
+        return image;
+    }
+
+    loaded_texture upload(
+        image_t const & image, texture_family family, char const * label) const
+    {
+        auto const info = format_info(image.format);
+        auto const & base = image.levels.front();
+        auto const mip_level_count =
+            static_cast<std::uint32_t>(image.levels.size());
+
+        WGPUTextureDescriptor const descriptor =
+        {
+            .nextInChain = nullptr,
+            .label = label,
+            .usage = WGPUTextureUsage_TextureBinding | WGPUTextureUsage_CopyDst,
+            .dimension = WGPUTextureDimension_2D,
+            .size = { base.width, base.height, 1u },
+            .format = image.format,
+            .mipLevelCount = mip_level_count,
+            .sampleCount = 1u,
+            .viewFormatCount = 0u,
+            .viewFormats = nullptr
+        };
+
+        auto result = loaded_texture
+        {
+            .texture = m_memory.create_texture(m_device, descriptor),
+            .view = nullptr,
+            .format = image.format,
+            .family = family,
+            .width = base.width,
+            .height = base.height,
+            .mip_level_count = mip_level_count,
+            .memory = &m_memory
+        };
+
+        if(!result.texture)
+        {
+            throw std::runtime_error{"Texture creation failed"};
+        }
+
+        for(auto level = std::uint32_t{0}; level != mip_level_count; ++level)
+        {
+            auto const & mip = image.levels[level];
+            auto const blocks_wide =
+                (mip.width + info.block_width - 1u) / info.block_width;
+            auto const blocks_high =
+                (mip.height + info.block_height - 1u) / info.block_height;
+
+            WGPUImageCopyTexture const destination =
+            {
+                .nextInChain = nullptr,
+                .texture = result.texture,
+                .mipLevel = level,
+                .origin = { 0u, 0u, 0u },
+                .aspect = WGPUTextureAspect_All
+            };
+
+            WGPUTextureDataLayout const layout =
+            {
+                .nextInChain = nullptr,
+                .offset = 0u,
+                .bytesPerRow = blocks_wide * info.block_bytes,
+                .rowsPerImage = blocks_high
+            };
+
+            /* Copies of block compressed data cover whole blocks */
+            WGPUExtent3D const extent =
+            {
+                .width = blocks_wide * info.block_width,
+                .height = blocks_high * info.block_height,
+                .depthOrArrayLayers = 1u
+            };
+
+            wgpuQueueWriteTexture(
+                m_queue, &destination,
+                mip.data.data(), mip.data.size(),
+                &layout, &extent);
+
+            result.size_in_bytes += mip.data.size();
+        }
+
+        result.view = wgpuTextureCreateView(result.texture, nullptr);
+
+        return result;
+    }
+
+    static image_t decode_to_rgba8(image_t const & image)
+    {
+        auto const has_alpha_block =
+            image.format == WGPUTextureFormat_BC3RGBAUnorm ||
+            image.format == WGPUTextureFormat_BC3RGBAUnormSrgb;
+        auto const is_srgb =
+            image.format == WGPUTextureFormat_BC1RGBAUnormSrgb ||
+            image.format == WGPUTextureFormat_BC3RGBAUnormSrgb;
+
+        auto result = image_t
+        {
+            .format = is_srgb ?
+                WGPUTextureFormat_RGBA8UnormSrgb :
+                WGPUTextureFormat_RGBA8Unorm
+        };
+
+        for(auto const & mip: image.levels)
+        {
+            auto const blocks_wide = (mip.width + 3u) / 4u;
+            auto const blocks_high = (mip.height + 3u) / 4u;
+            auto const block_bytes = has_alpha_block ? 16u : 8u;
+
+            if(mip.data.size() < std::size_t{blocks_wide} * blocks_high * block_bytes)
+            {
+                throw std::runtime_error{"Truncated BC level data"};
+            }
+
+            /* Decode whole blocks, the copy extent covers the padding too */
+            auto const stride = blocks_wide * 4u;
+            auto pixels =
+                std::vector<std::uint8_t>(std::size_t{stride} * blocks_high * 4u * 4u);
+
+            auto const * block = mip.data.data();
+            for(auto by = 0u; by != blocks_high; ++by)
+            {
+                for(auto bx = 0u; bx != blocks_wide; ++bx)
+                {
+                    auto * out = reinterpret_cast<std::uint32_t *>(
+                        pixels.data()) + (by * 4u * stride) + bx * 4u;
+
+                    if(has_alpha_block)
+                    {
+                        decode_bc1_block(block + 8, out, stride, false);
+                        decode_bc3_alpha(block, out, stride);
+                    }
+                    else
+                    {
+                        decode_bc1_block(block, out, stride, true);
+                    }
+
+                    block += block_bytes;
+                }
+            }
+
+            /* Drop the block padding so rows are tightly packed */
+            auto level = mip_level_t
+            {
+                .width = mip.width,
+                .height = mip.height,
+                .data = std::vector<std::uint8_t>(
+                    std::size_t{mip.width} * mip.height * 4u)
+            };
+
+            for(auto y = 0u; y != mip.height; ++y)
+            {
+                std::memcpy(
+                    level.data.data() + std::size_t{y} * mip.width * 4u,
+                    pixels.data() + std::size_t{y} * stride * 4u,
+                    std::size_t{mip.width} * 4u);
+            }
+
+            result.levels.push_back(std::move(level));
+        }
+
+        return result;
+    }
+
+    static void decode_bc1_block(
+        std::uint8_t const * block,
+        std::uint32_t * out,
+        std::uint32_t stride,
+        bool allow_punch_through)
+    {
+        std::uint16_t c0;
+        std::uint16_t c1;
+        std::uint32_t indices;
+        std::memcpy(&c0, block, 2);
+        std::memcpy(&c1, block + 2, 2);
+        std::memcpy(&indices, block + 4, 4);
+
+        auto const palette = bc1_palette(c0, c1, allow_punch_through);
+
+        for(auto row = 0u; row != 4u; ++row)
+        {
+            auto const bits = indices >> (row * 8u);
+            auto * dst = out + row * stride;
+
+#if defined(SDL_WEBGPU_DEMO_HAVE_SSE2)
+            auto const pixels = _mm_set_epi32(
+                static_cast<int>(palette[(bits >> 6) & 3u]),
+                static_cast<int>(palette[(bits >> 4) & 3u]),
+                static_cast<int>(palette[(bits >> 2) & 3u]),
+                static_cast<int>(palette[bits & 3u]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), pixels);
+#else
+            for(auto column = 0u; column != 4u; ++column)
+            {
+                dst[column] = palette[(bits >> (column * 2u)) & 3u];
+            }
+#endif
+        }
+    }
+
+    static std::array<std::uint32_t, 4> bc1_palette(
+        std::uint16_t c0, std::uint16_t c1, bool allow_punch_through)
+    {
+        auto const expand = [](std::uint16_t c)
+        {
+            auto const r = (c >> 11) & 0x1Fu;
+            auto const g = (c >> 5) & 0x3Fu;
+            auto const b = c & 0x1Fu;
+            return std::array<std::uint32_t, 4>
+            {
+                (r << 3) | (r >> 2),
+                (g << 2) | (g >> 4),
+                (b << 3) | (b >> 2),
+                0xFFu
+            };
+        };
+
+        auto const e0 = expand(c0);
+        auto const e1 = expand(c1);
+
+        auto const pack = [](auto const & c)
+        {
+            return c[0] | (c[1] << 8) | (c[2] << 16) | (c[3] << 24);
+        };
+
+        std::array<std::uint32_t, 4> palette{ pack(e0), pack(e1), 0u, 0u };
+
+        if(c0 > c1 || !allow_punch_through)
+        {
+#if defined(SDL_WEBGPU_DEMO_HAVE_SSE2)
+            /* Both interpolated colors at once: (2a + b) / 3 per channel */
+            auto const a = _mm_set_epi16(
+                static_cast<short>(e1[3]), static_cast<short>(e1[2]),
+                static_cast<short>(e1[1]), static_cast<short>(e1[0]),
+                static_cast<short>(e0[3]), static_cast<short>(e0[2]),
+                static_cast<short>(e0[1]), static_cast<short>(e0[0]));
+            auto const b = _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2));
+            auto const sum = _mm_add_epi16(_mm_add_epi16(a, a), b);
+            auto const third = _mm_mulhi_epu16(sum, _mm_set1_epi16(0x5556));
+            auto const packed = _mm_packus_epi16(third, third);
+            palette[2] = static_cast<std::uint32_t>(_mm_cvtsi128_si32(packed));
+            palette[3] = static_cast<std::uint32_t>(
+                _mm_cvtsi128_si32(_mm_srli_si128(packed, 4)));
+#else
+            std::array<std::uint32_t, 4> c2{};
+            std::array<std::uint32_t, 4> c3{};
+            for(auto i = 0u; i != 4u; ++i)
+            {
+                c2[i] = (2u * e0[i] + e1[i]) / 3u;
+                c3[i] = (e0[i] + 2u * e1[i]) / 3u;
+            }
+            palette[2] = pack(c2);
+            palette[3] = pack(c3);
+#endif
+        }
+        else
+        {
+            std::array<std::uint32_t, 4> c2{};
+            for(auto i = 0u; i != 4u; ++i)
+            {
+                c2[i] = (e0[i] + e1[i]) / 2u;
+            }
+            palette[2] = pack(c2);
+            palette[3] = 0u;
+        }
+
+        return palette;
+    }
+
+    static void decode_bc3_alpha(
+        std::uint8_t const * block, std::uint32_t * out, std::uint32_t stride)
+    {
+        std::uint32_t const a0 = block[0];
+        std::uint32_t const a1 = block[1];
+
+        std::array<std::uint32_t, 8> alpha{ a0, a1 };
+        if(a0 > a1)
+        {
+            for(auto i = 1u; i != 7u; ++i)
+            {
+                alpha[i + 1u] = ((7u - i) * a0 + i * a1) / 7u;
+            }
+        }
+        else
+        {
+            for(auto i = 1u; i != 5u; ++i)
+            {
+                alpha[i + 1u] = ((5u - i) * a0 + i * a1) / 5u;
+            }
+            alpha[6] = 0u;
+            alpha[7] = 0xFFu;
+        }
+
+        std::uint64_t bits = 0u;
+        std::memcpy(&bits, block + 2, 6);
+
+        for(auto i = 0u; i != 16u; ++i)
+        {
+            auto & pixel = out[(i / 4u) * stride + (i % 4u)];
+            pixel = (pixel & 0x00FFFFFFu) | (alpha[(bits >> (3u * i)) & 7u] << 24);
+        }
+    }
+
+    WGPUDevice m_device;
+    WGPUQueue m_queue;
+    gpu_memory & m_memory;
+    std::vector<texture_family> m_families;
+}; /* class texture_loader */
+
+#endif /* SDL_WEBGPU_DEMO_TEXTURE_LOADER_HPP */
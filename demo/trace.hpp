@@ -0,0 +1,325 @@
+#ifndef SDL_WEBGPU_DEMO_TRACE_HPP
+#define SDL_WEBGPU_DEMO_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Minimal span tracer that writes Chrome trace event JSON, which Perfetto
+ * and chrome://tracing load directly.
+ *
+ * Every thread appends to its own fixed size ring buffer, so recording takes
+ * no locks; only the first event of a thread registers its buffer. A full
+ * buffer overwrites its oldest events, keeping the most recent ones of a
+ * long session, and the trace notes how many were lost. Names must be
+ * string literals (or otherwise outlive the trace), since only the pointer
+ * is stored.
+ *
+ * While tracing is disabled a span costs one relaxed atomic load.
+ */
+namespace trace
+{
+struct event
+{
+    char const * name;
+    std::int64_t begin_ns;
+    std::int64_t duration_ns;
+    char phase;
+};
+
+class thread_buffer
+{
+    public:
+    static constexpr std::size_t capacity = std::size_t{1} << 16;
+    static_assert((capacity & (capacity - 1u)) == 0u, "Ring indexing masks");
+
+    thread_buffer(std::uint32_t thread_id, std::string thread_name) :
+        m_events(capacity),
+        m_thread_id(thread_id),
+        m_thread_name(std::move(thread_name))
+    {
+    }
+
+    void record(event const & e)
+    {
+        auto const written = m_written.load(std::memory_order_relaxed);
+        m_events[written & (capacity - 1u)] = e;
+        m_written.store(written + 1u, std::memory_order_release);
+    }
+
+    std::size_t size() const
+    {
+        auto const written = m_written.load(std::memory_order_acquire);
+        return written < capacity ? static_cast<std::size_t>(written) : capacity;
+    }
+
+    /* Oldest event first, also once the buffer has wrapped */
+    event const & operator[](std::size_t index) const
+    {
+        auto const written = m_written.load(std::memory_order_acquire);
+        auto const oldest = written < capacity ? 0u : written & (capacity - 1u);
+        return m_events[(oldest + index) & (capacity - 1u)];
+    }
+
+    /* Events lost to wrapping */
+    std::uint64_t overwritten() const
+    {
+        auto const written = m_written.load(std::memory_order_acquire);
+        return written < capacity ? 0u : written - capacity;
+    }
+
+    std::uint32_t thread_id() const
+    {
+        return m_thread_id;
+    }
+
+    std::string const & thread_name() const
+    {
+        return m_thread_name;
+    }
+
+    void set_thread_name(std::string name)
+    {
+        m_thread_name = std::move(name);
+    }
+
+    private:
+    std::vector<event> m_events;
+    std::atomic<std::uint64_t> m_written = 0u;
+    std::uint32_t m_thread_id;
+    std::string m_thread_name;
+}; /* class thread_buffer */
+
+namespace detail
+{
+inline std::atomic<bool> enabled = false;
+
+inline std::chrono::steady_clock::time_point const epoch =
+    std::chrono::steady_clock::now();
+
+struct registry_t
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<thread_buffer>> buffers;
+};
+
+/* Buffers are owned here so they outlive the threads that filled them */
+inline registry_t & registry()
+{
+    static registry_t instance;
+    return instance;
+}
+
+inline thread_buffer & local_buffer()
+{
+    thread_local thread_buffer * buffer = nullptr;
+
+    if(!buffer)
+    {
+        auto & reg = registry();
+        std::lock_guard<std::mutex> lock{reg.mutex};
+
+        auto const thread_id = static_cast<std::uint32_t>(reg.buffers.size() + 1u);
+
+        reg.buffers.push_back(
+            std::make_unique<thread_buffer>(
+                thread_id, "thread " + std::to_string(thread_id)));
+        buffer = reg.buffers.back().get();
+    }
+
+    return *buffer;
+}
+
+inline void write_escaped(std::ostream & out, char const * text)
+{
+    for(; *text; ++text)
+    {
+        auto const c = static_cast<unsigned char>(*text);
+
+        if(c == '"' || c == '\\')
+        {
+            out << '\\' << *text;
+        }
+        else if(c < 0x20u)
+        {
+            auto constexpr digits = "0123456789abcdef";
+            out << "\\u00" << digits[c >> 4] << digits[c & 0xFu];
+        }
+        else
+        {
+            out << *text;
+        }
+    }
+}
+} /* namespace detail */
+
+inline void enable(bool enabled)
+{
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+inline bool enabled()
+{
+    return detail::enabled.load(std::memory_order_relaxed);
+}
+
+/* Names the calling thread in the trace */
+inline void name_thread(std::string name)
+{
+    auto & buffer = detail::local_buffer();
+    std::lock_guard<std::mutex> lock{detail::registry().mutex};
+    buffer.set_thread_name(std::move(name));
+}
+
+inline std::int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - detail::epoch).count();
+}
+
+/* Records a span with explicit times, e.g. one that ends in a callback */
+inline void complete(char const * name, std::int64_t begin_ns, std::int64_t end_ns)
+{
+    if(enabled())
+    {
+        detail::local_buffer().record({ name, begin_ns, end_ns - begin_ns, 'X' });
+    }
+}
+
+inline void instant(char const * name)
+{
+    if(enabled())
+    {
+        detail::local_buffer().record({ name, now_ns(), 0, 'i' });
+    }
+}
+
+class scoped_span
+{
+    public:
+    explicit scoped_span(char const * name) :
+        m_name(enabled() ? name : nullptr),
+        m_begin_ns(m_name ? now_ns() : 0)
+    {
+    }
+
+    ~scoped_span()
+    {
+        end();
+    }
+
+    /* Ends the span before the end of the scope */
+    void end()
+    {
+        if(m_name)
+        {
+            detail::local_buffer().record(
+                { m_name, m_begin_ns, now_ns() - m_begin_ns, 'X' });
+            m_name = nullptr;
+        }
+    }
+
+    scoped_span(scoped_span const &) = delete;
+    scoped_span & operator=(scoped_span const &) = delete;
+
+    private:
+    char const * m_name;
+    std::int64_t m_begin_ns;
+}; /* class scoped_span */
+
+/*
+ * Writes everything recorded so far. Meant to run once recording threads
+ * are quiet, typically on exit.
+ */
+inline void write_chrome_json(std::string const & path)
+{
+    std::ofstream out{path};
+
+    if(!out)
+    {
+        throw std::runtime_error{"Can't open trace file: " + path};
+    }
+
+    auto & reg = detail::registry();
+    std::lock_guard<std::mutex> lock{reg.mutex};
+
+    // Microseconds with nanosecond resolution
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    auto first = true;
+    auto const separator = [&first, &out]
+    {
+        if(!first)
+        {
+            out << ",\n";
+        }
+        first = false;
+    };
+
+    for(auto const & buffer: reg.buffers)
+    {
+        separator();
+        out <<
+            "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" <<
+            buffer->thread_id() << ",\"args\":{\"name\":\"";
+        detail::write_escaped(out, buffer->thread_name().c_str());
+        out << "\"}}";
+
+        auto const count = buffer->size();
+        for(auto i = std::size_t{0}; i != count; ++i)
+        {
+            auto const & e = (*buffer)[i];
+
+            separator();
+            out << "{\"name\":\"";
+            detail::write_escaped(out, e.name);
+            out <<
+                "\",\"cat\":\"demo\",\"ph\":\"" << e.phase <<
+                "\",\"pid\":1,\"tid\":" << buffer->thread_id() <<
+                ",\"ts\":" << static_cast<double>(e.begin_ns) * 1.0e-3;
+
+            if(e.phase == 'X')
+            {
+                out << ",\"dur\":" << static_cast<double>(e.duration_ns) * 1.0e-3;
+            }
+            else
+            {
+                out << ",\"s\":\"t\"";
+            }
+
+            out << '}';
+        }
+
+        // The ring wrapped, so the thread's trace starts late
+        if(buffer->overwritten() != 0u)
+        {
+            separator();
+            out <<
+                "{\"ph\":\"M\",\"name\":\"overwritten_events\",\"pid\":1,\"tid\":" <<
+                buffer->thread_id() << ",\"args\":{\"count\":" <<
+                buffer->overwritten() << ",\"capacity\":" <<
+                thread_buffer::capacity << "}}";
+        }
+    }
+
+    out << "]}\n";
+}
+} /* namespace trace */
+
+#define WEBGPU_SDL_TRACE_CONCAT_IMPL(A, B) A##B
+#define WEBGPU_SDL_TRACE_CONCAT(A, B) WEBGPU_SDL_TRACE_CONCAT_IMPL(A, B)
+#define WEBGPU_SDL_TRACE_SCOPE(NAME) \
+    trace::scoped_span const WEBGPU_SDL_TRACE_CONCAT(trace_span_, __LINE__){NAME}
+
+#endif /* SDL_WEBGPU_DEMO_TRACE_HPP */
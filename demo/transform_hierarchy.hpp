@@ -0,0 +1,186 @@
+#ifndef SDL_WEBGPU_DEMO_TRANSFORM_HIERARCHY_HPP
+#define SDL_WEBGPU_DEMO_TRANSFORM_HIERARCHY_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SDL_WEBGPU_DEMO_SSE 1
+#endif
+
+/*
+ * Parent relative transforms of a scene tree and their world matrices, in
+ * flat arrays indexed by node. Nodes are appended level by level, so the
+ * arrays are sorted by depth: parents precede their children and the
+ * children of one node are usually contiguous.
+ *
+ * set_local() only marks the node dirty. update() walks the arrays once
+ * and recomputes the world matrix of every dirty node and of every node
+ * whose parent was recomputed in the same walk, so an unchanged subtree
+ * costs one flag test per node. The recomputed nodes are collected into
+ * index ranges for the GPU upload; ranges closer than merge_gap nodes are
+ * merged, so a scattered update does not turn into many tiny writes.
+ */
+class transform_hierarchy
+{
+    public:
+    static constexpr std::uint32_t no_parent = ~std::uint32_t{0};
+    static constexpr std::uint32_t merge_gap = 16u;
+
+    struct index_range
+    {
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    void reserve(std::size_t node_count)
+    {
+        m_parent.reserve(node_count);
+        m_depth.reserve(node_count);
+        m_local.reserve(node_count);
+        m_world.reserve(node_count);
+        m_dirty.reserve(node_count);
+        m_recomputed.reserve(node_count);
+    }
+
+    /* Appends a node below parent; nodes must be added level by level */
+    std::uint32_t add_node(std::uint32_t parent, glm::mat4 const & local)
+    {
+        auto const index = static_cast<std::uint32_t>(m_parent.size());
+
+        if(parent != no_parent && parent >= index)
+        {
+            throw std::runtime_error{"Transform parent must be added before its children"};
+        }
+
+        auto const depth = parent == no_parent ? 0u : m_depth[parent] + 1u;
+        if(!m_depth.empty() && depth < m_depth.back())
+        {
+            throw std::runtime_error{"Transform nodes must be added level by level"};
+        }
+
+        m_parent.push_back(parent);
+        m_depth.push_back(depth);
+        m_local.push_back(local);
+        m_world.push_back(local);
+        m_dirty.push_back(1u);
+        m_recomputed.push_back(0u);
+
+        return index;
+    }
+
+    std::size_t size() const
+    {
+        return m_parent.size();
+    }
+
+    void set_local(std::uint32_t node, glm::mat4 const & local)
+    {
+        m_local[node] = local;
+        m_dirty[node] = 1u;
+    }
+
+    glm::mat4 const & local(std::uint32_t node) const
+    {
+        return m_local[node];
+    }
+
+    std::span<glm::mat4 const> world() const
+    {
+        return m_world;
+    }
+
+    /* Recomputes the changed world matrices; returns how many */
+    std::size_t update()
+    {
+        m_ranges.clear();
+        auto recomputed = std::size_t{0};
+
+        for(auto i = std::uint32_t{0}; i != m_parent.size(); ++i)
+        {
+            auto const parent = m_parent[i];
+            auto const changed = static_cast<std::uint8_t>(
+                m_dirty[i] | (parent == no_parent ? 0u : m_recomputed[parent]));
+
+            m_recomputed[i] = changed;
+            m_dirty[i] = 0u;
+
+            if(!changed)
+            {
+                continue;
+            }
+
+            if(parent == no_parent)
+            {
+                m_world[i] = m_local[i];
+            }
+            else
+            {
+                multiply(m_world[parent], m_local[i], m_world[i]);
+            }
+
+            if(!m_ranges.empty() && i - m_ranges.back().end <= merge_gap)
+            {
+                m_ranges.back().end = i + 1u;
+            }
+            else
+            {
+                m_ranges.push_back({ i, i + 1u });
+            }
+
+            ++recomputed;
+        }
+
+        return recomputed;
+    }
+
+    /* Nodes whose world matrix may have changed in the last update() */
+    std::span<index_range const> changed_ranges() const
+    {
+        return m_ranges;
+    }
+
+    private:
+    /* out = a * b, column major like glm */
+    static void multiply(glm::mat4 const & a, glm::mat4 const & b, glm::mat4 & out)
+    {
+#if defined(SDL_WEBGPU_DEMO_SSE)
+        auto const * a_columns = glm::value_ptr(a);
+        auto const * b_columns = glm::value_ptr(b);
+        auto * out_columns = glm::value_ptr(out);
+
+        auto const a0 = _mm_loadu_ps(a_columns);
+        auto const a1 = _mm_loadu_ps(a_columns + 4);
+        auto const a2 = _mm_loadu_ps(a_columns + 8);
+        auto const a3 = _mm_loadu_ps(a_columns + 12);
+
+        for(auto column = 0; column != 4; ++column)
+        {
+            auto const * b_column = b_columns + 4 * column;
+            auto result = _mm_mul_ps(a0, _mm_set1_ps(b_column[0]));
+            result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(b_column[1])));
+            result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(b_column[2])));
+            result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(b_column[3])));
+            _mm_storeu_ps(out_columns + 4 * column, result);
+        }
+#else
+        out = a * b;
+#endif
+    }
+
+    std::vector<std::uint32_t> m_parent;
+    std::vector<std::uint32_t> m_depth;
+    std::vector<glm::mat4> m_local;
+    std::vector<glm::mat4> m_world;
+    std::vector<std::uint8_t> m_dirty;
+    std::vector<std::uint8_t> m_recomputed;
+    std::vector<index_range> m_ranges;
+}; /* class transform_hierarchy */
+
+#endif /* SDL_WEBGPU_DEMO_TRANSFORM_HIERARCHY_HPP */
@@ -0,0 +1,215 @@
+#ifndef SDL_WEBGPU_DEMO_VERTEX_ENCODING_HPP
+#define SDL_WEBGPU_DEMO_VERTEX_ENCODING_HPP
+
+#include <webgpu/webgpu.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/*
+ * Morph target positions can be stored as plain Float32x3, one buffer per
+ * target, or compressed to 8 bytes per position. The compressed encodings
+ * interleave the source and destination target of a morph pair in a single
+ * buffer, so a draw fetches one 16 byte vertex from one buffer instead of
+ * two 12 byte vertices from two buffers.
+ *
+ * Snorm16 positions are relative to a per mesh bounding box, described by
+ * the scale and bias the vertex shader applies after fetching.
+ */
+enum class vertex_encoding
+{
+    float32x3,
+    snorm16x4,
+    float16x4
+};
+
+constexpr char const * vertex_encoding_name(vertex_encoding encoding)
+{
+    switch(encoding)
+    {
+        case vertex_encoding::float32x3: return "float32";
+        case vertex_encoding::snorm16x4: return "snorm16";
+        case vertex_encoding::float16x4: return "float16";
+    }
+
+    return "unknown";
+}
+
+inline bool parse_vertex_encoding(std::string_view name, vertex_encoding & encoding)
+{
+    for(auto const candidate:
+        { vertex_encoding::float32x3, vertex_encoding::snorm16x4, vertex_encoding::float16x4 })
+    {
+        if(name == vertex_encoding_name(candidate))
+        {
+            encoding = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+constexpr bool is_interleaved(vertex_encoding encoding)
+{
+    return encoding != vertex_encoding::float32x3;
+}
+
+constexpr WGPUVertexFormat vertex_format(vertex_encoding encoding)
+{
+    switch(encoding)
+    {
+        case vertex_encoding::snorm16x4: return WGPUVertexFormat_Snorm16x4;
+        case vertex_encoding::float16x4: return WGPUVertexFormat_Float16x4;
+        case vertex_encoding::float32x3: break;
+    }
+
+    return WGPUVertexFormat_Float32x3;
+}
+
+/* Size of one encoded position */
+constexpr std::uint64_t position_size(vertex_encoding encoding)
+{
+    return is_interleaved(encoding) ? 4u * sizeof(std::uint16_t) : 3u * sizeof(float);
+}
+
+/* Distance between consecutive vertices in an encoded vertex buffer */
+constexpr std::uint64_t vertex_stride(vertex_encoding encoding)
+{
+    return is_interleaved(encoding) ? 2u * position_size(encoding) : position_size(encoding);
+}
+
+struct position_quantization
+{
+    glm::vec4 scale{1.0f, 1.0f, 1.0f, 0.0f};
+    glm::vec4 bias{0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+/* Bounding box of every target of a mesh, used for Snorm16 positions */
+inline position_quantization compute_quantization(
+    vertex_encoding encoding, std::span<std::span<glm::vec3 const> const> targets)
+{
+    if(encoding != vertex_encoding::snorm16x4 || targets.empty() || targets[0].empty())
+    {
+        return {};
+    }
+
+    auto low = targets[0][0];
+    auto high = targets[0][0];
+
+    for(auto const target: targets)
+    {
+        for(auto const & p: target)
+        {
+            low = glm::min(low, p);
+            high = glm::max(high, p);
+        }
+    }
+
+    auto const center = (low + high) * 0.5f;
+    auto half_extent = (high - low) * 0.5f;
+
+    for(auto i = 0; i != 3; ++i)
+    {
+        if(half_extent[i] <= 0.0f)
+        {
+            half_extent[i] = 1.0f;
+        }
+    }
+
+    return
+    {
+        .scale = glm::vec4{half_extent, 0.0f},
+        .bias = glm::vec4{center, 0.0f}
+    };
+}
+
+/*
+ * Encodes a morph pair as interleaved [source, destination] positions in
+ * the given compressed encoding.
+ */
+inline std::vector<std::uint8_t> encode_morph_pair(
+    vertex_encoding encoding,
+    position_quantization const & quantization,
+    std::span<glm::vec3 const> source,
+    std::span<glm::vec3 const> destination)
+{
+    auto const stride = vertex_stride(encoding);
+    auto result = std::vector<std::uint8_t>(source.size() * stride);
+
+    auto const encode = [&](glm::vec3 const & p, std::uint8_t * out)
+    {
+        std::uint16_t packed[4] = { 0u, 0u, 0u, 0u };
+
+        for(auto i = 0; i != 3; ++i)
+        {
+            if(encoding == vertex_encoding::snorm16x4)
+            {
+                auto const n = glm::clamp(
+                    (p[i] - quantization.bias[i]) / quantization.scale[i],
+                    -1.0f, 1.0f);
+                packed[i] = static_cast<std::uint16_t>(
+                    static_cast<std::int16_t>(std::lround(n * 32767.0f)));
+            }
+            else
+            {
+                packed[i] = glm::packHalf1x16(p[i]);
+            }
+        }
+
+        std::memcpy(out, packed, sizeof(packed));
+    };
+
+    for(auto i = std::size_t{0}; i != source.size(); ++i)
+    {
+        auto * vertex = result.data() + i * stride;
+        encode(source[i], vertex);
+        encode(destination[i], vertex + position_size(encoding));
+    }
+
+    return result;
+}
+
+/*
+ * How morph targets reach the vertex shader: either as a pair of targets in
+ * vertex buffers, lerped by a single factor, or all targets of a mesh in one
+ * storage buffer, blended with a per instance weight vector.
+ */
+enum class morph_mode
+{
+    pairwise,
+    blend
+};
+
+constexpr char const * morph_mode_name(morph_mode mode)
+{
+    switch(mode)
+    {
+        case morph_mode::pairwise: return "pairwise";
+        case morph_mode::blend: return "blend";
+    }
+
+    return "unknown";
+}
+
+inline bool parse_morph_mode(std::string_view name, morph_mode & mode)
+{
+    for(auto const candidate: { morph_mode::pairwise, morph_mode::blend })
+    {
+        if(name == morph_mode_name(candidate))
+        {
+            mode = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif /* SDL_WEBGPU_DEMO_VERTEX_ENCODING_HPP */
@@ -0,0 +1,186 @@
+#ifndef SDL_WEBGPU_DEMO_WGPU_SYNC_HPP
+#define SDL_WEBGPU_DEMO_WGPU_SYNC_HPP
+
+#include "trace.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+/*
+ * Blocking wrappers around the asynchronous WebGPU requests. A failed
+ * request returns null and writes the implementation's reason to stderr.
+ */
+inline WGPUAdapter request_adapter(
+    WGPUInstance instance, WGPURequestAdapterOptions const & opts)
+{
+    struct user_data_t
+    {
+        WGPUAdapter adapter = nullptr;
+        bool request_complete = false;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    user_data_t user_data;
+    
+    auto const request_callback = [](
+        WGPURequestAdapterStatus status,
+        WGPUAdapter adapter,
+        char const * message,
+        void * p_user_data)
+    {
+        WEBGPU_SDL_TRACE_SCOPE("adapter request callback");
+        user_data_t * user_data =
+            reinterpret_cast<user_data_t *>(p_user_data);
+        std::unique_lock<std::mutex> lock{user_data->mutex};
+
+        if(status == WGPURequestAdapterStatus_Success)
+        {
+            user_data->adapter = adapter;
+        }
+        else
+        {
+            std::cerr <<
+                "wgpuInstanceRequestAdapter failed(" << static_cast<int>(status) << "): " <<
+                (message ? message : "no message") << std::endl;
+        }
+
+        user_data->request_complete = true;
+        lock.unlock();
+        user_data->cv.notify_all();
+    };
+
+    wgpuInstanceRequestAdapter(
+        instance, &opts, request_callback, &user_data);
+
+    std::unique_lock<std::mutex> lock{user_data.mutex};
+    user_data.cv.wait(lock, [&user_data] { return user_data.request_complete; });
+
+    return user_data.adapter;
+}
+
+inline WGPUDevice request_device(
+    WGPUAdapter adapter, WGPUDeviceDescriptor const & desc)
+{
+    struct user_data_t
+    {
+        WGPUDevice device = nullptr;
+        bool request_complete = false;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    user_data_t user_data;
+
+    auto const request_callback = [](
+        WGPURequestDeviceStatus status,
+        WGPUDevice device,
+        char const * message,
+        void * p_user_data)
+    {
+        WEBGPU_SDL_TRACE_SCOPE("device request callback");
+        user_data_t * user_data = reinterpret_cast<user_data_t *>(p_user_data);
+        std::unique_lock<std::mutex> lock{user_data->mutex};
+
+        if(status == WGPURequestDeviceStatus_Success)
+        {
+            user_data->device = device;
+        }
+        else
+        {
+            std::cerr <<
+                "wgpuAdapterRequestDevice failed(" << static_cast<int>(status) << "): " <<
+                (message ? message : "no message") << std::endl;
+        }
+
+        user_data->request_complete = true;
+        lock.unlock();
+        user_data->cv.notify_all();
+    };
+
+    wgpuAdapterRequestDevice(
+        adapter, &desc, request_callback, &user_data);
+
+    std::unique_lock<std::mutex> lock{user_data.mutex};
+    user_data.cv.wait(lock, [&user_data] { return user_data.request_complete; });
+
+    return user_data.device;
+}
+
+/*
+ * Blocks until all work submitted to the queue so far has completed. The
+ * device is ticked while waiting so that the callback gets delivered.
+ */
+inline bool wait_for_submitted_work(WGPUDevice device, WGPUQueue queue)
+{
+    struct user_data_t
+    {
+        std::atomic<bool> complete = false;
+        WGPUQueueWorkDoneStatus status = WGPUQueueWorkDoneStatus_Unknown;
+    };
+
+    user_data_t user_data;
+
+    auto const done_callback = [](
+        WGPUQueueWorkDoneStatus status, void * p_user_data)
+    {
+        WEBGPU_SDL_TRACE_SCOPE("work done callback");
+        auto * user_data = reinterpret_cast<user_data_t *>(p_user_data);
+        user_data->status = status;
+        user_data->complete.store(true, std::memory_order_release);
+    };
+
+    wgpuQueueOnSubmittedWorkDone(queue, 0u, done_callback, &user_data);
+
+    while(!user_data.complete.load(std::memory_order_acquire))
+    {
+        wgpuDeviceTick(device);
+        std::this_thread::yield();
+    }
+
+    return user_data.status == WGPUQueueWorkDoneStatus_Success;
+}
+
+/*
+ * Pops the innermost error scope and blocks until its result arrives. The
+ * device is ticked while waiting so that the callback gets delivered.
+ */
+inline WGPUErrorType pop_error_scope(WGPUDevice device)
+{
+    struct user_data_t
+    {
+        std::atomic<bool> complete = false;
+        WGPUErrorType type = WGPUErrorType_Unknown;
+    };
+
+    user_data_t user_data;
+
+    auto const error_callback = [](
+        WGPUErrorType type, char const * message, void * p_user_data)
+    {
+        (void)message;
+        auto * user_data = reinterpret_cast<user_data_t *>(p_user_data);
+        user_data->type = type;
+        user_data->complete.store(true, std::memory_order_release);
+    };
+
+    if(!wgpuDevicePopErrorScope(device, error_callback, &user_data))
+    {
+        return WGPUErrorType_Unknown;
+    }
+
+    while(!user_data.complete.load(std::memory_order_acquire))
+    {
+        wgpuDeviceTick(device);
+        std::this_thread::yield();
+    }
+
+    return user_data.type;
+}
+
+#endif /* SDL_WEBGPU_DEMO_WGPU_SYNC_HPP */
@@ -0,0 +1,19 @@
+#include "SDL_webgpu.h"
+
+/*
+ * SDL_Webgpu_CreateSurface for the mock backend. The mock presents
+ * nowhere, so the surface needs no native window, e.g. under SDL's dummy
+ * video driver.
+ */
+WGPUSurface SDL_Webgpu_CreateSurface(
+    SDL_Window * window, WGPUInstance instance)
+{
+    (void)window;
+
+    WGPUSurfaceDescriptor const surface_descriptor = {
+        .nextInChain = NULL,
+        .label = "MockSurface",
+    };
+
+    return wgpuInstanceCreateSurface(instance, &surface_descriptor);
+}
@@ -0,0 +1,72 @@
+#ifndef SDL_WEBGPU_MOCK_HPP
+#define SDL_WEBGPU_MOCK_HPP
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/*
+ * Recording stand-in for a WebGPU implementation. It defines the webgpu.h
+ * entry points used by SDL_webgpu and the demo, creates plain CPU side
+ * objects and counts every call, so the CPU cost of a frame can be checked
+ * on machines without a GPU.
+ *
+ * Requesting an adapter or device and getting shader compilation info
+ * complete immediately. Buffer maps and submitted work done callbacks are
+ * delivered by wgpuDeviceTick, as with Dawn. Buffers keep their contents,
+ * so data written by the queue or through a mapping reads back unchanged.
+ *
+ * Bytes written are the bytes handed over by wgpuQueueWriteBuffer and
+ * wgpuQueueWriteTexture, and the size of a write mapping when it is unmapped.
+ *
+ * WGSL is checked for reserved words used as identifiers and for unpaired
+ * brackets. Problems show up as compilation info errors and as a
+ * validation error of the device.
+ *
+ * Errors go to the innermost matching error scope, whose result is
+ * delivered by wgpuDeviceTick, or else to the uncaptured error callback.
+ * Surfaces support the Fifo and Immediate present modes, not Mailbox.
+ */
+namespace webgpu_mock
+{
+struct call_record
+{
+    std::string function;
+    std::string arguments;
+    std::uint64_t bytes_written;
+};
+
+struct statistics
+{
+    std::uint64_t calls = 0u;
+    std::uint64_t bytes_written = 0u;
+    std::map<std::string, std::uint64_t> calls_by_function;
+};
+
+/* Counters since start or the last reset() */
+statistics snapshot();
+
+/* What happened between two snapshots */
+statistics difference(statistics const & later, statistics const & earlier);
+
+/* Keeps every call with its arguments; off by default */
+void set_call_log(bool enabled);
+
+std::vector<call_record> call_log();
+
+/* Clears the counters and the call log; objects stay alive */
+void reset();
+
+void report(std::ostream & out, statistics const & stats);
+
+/* Reads statistics back from what report() wrote, e.g. a stored baseline */
+statistics parse_report(std::istream & in);
+
+/* Writes every count that differs from the baseline; false if none does */
+bool report_drift(std::ostream & out, statistics const & expected, statistics const & actual);
+} /* namespace webgpu_mock */
+
+#endif /* SDL_WEBGPU_MOCK_HPP */
@@ -0,0 +1,1496 @@
+#include "webgpu_mock.hpp"
+
+#include <webgpu/webgpu.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace
+{
+/*
+ * Common part of every mock object. Objects are numbered in creation
+ * order, which keeps the call log identical from run to run.
+ */
+struct mock_object
+{
+    explicit mock_object(char const * object_kind) :
+        kind(object_kind),
+        id(next_id.fetch_add(1u, std::memory_order_relaxed))
+    {
+    }
+
+    virtual ~mock_object() = default;
+
+    mock_object(mock_object const &) = delete;
+    mock_object & operator=(mock_object const &) = delete;
+
+    void add_reference()
+    {
+        references.fetch_add(1u, std::memory_order_relaxed);
+    }
+
+    char const * kind;
+    std::uint64_t id;
+    std::atomic<std::uint32_t> references = 1u;
+
+    static inline std::atomic<std::uint64_t> next_id = 1u;
+};
+
+void release_object(mock_object * object)
+{
+    if(object && object->references.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+    {
+        delete object;
+    }
+}
+
+struct recorder_t
+{
+    std::mutex mutex;
+    webgpu_mock::statistics stats;
+    bool log_enabled = false;
+    std::vector<webgpu_mock::call_record> log;
+};
+
+recorder_t & recorder()
+{
+    static recorder_t instance;
+    return instance;
+}
+
+template <typename T>
+void format_argument(std::ostream & out, T const & value)
+{
+    using object_t = std::remove_cv_t<std::remove_pointer_t<T>>;
+
+    if constexpr(std::is_same_v<T, char const *> || std::is_same_v<T, char *>)
+    {
+        if(value)
+        {
+            out << '"' << value << '"';
+        }
+        else
+        {
+            out << "null";
+        }
+    }
+    else if constexpr(std::is_pointer_v<T> && std::is_base_of_v<mock_object, object_t>)
+    {
+        if(value)
+        {
+            out << value->kind << '#' << value->id;
+        }
+        else
+        {
+            out << "null";
+        }
+    }
+    else if constexpr(std::is_pointer_v<T> || std::is_null_pointer_v<T>)
+    {
+        // Addresses change from run to run, only presence is recorded
+        out << (value ? "ptr" : "null");
+    }
+    else if constexpr(std::is_enum_v<T>)
+    {
+        out << static_cast<std::underlying_type_t<T>>(value);
+    }
+    else if constexpr(std::is_same_v<T, bool>)
+    {
+        out << (value ? "true" : "false");
+    }
+    else
+    {
+        out << value;
+    }
+}
+
+template <typename... Args>
+void record(char const * function, std::uint64_t bytes_written, Args const &... args)
+{
+    auto & state = recorder();
+    std::lock_guard<std::mutex> lock{state.mutex};
+
+    ++state.stats.calls;
+    state.stats.bytes_written += bytes_written;
+    ++state.stats.calls_by_function[function];
+
+    if(!state.log_enabled)
+    {
+        return;
+    }
+
+    std::ostringstream arguments;
+    auto first = true;
+    ((arguments << (first ? "" : ", "), format_argument(arguments, args), first = false), ...);
+
+    state.log.push_back(
+        webgpu_mock::call_record
+        {
+            .function = function,
+            .arguments = arguments.str(),
+            .bytes_written = bytes_written
+        });
+}
+
+template <typename Descriptor>
+char const * label_of(Descriptor const * descriptor)
+{
+    return descriptor ? descriptor->label : nullptr;
+}
+
+/* Callbacks that a real implementation delivers later, run by wgpuDeviceTick */
+struct pending_t
+{
+    std::mutex mutex;
+    std::vector<std::function<void()>> callbacks;
+};
+
+pending_t & pending()
+{
+    static pending_t instance;
+    return instance;
+}
+
+void defer(std::function<void()> callback)
+{
+    auto & queue = pending();
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.callbacks.push_back(std::move(callback));
+}
+
+WGPULimits mock_limits()
+{
+    return WGPULimits
+    {
+        .maxTextureDimension1D = 16384u,
+        .maxTextureDimension2D = 16384u,
+        .maxTextureDimension3D = 2048u,
+        .maxTextureArrayLayers = 2048u,
+        .maxBindGroups = 4u,
+        .maxBindGroupsPlusVertexBuffers = 24u,
+        .maxBindingsPerBindGroup = 1000u,
+        .maxDynamicUniformBuffersPerPipelineLayout = 8u,
+        .maxDynamicStorageBuffersPerPipelineLayout = 4u,
+        .maxSampledTexturesPerShaderStage = 16u,
+        .maxSamplersPerShaderStage = 16u,
+        .maxStorageBuffersPerShaderStage = 8u,
+        .maxStorageTexturesPerShaderStage = 4u,
+        .maxUniformBuffersPerShaderStage = 12u,
+        .maxUniformBufferBindingSize = 65536u,
+        .maxStorageBufferBindingSize = 128u << 20u,
+        .minUniformBufferOffsetAlignment = 256u,
+        .minStorageBufferOffsetAlignment = 256u,
+        .maxVertexBuffers = 8u,
+        .maxBufferSize = 256u << 20u,
+        .maxVertexAttributes = 16u,
+        .maxVertexBufferArrayStride = 2048u,
+        .maxInterStageShaderComponents = 60u,
+        .maxInterStageShaderVariables = 16u,
+        .maxColorAttachments = 8u,
+        .maxColorAttachmentBytesPerSample = 32u,
+        .maxComputeWorkgroupStorageSize = 16384u,
+        .maxComputeInvocationsPerWorkgroup = 256u,
+        .maxComputeWorkgroupSizeX = 256u,
+        .maxComputeWorkgroupSizeY = 256u,
+        .maxComputeWorkgroupSizeZ = 64u,
+        .maxComputeWorkgroupsPerDimension = 65535u
+    };
+}
+struct wgsl_error
+{
+    std::string message;
+    std::uint64_t line;
+    std::uint64_t column;
+    std::uint64_t offset;
+};
+
+/*
+ * Not a WGSL compiler, only the mistakes a real one rejects that slip
+ * through review most easily: identifiers that are reserved words, and
+ * brackets that don't pair up.
+ */
+std::vector<wgsl_error> check_wgsl(std::string_view code)
+{
+    // Sorted, from the reserved words of the WGSL specification
+    static constexpr std::string_view reserved_words[]
+    {
+        "NULL", "Self", "abstract", "active", "alignas", "alignof", "as", "asm",
+        "asm_fragment", "async", "attribute", "auto", "await", "become",
+        "binding_array", "cast", "catch", "class", "co_await", "co_return",
+        "co_yield", "coherent", "column_major", "common", "compile",
+        "compile_fragment", "concept", "const_cast", "consteval", "constexpr",
+        "constinit", "crate", "debugger", "decltype", "delete", "demote",
+        "demote_to_helper", "do", "dynamic_cast", "enum", "explicit", "export",
+        "extends", "extern", "external", "fallthrough", "filter", "final",
+        "finally", "friend", "from", "fxgroup", "get", "goto", "groupshared",
+        "highp", "impl", "implements", "import", "inline", "instanceof",
+        "interface", "layout", "lowp", "macro", "macro_rules", "match",
+        "mediump", "meta", "mod", "module", "move", "mut", "mutable",
+        "namespace", "new", "nil", "noexcept", "noinline", "nointerpolation",
+        "noperspective", "null", "nullptr", "of", "operator", "package",
+        "packoffset", "partition", "pass", "patch", "pixelfragment", "precise",
+        "precision", "premerge", "priv", "protected", "pub", "public",
+        "readonly", "ref", "regardless", "register", "reinterpret_cast",
+        "require", "resource", "restrict", "self", "set", "shared", "sizeof",
+        "smooth", "snorm", "static", "static_assert", "static_cast", "std",
+        "subroutine", "super", "target", "template", "this", "thread_local",
+        "throw", "trait", "try", "type", "typedef", "typeid", "typename",
+        "typeof", "union", "unless", "unorm", "unsafe", "unsized", "use",
+        "using", "varying", "virtual", "volatile", "wgsl", "where", "with",
+        "writeonly", "yield"
+    };
+
+    auto const is_word_start = [](char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    };
+    auto const is_word = [&is_word_start](char c)
+    {
+        return is_word_start(c) || (c >= '0' && c <= '9');
+    };
+
+    auto errors = std::vector<wgsl_error>{};
+    auto open_brackets = std::vector<wgsl_error>{};
+    auto line = std::uint64_t{1};
+    auto line_start = std::size_t{0};
+
+    auto const error_at = [&](std::size_t offset, std::string message)
+    {
+        return wgsl_error
+        {
+            .message = std::move(message),
+            .line = line,
+            .column = offset - line_start + 1u,
+            .offset = offset
+        };
+    };
+
+    auto i = std::size_t{0};
+    while(i < code.size())
+    {
+        auto const c = code[i];
+
+        if(c == '\n')
+        {
+            ++line;
+            line_start = ++i;
+        }
+        else if(code.substr(i, 2) == "//")
+        {
+            i = std::min(code.find('\n', i), code.size());
+        }
+        else if(code.substr(i, 2) == "/*")
+        {
+            // Block comments nest in WGSL
+            auto depth = 0u;
+            do
+            {
+                if(code.substr(i, 2) == "/*")
+                {
+                    ++depth;
+                    i += 2u;
+                }
+                else if(code.substr(i, 2) == "*/")
+                {
+                    --depth;
+                    i += 2u;
+                }
+                else
+                {
+                    if(code[i] == '\n')
+                    {
+                        ++line;
+                        line_start = i + 1u;
+                    }
+                    ++i;
+                }
+            }
+            while(depth != 0u && i < code.size());
+        }
+        else if(is_word_start(c))
+        {
+            auto const begin = i;
+            while(i < code.size() && is_word(code[i]))
+            {
+                ++i;
+            }
+
+            auto const word = code.substr(begin, i - begin);
+            if(std::binary_search(std::begin(reserved_words), std::end(reserved_words), word))
+            {
+                errors.push_back(error_at(
+                    begin, "'" + std::string{word} + "' is a reserved word"));
+            }
+        }
+        else if(c >= '0' && c <= '9')
+        {
+            // Literals with their suffixes, e.g. 0x1Fu or 1e-3f
+            while(i < code.size() && (is_word(code[i]) || code[i] == '.'))
+            {
+                ++i;
+            }
+        }
+        else if(c == '(' || c == '[' || c == '{')
+        {
+            open_brackets.push_back(error_at(i, std::string{"unclosed '"} + c + "'"));
+            ++i;
+        }
+        else if(c == ')' || c == ']' || c == '}')
+        {
+            auto const opening = c == ')' ? '(' : c == ']' ? '[' : '{';
+            if(open_brackets.empty() ||
+                code[open_brackets.back().offset] != opening)
+            {
+                errors.push_back(error_at(i, std::string{"unmatched '"} + c + "'"));
+                return errors;
+            }
+
+            open_brackets.pop_back();
+            ++i;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    errors.insert(errors.end(), open_brackets.begin(), open_brackets.end());
+    return errors;
+}
+} /* namespace */
+
+struct WGPUInstanceImpl : mock_object
+{
+    WGPUInstanceImpl() : mock_object{"Instance"} {}
+};
+
+struct WGPUAdapterImpl : mock_object
+{
+    WGPUAdapterImpl() : mock_object{"Adapter"} {}
+};
+
+struct WGPUSurfaceImpl : mock_object
+{
+    WGPUSurfaceImpl() : mock_object{"Surface"} {}
+};
+
+struct WGPUQueueImpl : mock_object
+{
+    WGPUQueueImpl() : mock_object{"Queue"} {}
+};
+
+struct error_scope
+{
+    WGPUErrorFilter filter;
+    WGPUErrorType type = WGPUErrorType_NoError;
+    std::string message;
+};
+
+struct WGPUDeviceImpl : mock_object
+{
+    WGPUDeviceImpl() : mock_object{"Device"} {}
+
+    ~WGPUDeviceImpl() override
+    {
+        if(lost_callback && !lost)
+        {
+            lost_callback(WGPUDeviceLostReason_Destroyed, "Device destroyed", lost_user_data);
+        }
+
+        release_object(queue);
+    }
+
+    WGPUQueue queue = new WGPUQueueImpl;
+    std::vector<WGPUFeatureName> features;
+    WGPUErrorCallback error_callback = nullptr;
+    void * error_user_data = nullptr;
+    WGPUDeviceLostCallback lost_callback = nullptr;
+    void * lost_user_data = nullptr;
+    bool lost = false;
+    std::vector<error_scope> error_scopes;
+};
+
+/* Hands an error to the innermost matching error scope, else reports it as uncaptured */
+void raise_error(WGPUDevice device, WGPUErrorType type, std::string const & message)
+{
+    auto const filter =
+        type == WGPUErrorType_OutOfMemory ? WGPUErrorFilter_OutOfMemory :
+        type == WGPUErrorType_Validation ? WGPUErrorFilter_Validation :
+        WGPUErrorFilter_Internal;
+
+    for(auto scope = device->error_scopes.rbegin(); scope != device->error_scopes.rend(); ++scope)
+    {
+        if(scope->filter == filter)
+        {
+            // Only the first error of a scope is kept
+            if(scope->type == WGPUErrorType_NoError)
+            {
+                scope->type = type;
+                scope->message = message;
+            }
+            return;
+        }
+    }
+
+    if(device->error_callback)
+    {
+        device->error_callback(type, message.c_str(), device->error_user_data);
+    }
+}
+
+struct WGPUBufferImpl : mock_object
+{
+    WGPUBufferImpl() : mock_object{"Buffer"} {}
+
+    std::vector<std::uint8_t> contents;
+    bool mapped = false;
+    bool write_mapped = false;
+    std::size_t map_offset = 0u;
+    std::size_t map_size = 0u;
+    WGPUMapModeFlags map_mode = WGPUMapMode_None;
+    WGPUBufferMapCallback map_callback = nullptr;
+    void * map_user_data = nullptr;
+};
+
+struct WGPUTextureImpl : mock_object
+{
+    WGPUTextureImpl() : mock_object{"Texture"} {}
+};
+
+struct WGPUTextureViewImpl : mock_object
+{
+    WGPUTextureViewImpl() : mock_object{"TextureView"} {}
+};
+
+struct WGPUSamplerImpl : mock_object
+{
+    WGPUSamplerImpl() : mock_object{"Sampler"} {}
+};
+
+struct WGPUBindGroupLayoutImpl : mock_object
+{
+    WGPUBindGroupLayoutImpl() : mock_object{"BindGroupLayout"} {}
+};
+
+struct WGPUBindGroupImpl : mock_object
+{
+    WGPUBindGroupImpl() : mock_object{"BindGroup"} {}
+};
+
+struct WGPUPipelineLayoutImpl : mock_object
+{
+    WGPUPipelineLayoutImpl() : mock_object{"PipelineLayout"} {}
+};
+
+struct WGPUShaderModuleImpl : mock_object
+{
+    WGPUShaderModuleImpl() : mock_object{"ShaderModule"} {}
+
+    std::vector<wgsl_error> errors;
+};
+
+struct WGPURenderPipelineImpl : mock_object
+{
+    WGPURenderPipelineImpl() : mock_object{"RenderPipeline"} {}
+};
+
+struct WGPUComputePipelineImpl : mock_object
+{
+    WGPUComputePipelineImpl() : mock_object{"ComputePipeline"} {}
+};
+
+struct WGPUQuerySetImpl : mock_object
+{
+    WGPUQuerySetImpl() : mock_object{"QuerySet"} {}
+
+    WGPUQueryType type = WGPUQueryType_Timestamp;
+};
+
+struct WGPUCommandEncoderImpl : mock_object
+{
+    WGPUCommandEncoderImpl() : mock_object{"CommandEncoder"} {}
+};
+
+struct WGPUCommandBufferImpl : mock_object
+{
+    WGPUCommandBufferImpl() : mock_object{"CommandBuffer"} {}
+};
+
+struct WGPUComputePassEncoderImpl : mock_object
+{
+    WGPUComputePassEncoderImpl() : mock_object{"ComputePassEncoder"} {}
+};
+
+struct WGPURenderPassEncoderImpl : mock_object
+{
+    WGPURenderPassEncoderImpl() : mock_object{"RenderPassEncoder"} {}
+};
+
+struct WGPUSwapChainImpl : mock_object
+{
+    WGPUSwapChainImpl() : mock_object{"SwapChain"} {}
+};
+
+namespace
+{
+void finish_map(WGPUBuffer buffer, WGPUBufferMapAsyncStatus status)
+{
+    auto const callback = std::exchange(buffer->map_callback, nullptr);
+    if(!callback)
+    {
+        return;
+    }
+
+    if(status == WGPUBufferMapAsyncStatus_Success)
+    {
+        buffer->mapped = true;
+        buffer->write_mapped = (buffer->map_mode & WGPUMapMode_Write) != 0;
+    }
+
+    callback(status, buffer->map_user_data);
+}
+
+/* The part of a mapped buffer that offset and size refer to, or null */
+std::uint8_t * mapped_range(WGPUBuffer buffer, std::size_t offset, std::size_t size)
+{
+    if(!buffer || !buffer->mapped || offset < buffer->map_offset)
+    {
+        return nullptr;
+    }
+
+    auto const map_end = buffer->map_offset + buffer->map_size;
+    if(size == WGPU_WHOLE_MAP_SIZE)
+    {
+        size = map_end - std::min(offset, map_end);
+    }
+
+    if(offset > map_end || size > map_end - offset)
+    {
+        return nullptr;
+    }
+
+    return buffer->contents.data() + offset;
+}
+} /* namespace */
+
+#define WEBGPU_MOCK_RELEASE(TYPE) \
+    void wgpu##TYPE##Release(WGPU##TYPE object) \
+    { \
+        record("wgpu" #TYPE "Release", 0u, object); \
+        release_object(object); \
+    }
+
+WEBGPU_MOCK_RELEASE(Adapter)
+WEBGPU_MOCK_RELEASE(BindGroup)
+WEBGPU_MOCK_RELEASE(BindGroupLayout)
+WEBGPU_MOCK_RELEASE(Buffer)
+WEBGPU_MOCK_RELEASE(CommandBuffer)
+WEBGPU_MOCK_RELEASE(CommandEncoder)
+WEBGPU_MOCK_RELEASE(ComputePassEncoder)
+WEBGPU_MOCK_RELEASE(ComputePipeline)
+WEBGPU_MOCK_RELEASE(Device)
+WEBGPU_MOCK_RELEASE(Instance)
+WEBGPU_MOCK_RELEASE(PipelineLayout)
+WEBGPU_MOCK_RELEASE(QuerySet)
+WEBGPU_MOCK_RELEASE(Queue)
+WEBGPU_MOCK_RELEASE(RenderPassEncoder)
+WEBGPU_MOCK_RELEASE(RenderPipeline)
+WEBGPU_MOCK_RELEASE(Sampler)
+WEBGPU_MOCK_RELEASE(ShaderModule)
+WEBGPU_MOCK_RELEASE(Surface)
+WEBGPU_MOCK_RELEASE(SwapChain)
+WEBGPU_MOCK_RELEASE(Texture)
+WEBGPU_MOCK_RELEASE(TextureView)
+
+#undef WEBGPU_MOCK_RELEASE
+
+WGPUInstance wgpuCreateInstance(WGPUInstanceDescriptor const * descriptor)
+{
+    record("wgpuCreateInstance", 0u, descriptor);
+    return new WGPUInstanceImpl;
+}
+
+WGPUSurface wgpuInstanceCreateSurface(
+    WGPUInstance instance, WGPUSurfaceDescriptor const * descriptor)
+{
+    record("wgpuInstanceCreateSurface", 0u, instance, label_of(descriptor));
+    return new WGPUSurfaceImpl;
+}
+
+WGPUTextureFormat wgpuSurfaceGetPreferredFormat(WGPUSurface surface, WGPUAdapter adapter)
+{
+    record("wgpuSurfaceGetPreferredFormat", 0u, surface, adapter);
+    return WGPUTextureFormat_BGRA8Unorm;
+}
+
+void wgpuInstanceRequestAdapter(
+    WGPUInstance instance,
+    WGPURequestAdapterOptions const * options,
+    WGPURequestAdapterCallback callback,
+    void * userdata)
+{
+    record("wgpuInstanceRequestAdapter", 0u, instance, options);
+    callback(WGPURequestAdapterStatus_Success, new WGPUAdapterImpl, nullptr, userdata);
+}
+
+size_t wgpuAdapterEnumerateFeatures(WGPUAdapter adapter, WGPUFeatureName * features)
+{
+    record("wgpuAdapterEnumerateFeatures", 0u, adapter, features);
+    return 0u;
+}
+
+bool wgpuAdapterGetLimits(WGPUAdapter adapter, WGPUSupportedLimits * limits)
+{
+    record("wgpuAdapterGetLimits", 0u, adapter);
+    limits->limits = mock_limits();
+    return true;
+}
+
+void wgpuAdapterGetProperties(WGPUAdapter adapter, WGPUAdapterProperties * properties)
+{
+    record("wgpuAdapterGetProperties", 0u, adapter);
+    properties->vendorID = 0u;
+    properties->vendorName = "webgpu-mock";
+    properties->architecture = "";
+    properties->deviceID = 0u;
+    properties->name = "Recording mock adapter";
+    properties->driverDescription = "";
+    properties->adapterType = WGPUAdapterType_CPU;
+    properties->backendType = WGPUBackendType_Null;
+    properties->compatibilityMode = false;
+}
+
+bool wgpuAdapterHasFeature(WGPUAdapter adapter, WGPUFeatureName feature)
+{
+    record("wgpuAdapterHasFeature", 0u, adapter, feature);
+    return false;
+}
+
+void wgpuAdapterRequestDevice(
+    WGPUAdapter adapter,
+    WGPUDeviceDescriptor const * descriptor,
+    WGPURequestDeviceCallback callback,
+    void * userdata)
+{
+    record("wgpuAdapterRequestDevice", 0u, adapter, label_of(descriptor));
+
+    auto const device = new WGPUDeviceImpl;
+    if(descriptor)
+    {
+        device->features.assign(
+            descriptor->requiredFeatures,
+            descriptor->requiredFeatures + descriptor->requiredFeaturesCount);
+        device->lost_callback = descriptor->deviceLostCallback;
+        device->lost_user_data = descriptor->deviceLostUserdata;
+    }
+
+    callback(WGPURequestDeviceStatus_Success, device, nullptr, userdata);
+}
+
+WGPUQueue wgpuDeviceGetQueue(WGPUDevice device)
+{
+    record("wgpuDeviceGetQueue", 0u, device);
+    device->queue->add_reference();
+    return device->queue;
+}
+
+bool wgpuDeviceHasFeature(WGPUDevice device, WGPUFeatureName feature)
+{
+    record("wgpuDeviceHasFeature", 0u, device, feature);
+    return std::find(device->features.begin(), device->features.end(), feature) !=
+        device->features.end();
+}
+
+void wgpuDeviceSetUncapturedErrorCallback(
+    WGPUDevice device, WGPUErrorCallback callback, void * userdata)
+{
+    record("wgpuDeviceSetUncapturedErrorCallback", 0u, device, callback);
+    device->error_callback = callback;
+    device->error_user_data = userdata;
+}
+
+void wgpuDeviceSetDeviceLostCallback(
+    WGPUDevice device, WGPUDeviceLostCallback callback, void * userdata)
+{
+    record("wgpuDeviceSetDeviceLostCallback", 0u, device, callback);
+    device->lost_callback = callback;
+    device->lost_user_data = userdata;
+}
+
+void wgpuDeviceForceLoss(WGPUDevice device, WGPUDeviceLostReason type, char const * message)
+{
+    record("wgpuDeviceForceLoss", 0u, device, type, message);
+
+    if(device->lost)
+    {
+        return;
+    }
+
+    device->lost = true;
+    if(auto const callback = std::exchange(device->lost_callback, nullptr))
+    {
+        callback(type, message, device->lost_user_data);
+    }
+}
+
+void wgpuDevicePushErrorScope(WGPUDevice device, WGPUErrorFilter filter)
+{
+    record("wgpuDevicePushErrorScope", 0u, device, filter);
+    device->error_scopes.push_back(error_scope{.filter = filter});
+}
+
+bool wgpuDevicePopErrorScope(WGPUDevice device, WGPUErrorCallback callback, void * userdata)
+{
+    record("wgpuDevicePopErrorScope", 0u, device, callback);
+
+    if(device->error_scopes.empty())
+    {
+        return false;
+    }
+
+    auto scope = std::move(device->error_scopes.back());
+    device->error_scopes.pop_back();
+
+    defer([callback, userdata, scope = std::move(scope)]
+    {
+        callback(scope.type, scope.message.c_str(), userdata);
+    });
+
+    return true;
+}
+
+void wgpuDeviceTick(WGPUDevice device)
+{
+    record("wgpuDeviceTick", 0u, device);
+
+    auto callbacks = std::vector<std::function<void()>>{};
+    {
+        auto & queue = pending();
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        callbacks.swap(queue.callbacks);
+    }
+
+    // Callbacks queued from inside a callback wait for the next tick
+    for(auto const & callback: callbacks)
+    {
+        callback();
+    }
+}
+
+WGPUBuffer wgpuDeviceCreateBuffer(WGPUDevice device, WGPUBufferDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateBuffer", 0u, device, descriptor->label,
+        descriptor->usage, descriptor->size, descriptor->mappedAtCreation);
+
+    auto const buffer = new WGPUBufferImpl;
+    buffer->contents.resize(static_cast<std::size_t>(descriptor->size));
+
+    if(descriptor->mappedAtCreation)
+    {
+        buffer->mapped = true;
+        buffer->write_mapped = true;
+        buffer->map_size = buffer->contents.size();
+    }
+
+    return buffer;
+}
+
+void wgpuBufferDestroy(WGPUBuffer buffer)
+{
+    record("wgpuBufferDestroy", 0u, buffer);
+    finish_map(buffer, WGPUBufferMapAsyncStatus_DestroyedBeforeCallback);
+    buffer->mapped = false;
+    buffer->write_mapped = false;
+}
+
+void const * wgpuBufferGetConstMappedRange(WGPUBuffer buffer, size_t offset, size_t size)
+{
+    record("wgpuBufferGetConstMappedRange", 0u, buffer, offset, size);
+    return mapped_range(buffer, offset, size);
+}
+
+void * wgpuBufferGetMappedRange(WGPUBuffer buffer, size_t offset, size_t size)
+{
+    record("wgpuBufferGetMappedRange", 0u, buffer, offset, size);
+    return mapped_range(buffer, offset, size);
+}
+
+void wgpuBufferMapAsync(
+    WGPUBuffer buffer,
+    WGPUMapModeFlags mode,
+    size_t offset,
+    size_t size,
+    WGPUBufferMapCallback callback,
+    void * userdata)
+{
+    record("wgpuBufferMapAsync", 0u, buffer, mode, offset, size);
+
+    if(buffer->mapped || buffer->map_callback)
+    {
+        defer([callback, userdata]
+        {
+            callback(WGPUBufferMapAsyncStatus_MappingAlreadyPending, userdata);
+        });
+        return;
+    }
+
+    if(size == WGPU_WHOLE_MAP_SIZE)
+    {
+        size = buffer->contents.size() - std::min(offset, buffer->contents.size());
+    }
+
+    buffer->map_mode = mode;
+    buffer->map_offset = offset;
+    buffer->map_size = size;
+    buffer->map_callback = callback;
+    buffer->map_user_data = userdata;
+
+    buffer->add_reference();
+    defer([buffer]
+    {
+        finish_map(buffer, WGPUBufferMapAsyncStatus_Success);
+        release_object(buffer);
+    });
+}
+
+void wgpuBufferUnmap(WGPUBuffer buffer)
+{
+    finish_map(buffer, WGPUBufferMapAsyncStatus_UnmappedBeforeCallback);
+
+    auto const bytes_written = buffer->write_mapped ? buffer->map_size : 0u;
+    record("wgpuBufferUnmap", bytes_written, buffer);
+
+    buffer->mapped = false;
+    buffer->write_mapped = false;
+}
+
+WGPUTexture wgpuDeviceCreateTexture(WGPUDevice device, WGPUTextureDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateTexture", 0u, device, descriptor->label,
+        descriptor->format, descriptor->size.width, descriptor->size.height,
+        descriptor->size.depthOrArrayLayers, descriptor->mipLevelCount);
+    return new WGPUTextureImpl;
+}
+
+void wgpuTextureDestroy(WGPUTexture texture)
+{
+    record("wgpuTextureDestroy", 0u, texture);
+}
+
+WGPUTextureView wgpuTextureCreateView(
+    WGPUTexture texture, WGPUTextureViewDescriptor const * descriptor)
+{
+    record("wgpuTextureCreateView", 0u, texture, label_of(descriptor));
+    return new WGPUTextureViewImpl;
+}
+
+WGPUSampler wgpuDeviceCreateSampler(WGPUDevice device, WGPUSamplerDescriptor const * descriptor)
+{
+    record("wgpuDeviceCreateSampler", 0u, device, label_of(descriptor));
+    return new WGPUSamplerImpl;
+}
+
+WGPUBindGroupLayout wgpuDeviceCreateBindGroupLayout(
+    WGPUDevice device, WGPUBindGroupLayoutDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateBindGroupLayout", 0u, device, descriptor->label,
+        descriptor->entryCount);
+    return new WGPUBindGroupLayoutImpl;
+}
+
+WGPUBindGroup wgpuDeviceCreateBindGroup(
+    WGPUDevice device, WGPUBindGroupDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateBindGroup", 0u, device, descriptor->label,
+        descriptor->layout, descriptor->entryCount);
+    return new WGPUBindGroupImpl;
+}
+
+WGPUPipelineLayout wgpuDeviceCreatePipelineLayout(
+    WGPUDevice device, WGPUPipelineLayoutDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreatePipelineLayout", 0u, device, descriptor->label,
+        descriptor->bindGroupLayoutCount);
+    return new WGPUPipelineLayoutImpl;
+}
+
+WGPUShaderModule wgpuDeviceCreateShaderModule(
+    WGPUDevice device, WGPUShaderModuleDescriptor const * descriptor)
+{
+    record("wgpuDeviceCreateShaderModule", 0u, device, descriptor->label);
+
+    auto * module = new WGPUShaderModuleImpl;
+
+    for(auto chain = descriptor->nextInChain; chain; chain = chain->next)
+    {
+        if(chain->sType == WGPUSType_ShaderModuleWGSLDescriptor)
+        {
+            auto const * wgsl = reinterpret_cast<WGPUShaderModuleWGSLDescriptor const *>(chain);
+            module->errors = check_wgsl(wgsl->code);
+        }
+    }
+
+    // Like Dawn, an invalid module is also a validation error of the device
+    if(!module->errors.empty())
+    {
+        auto const & error = module->errors.front();
+        raise_error(
+            device, WGPUErrorType_Validation,
+            "Invalid ShaderModule \"" + std::string{descriptor->label ? descriptor->label : ""} +
+            "\" at " + std::to_string(error.line) + ':' + std::to_string(error.column) +
+            ": " + error.message);
+    }
+
+    return module;
+}
+
+void wgpuShaderModuleGetCompilationInfo(
+    WGPUShaderModule shaderModule, WGPUCompilationInfoCallback callback, void * userdata)
+{
+    record("wgpuShaderModuleGetCompilationInfo", 0u, shaderModule);
+
+    auto messages = std::vector<WGPUCompilationMessage>{};
+    for(auto const & error: shaderModule->errors)
+    {
+        messages.push_back(
+            WGPUCompilationMessage
+            {
+                .nextInChain = nullptr,
+                .message = error.message.c_str(),
+                .type = WGPUCompilationMessageType_Error,
+                .lineNum = error.line,
+                .linePos = error.column,
+                .offset = error.offset,
+                .length = 0u,
+                .utf16LinePos = error.column,
+                .utf16Offset = error.offset,
+                .utf16Length = 0u
+            });
+    }
+
+    WGPUCompilationInfo const info =
+    {
+        .nextInChain = nullptr,
+        .messageCount = messages.size(),
+        .messages = messages.data()
+    };
+
+    callback(WGPUCompilationInfoRequestStatus_Success, &info, userdata);
+}
+
+WGPURenderPipeline wgpuDeviceCreateRenderPipeline(
+    WGPUDevice device, WGPURenderPipelineDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateRenderPipeline", 0u, device, descriptor->label,
+        descriptor->layout);
+    return new WGPURenderPipelineImpl;
+}
+
+void wgpuDeviceCreateRenderPipelineAsync(
+    WGPUDevice device,
+    WGPURenderPipelineDescriptor const * descriptor,
+    WGPUCreateRenderPipelineAsyncCallback callback,
+    void * userdata)
+{
+    record(
+        "wgpuDeviceCreateRenderPipelineAsync", 0u, device, descriptor->label,
+        descriptor->layout);
+    defer([callback, userdata]
+    {
+        callback(
+            WGPUCreatePipelineAsyncStatus_Success, new WGPURenderPipelineImpl,
+            nullptr, userdata);
+    });
+}
+
+WGPUComputePipeline wgpuDeviceCreateComputePipeline(
+    WGPUDevice device, WGPUComputePipelineDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateComputePipeline", 0u, device, descriptor->label,
+        descriptor->layout);
+    return new WGPUComputePipelineImpl;
+}
+
+WGPUBindGroupLayout wgpuRenderPipelineGetBindGroupLayout(
+    WGPURenderPipeline renderPipeline, uint32_t groupIndex)
+{
+    record("wgpuRenderPipelineGetBindGroupLayout", 0u, renderPipeline, groupIndex);
+    return new WGPUBindGroupLayoutImpl;
+}
+
+WGPUQuerySet wgpuDeviceCreateQuerySet(WGPUDevice device, WGPUQuerySetDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateQuerySet", 0u, device, descriptor->label,
+        descriptor->type, descriptor->count);
+    auto * query_set = new WGPUQuerySetImpl;
+    query_set->type = descriptor->type;
+    return query_set;
+}
+
+WGPUSwapChain wgpuDeviceCreateSwapChain(
+    WGPUDevice device, WGPUSurface surface, WGPUSwapChainDescriptor const * descriptor)
+{
+    record(
+        "wgpuDeviceCreateSwapChain", 0u, device, surface, descriptor->format,
+        descriptor->width, descriptor->height, descriptor->presentMode);
+
+    // Like a Vulkan surface without VK_PRESENT_MODE_MAILBOX_KHR; Dawn returns
+    // an error object in that case
+    if(descriptor->presentMode == WGPUPresentMode_Mailbox)
+    {
+        raise_error(
+            device, WGPUErrorType_Validation,
+            "Present mode Mailbox is not supported by the surface");
+    }
+
+    return new WGPUSwapChainImpl;
+}
+
+WGPUTextureView wgpuSwapChainGetCurrentTextureView(WGPUSwapChain swapChain)
+{
+    record("wgpuSwapChainGetCurrentTextureView", 0u, swapChain);
+    return new WGPUTextureViewImpl;
+}
+
+void wgpuSwapChainPresent(WGPUSwapChain swapChain)
+{
+    record("wgpuSwapChainPresent", 0u, swapChain);
+}
+
+WGPUCommandEncoder wgpuDeviceCreateCommandEncoder(
+    WGPUDevice device, WGPUCommandEncoderDescriptor const * descriptor)
+{
+    record("wgpuDeviceCreateCommandEncoder", 0u, device, label_of(descriptor));
+    return new WGPUCommandEncoderImpl;
+}
+
+WGPURenderPassEncoder wgpuCommandEncoderBeginRenderPass(
+    WGPUCommandEncoder commandEncoder, WGPURenderPassDescriptor const * descriptor)
+{
+    record(
+        "wgpuCommandEncoderBeginRenderPass", 0u, commandEncoder, descriptor->label,
+        descriptor->colorAttachmentCount, descriptor->depthStencilAttachment,
+        descriptor->timestampWriteCount);
+    return new WGPURenderPassEncoderImpl;
+}
+
+WGPUComputePassEncoder wgpuCommandEncoderBeginComputePass(
+    WGPUCommandEncoder commandEncoder, WGPUComputePassDescriptor const * descriptor)
+{
+    record(
+        "wgpuCommandEncoderBeginComputePass", 0u, commandEncoder, label_of(descriptor));
+    return new WGPUComputePassEncoderImpl;
+}
+
+void wgpuComputePassEncoderSetPipeline(
+    WGPUComputePassEncoder computePassEncoder, WGPUComputePipeline pipeline)
+{
+    record("wgpuComputePassEncoderSetPipeline", 0u, computePassEncoder, pipeline);
+}
+
+void wgpuComputePassEncoderSetBindGroup(
+    WGPUComputePassEncoder computePassEncoder,
+    uint32_t groupIndex,
+    WGPUBindGroup group,
+    size_t dynamicOffsetCount,
+    uint32_t const * dynamicOffsets)
+{
+    record(
+        "wgpuComputePassEncoderSetBindGroup", 0u, computePassEncoder, groupIndex, group,
+        dynamicOffsetCount, dynamicOffsets);
+}
+
+void wgpuComputePassEncoderDispatchWorkgroups(
+    WGPUComputePassEncoder computePassEncoder,
+    uint32_t workgroupCountX,
+    uint32_t workgroupCountY,
+    uint32_t workgroupCountZ)
+{
+    record(
+        "wgpuComputePassEncoderDispatchWorkgroups", 0u, computePassEncoder,
+        workgroupCountX, workgroupCountY, workgroupCountZ);
+}
+
+void wgpuComputePassEncoderEnd(WGPUComputePassEncoder computePassEncoder)
+{
+    record("wgpuComputePassEncoderEnd", 0u, computePassEncoder);
+}
+
+void wgpuCommandEncoderCopyBufferToBuffer(
+    WGPUCommandEncoder commandEncoder,
+    WGPUBuffer source,
+    uint64_t sourceOffset,
+    WGPUBuffer destination,
+    uint64_t destinationOffset,
+    uint64_t size)
+{
+    record(
+        "wgpuCommandEncoderCopyBufferToBuffer", 0u, commandEncoder,
+        source, sourceOffset, destination, destinationOffset, size);
+
+    // Copies are done right away, command order within a submit is kept
+    if(sourceOffset + size <= source->contents.size() &&
+        destinationOffset + size <= destination->contents.size())
+    {
+        std::memmove(
+            destination->contents.data() + destinationOffset,
+            source->contents.data() + sourceOffset,
+            static_cast<std::size_t>(size));
+    }
+}
+
+void wgpuCommandEncoderResolveQuerySet(
+    WGPUCommandEncoder commandEncoder,
+    WGPUQuerySet querySet,
+    uint32_t firstQuery,
+    uint32_t queryCount,
+    WGPUBuffer destination,
+    uint64_t destinationOffset)
+{
+    record(
+        "wgpuCommandEncoderResolveQuerySet", 0u, commandEncoder, querySet,
+        firstQuery, queryCount, destination, destinationOffset);
+
+    // Nothing is rasterized; every fourth occlusion query reports no samples
+    // so callers see both outcomes
+    if(querySet->type == WGPUQueryType_Occlusion)
+    {
+        for(auto i = 0u; i != queryCount; ++i)
+        {
+            auto const offset = destinationOffset + i * sizeof(std::uint64_t);
+            std::uint64_t const samples = (firstQuery + i) % 4u == 3u ? 0u : 64u;
+            if(offset + sizeof(samples) <= destination->contents.size())
+            {
+                std::memcpy(destination->contents.data() + offset, &samples, sizeof(samples));
+            }
+        }
+    }
+}
+
+WGPUCommandBuffer wgpuCommandEncoderFinish(
+    WGPUCommandEncoder commandEncoder, WGPUCommandBufferDescriptor const * descriptor)
+{
+    record("wgpuCommandEncoderFinish", 0u, commandEncoder, label_of(descriptor));
+    return new WGPUCommandBufferImpl;
+}
+
+void wgpuRenderPassEncoderSetPipeline(
+    WGPURenderPassEncoder renderPassEncoder, WGPURenderPipeline pipeline)
+{
+    record("wgpuRenderPassEncoderSetPipeline", 0u, renderPassEncoder, pipeline);
+}
+
+void wgpuRenderPassEncoderSetBindGroup(
+    WGPURenderPassEncoder renderPassEncoder,
+    uint32_t groupIndex,
+    WGPUBindGroup group,
+    size_t dynamicOffsetCount,
+    uint32_t const * dynamicOffsets)
+{
+    record(
+        "wgpuRenderPassEncoderSetBindGroup", 0u, renderPassEncoder, groupIndex,
+        group, dynamicOffsetCount, dynamicOffsetCount ? dynamicOffsets[0] : 0u);
+}
+
+void wgpuRenderPassEncoderSetVertexBuffer(
+    WGPURenderPassEncoder renderPassEncoder,
+    uint32_t slot,
+    WGPUBuffer buffer,
+    uint64_t offset,
+    uint64_t size)
+{
+    record(
+        "wgpuRenderPassEncoderSetVertexBuffer", 0u, renderPassEncoder, slot,
+        buffer, offset, size);
+}
+
+void wgpuRenderPassEncoderSetIndexBuffer(
+    WGPURenderPassEncoder renderPassEncoder,
+    WGPUBuffer buffer,
+    WGPUIndexFormat format,
+    uint64_t offset,
+    uint64_t size)
+{
+    record(
+        "wgpuRenderPassEncoderSetIndexBuffer", 0u, renderPassEncoder, buffer,
+        format, offset, size);
+}
+
+void wgpuRenderPassEncoderSetViewport(
+    WGPURenderPassEncoder renderPassEncoder,
+    float x, float y, float width, float height, float minDepth, float maxDepth)
+{
+    record(
+        "wgpuRenderPassEncoderSetViewport", 0u, renderPassEncoder,
+        x, y, width, height, minDepth, maxDepth);
+}
+
+void wgpuRenderPassEncoderSetScissorRect(
+    WGPURenderPassEncoder renderPassEncoder,
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    record(
+        "wgpuRenderPassEncoderSetScissorRect", 0u, renderPassEncoder,
+        x, y, width, height);
+}
+
+void wgpuRenderPassEncoderDraw(
+    WGPURenderPassEncoder renderPassEncoder,
+    uint32_t vertexCount,
+    uint32_t instanceCount,
+    uint32_t firstVertex,
+    uint32_t firstInstance)
+{
+    record(
+        "wgpuRenderPassEncoderDraw", 0u, renderPassEncoder, vertexCount,
+        instanceCount, firstVertex, firstInstance);
+}
+
+void wgpuRenderPassEncoderDrawIndexed(
+    WGPURenderPassEncoder renderPassEncoder,
+    uint32_t indexCount,
+    uint32_t instanceCount,
+    uint32_t firstIndex,
+    int32_t baseVertex,
+    uint32_t firstInstance)
+{
+    record(
+        "wgpuRenderPassEncoderDrawIndexed", 0u, renderPassEncoder, indexCount,
+        instanceCount, firstIndex, baseVertex, firstInstance);
+}
+
+void wgpuRenderPassEncoderDrawIndexedIndirect(
+    WGPURenderPassEncoder renderPassEncoder, WGPUBuffer indirectBuffer, uint64_t indirectOffset)
+{
+    record(
+        "wgpuRenderPassEncoderDrawIndexedIndirect", 0u, renderPassEncoder,
+        indirectBuffer, indirectOffset);
+}
+
+void wgpuRenderPassEncoderBeginOcclusionQuery(
+    WGPURenderPassEncoder renderPassEncoder, uint32_t queryIndex)
+{
+    record("wgpuRenderPassEncoderBeginOcclusionQuery", 0u, renderPassEncoder, queryIndex);
+}
+
+void wgpuRenderPassEncoderEndOcclusionQuery(WGPURenderPassEncoder renderPassEncoder)
+{
+    record("wgpuRenderPassEncoderEndOcclusionQuery", 0u, renderPassEncoder);
+}
+
+void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder)
+{
+    record("wgpuRenderPassEncoderEnd", 0u, renderPassEncoder);
+}
+
+void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, WGPUCommandBuffer const * commands)
+{
+    record("wgpuQueueSubmit", 0u, queue, commandCount, commands);
+}
+
+void wgpuQueueOnSubmittedWorkDone(
+    WGPUQueue queue, uint64_t signalValue, WGPUQueueWorkDoneCallback callback, void * userdata)
+{
+    record("wgpuQueueOnSubmittedWorkDone", 0u, queue, signalValue);
+    defer([callback, userdata]
+    {
+        callback(WGPUQueueWorkDoneStatus_Success, userdata);
+    });
+}
+
+void wgpuQueueWriteBuffer(
+    WGPUQueue queue, WGPUBuffer buffer, uint64_t bufferOffset, void const * data, size_t size)
+{
+    record("wgpuQueueWriteBuffer", size, queue, buffer, bufferOffset, size);
+
+    if(bufferOffset + size <= buffer->contents.size())
+    {
+        std::memcpy(buffer->contents.data() + bufferOffset, data, size);
+    }
+}
+
+void wgpuQueueWriteTexture(
+    WGPUQueue queue,
+    WGPUImageCopyTexture const * destination,
+    void const * data,
+    size_t dataSize,
+    WGPUTextureDataLayout const * dataLayout,
+    WGPUExtent3D const * writeSize)
+{
+    record(
+        "wgpuQueueWriteTexture", dataSize, queue, destination->texture,
+        destination->mipLevel, data, dataSize, dataLayout->bytesPerRow,
+        writeSize->width, writeSize->height, writeSize->depthOrArrayLayers);
+}
+
+namespace webgpu_mock
+{
+statistics snapshot()
+{
+    auto & state = recorder();
+    std::lock_guard<std::mutex> lock{state.mutex};
+    return state.stats;
+}
+
+statistics difference(statistics const & later, statistics const & earlier)
+{
+    auto result = statistics
+    {
+        .calls = later.calls - earlier.calls,
+        .bytes_written = later.bytes_written - earlier.bytes_written,
+        .calls_by_function = {}
+    };
+
+    for(auto const & [function, count]: later.calls_by_function)
+    {
+        auto const it = earlier.calls_by_function.find(function);
+        auto const before = it == earlier.calls_by_function.end() ? 0u : it->second;
+
+        if(count != before)
+        {
+            result.calls_by_function.emplace(function, count - before);
+        }
+    }
+
+    return result;
+}
+
+void set_call_log(bool enabled)
+{
+    auto & state = recorder();
+    std::lock_guard<std::mutex> lock{state.mutex};
+    state.log_enabled = enabled;
+}
+
+std::vector<call_record> call_log()
+{
+    auto & state = recorder();
+    std::lock_guard<std::mutex> lock{state.mutex};
+    return state.log;
+}
+
+void reset()
+{
+    auto & state = recorder();
+    std::lock_guard<std::mutex> lock{state.mutex};
+    state.stats = statistics{};
+    state.log.clear();
+}
+
+void report(std::ostream & out, statistics const & stats)
+{
+    out << stats.calls << " calls, " << stats.bytes_written << " bytes written\n";
+
+    for(auto const & [function, count]: stats.calls_by_function)
+    {
+        out << " - " << function << ": " << count << '\n';
+    }
+}
+
+statistics parse_report(std::istream & in)
+{
+    auto stats = statistics{};
+    auto line = std::string{};
+
+    auto const malformed = [&line]
+    {
+        return std::runtime_error{"Malformed WebGPU call report line: " + line};
+    };
+
+    if(!std::getline(in, line))
+    {
+        throw std::runtime_error{"Empty WebGPU call report"};
+    }
+
+    auto totals = std::istringstream{line};
+    auto calls_word = std::string{};
+    auto bytes_words = std::array<std::string, 2>{};
+    if(!(totals >> stats.calls >> calls_word >> stats.bytes_written >>
+        bytes_words[0] >> bytes_words[1]) ||
+        calls_word != "calls," || bytes_words[0] != "bytes" || bytes_words[1] != "written")
+    {
+        throw malformed();
+    }
+
+    while(std::getline(in, line))
+    {
+        if(line.empty())
+        {
+            continue;
+        }
+
+        auto const separator = line.rfind(": ");
+        if(line.substr(0, 3) != " - " || separator == std::string::npos)
+        {
+            throw malformed();
+        }
+
+        auto count = std::uint64_t{0};
+        auto value = std::istringstream{line.substr(separator + 2u)};
+        if(!(value >> count))
+        {
+            throw malformed();
+        }
+
+        stats.calls_by_function[line.substr(3, separator - 3u)] = count;
+    }
+
+    return stats;
+}
+
+bool report_drift(std::ostream & out, statistics const & expected, statistics const & actual)
+{
+    auto drifted = false;
+
+    auto const compare = [&](std::string const & what, std::uint64_t want, std::uint64_t got)
+    {
+        if(want != got)
+        {
+            out << " - " << what << ": " << got << ", expected " << want << '\n';
+            drifted = true;
+        }
+    };
+
+    compare("calls", expected.calls, actual.calls);
+    compare("bytes written", expected.bytes_written, actual.bytes_written);
+
+    auto functions = std::map<std::string, std::pair<std::uint64_t, std::uint64_t>>{};
+    for(auto const & [function, count]: expected.calls_by_function)
+    {
+        functions[function].first = count;
+    }
+    for(auto const & [function, count]: actual.calls_by_function)
+    {
+        functions[function].second = count;
+    }
+
+    for(auto const & [function, counts]: functions)
+    {
+        compare(function, counts.first, counts.second);
+    }
+
+    return drifted;
+}
+} /* namespace webgpu_mock */